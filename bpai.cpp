@@ -0,0 +1,336 @@
+#include "bpai.h"
+#include "cards.h"
+#include "feature_encoder.h"
+
+#include <new>
+#include <memory>
+#include <exception>
+using std::exception;
+
+#include <stdexcept>
+using std::out_of_range;
+
+
+static_assert(BPAI_NUM_CARDS == NUM_CARDS_PER_DECK, "bpai.h is out of date");
+static_assert(BPAI_POSITION_NOT_SHOWN == POSITION_NOT_SHOWN, "bpai.h is out of date");
+
+#define BPAI_NUM_POSITIONS (POSITION_NOT_SHOWN + 1)
+
+
+// The weights flattened out of an FFBPNeuralNet. Each card's inputs depend
+// only on its position, so the first layer is folded into one row of
+// contributions per (card, position). Most cards are not shown, so the rows
+// are stored relative to the not shown one, whose sum goes into the bias
+// terms, and only the shown cards' rows are added. The later layers are
+// stored neuron-major. The engineered features, when the network has them,
+// keep their own weights.
+struct bpai_model
+{
+    size_t num_inputs;
+    
+    // INPUT_ENCODING_*, from the network's input size, and whether the
+    // engineered features follow the card states
+    size_t input_encoding;
+    bool engineered_features;
+    
+    // hidden layers then the output layer
+    vector<size_t> layer_sizes;
+    
+    // first layer: bias terms, then rows[(card_id*num_positions + position)*num_neurons + neuron]
+    vector<double> first_layer;
+    
+    // first layer: feature_weights[feature*num_neurons + neuron], if engineered_features
+    vector<double> feature_weights;
+    
+    // later layers: per neuron, the bias term then one weight per input
+    vector< vector<double> > layers;
+    
+    size_t max_layer_size;
+};
+
+// input indices that are 1 for a card at a position in an encoding, the rest are 0
+static size_t get_active_inputs(const size_t encoding, const size_t card_id, const size_t position, size_t *const inputs)
+{
+    if(INPUT_ENCODING_ONE_HOT == encoding)
+    {
+        inputs[0] = card_id*BPAI_NUM_POSITIONS + position;
+        
+        return 1;
+    }
+    
+    // the 4 bit code is the position, most significant bit first
+    size_t num_inputs = 0;
+    
+    for(size_t i = 0; i < 4; i++)
+        if(0 != (position & (8 >> i)))
+            inputs[num_inputs++] = card_id*4 + i;
+    
+    return num_inputs;
+}
+
+static bool get_ANN_positions(const unsigned char *const positions, unsigned char *const ANN_positions)
+{
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        if(positions[i] > POSITION_NOT_SHOWN)
+            return false;
+    
+#ifdef USE_SUIT_CANONICAL_INPUT_ENCODING
+    
+    canonicalise_card_positions(positions, ANN_positions);
+    
+#else
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        ANN_positions[i] = positions[i];
+    
+#endif
+    
+    return true;
+}
+
+int bpai_model_load(const char *filename, bpai_model **model)
+{
+    if(0 == filename || 0 == model)
+        return BPAI_ERROR_INVALID_ARGUMENT;
+    
+    *model = 0;
+    
+    try
+    {
+        FFBPNeuralNet NNet(filename);
+        
+        std::unique_ptr<bpai_model> temp_model(new bpai_model);
+        
+        try
+        {
+            temp_model->input_encoding = blind_poker_table::get_input_encoding_for_size(NNet.GetNumInputLayerNeurons(), temp_model->engineered_features);
+        }
+        catch(const out_of_range &)
+        {
+            return BPAI_ERROR_MODEL;
+        }
+        
+        temp_model->num_inputs = NNet.GetNumInputLayerNeurons();
+        temp_model->max_layer_size = 0;
+        
+        for(size_t i = 0; i < NNet.GetNumHiddenLayers(); i++)
+            temp_model->layer_sizes.push_back(NNet.GetNumHiddenLayerNeurons(i));
+        
+        temp_model->layer_sizes.push_back(NNet.GetNumOutputLayerNeurons());
+        
+        for(size_t i = 0; i < temp_model->layer_sizes.size(); i++)
+            if(temp_model->layer_sizes[i] > temp_model->max_layer_size)
+                temp_model->max_layer_size = temp_model->layer_sizes[i];
+        
+        // first layer, one row per (card, position)
+        const size_t first_layer_size = temp_model->layer_sizes[0];
+        const size_t encoding = temp_model->input_encoding;
+        const size_t num_card_inputs = blind_poker_table::get_input_encoding_size(encoding);
+        
+        temp_model->first_layer.assign(first_layer_size*(1 + NUM_CARDS_PER_DECK*BPAI_NUM_POSITIONS), 0.0);
+        
+        if(true == temp_model->engineered_features)
+            temp_model->feature_weights.assign(first_layer_size*NUM_ENGINEERED_FEATURES, 0.0);
+        
+        size_t active_inputs[4];
+        
+        for(size_t j = 0; j < first_layer_size; j++)
+        {
+            const WeightedNeuron &neuron = NNet.GetHiddenLayerNeuron(0, j);
+            double bias_term = neuron.GetBias()*neuron.GetBiasWeight();
+            
+            for(size_t card_id = 0; card_id < NUM_CARDS_PER_DECK; card_id++)
+            {
+                double not_shown_sum = 0;
+                size_t num_active_inputs = get_active_inputs(encoding, card_id, POSITION_NOT_SHOWN, active_inputs);
+                
+                for(size_t k = 0; k < num_active_inputs; k++)
+                    not_shown_sum += neuron.GetWeight(active_inputs[k]);
+                
+                bias_term += not_shown_sum;
+                
+                for(size_t position = 0; position < BPAI_NUM_POSITIONS; position++)
+                {
+                    double sum = 0;
+                    num_active_inputs = get_active_inputs(encoding, card_id, position, active_inputs);
+                    
+                    for(size_t k = 0; k < num_active_inputs; k++)
+                        sum += neuron.GetWeight(active_inputs[k]);
+                    
+                    temp_model->first_layer[first_layer_size*(1 + card_id*BPAI_NUM_POSITIONS + position) + j] = sum - not_shown_sum;
+                }
+            }
+            
+            temp_model->first_layer[j] = bias_term;
+            
+            if(true == temp_model->engineered_features)
+                for(size_t k = 0; k < NUM_ENGINEERED_FEATURES; k++)
+                    temp_model->feature_weights[k*first_layer_size + j] = neuron.GetWeight(num_card_inputs + k);
+        }
+        
+        // later layers, neuron-major
+        for(size_t i = 1; i < temp_model->layer_sizes.size(); i++)
+        {
+            vector<double> layer;
+            
+            for(size_t j = 0; j < temp_model->layer_sizes[i]; j++)
+            {
+                const WeightedNeuron &neuron = (i < NNet.GetNumHiddenLayers()) ? NNet.GetHiddenLayerNeuron(i, j) : NNet.GetOutputLayerNeuron(j);
+                
+                layer.push_back(neuron.GetBias()*neuron.GetBiasWeight());
+                
+                for(size_t k = 0; k < neuron.GetNumInputs(); k++)
+                    layer.push_back(neuron.GetWeight(k));
+            }
+            
+            temp_model->layers.push_back(layer);
+        }
+        
+        *model = temp_model.release();
+    }
+    catch(const std::bad_alloc &)
+    {
+        return BPAI_ERROR_MODEL;
+    }
+    catch(const exception &)
+    {
+        return BPAI_ERROR_FILE;
+    }
+    
+    return BPAI_OK;
+}
+
+void bpai_model_free(bpai_model *model)
+{
+    delete model;
+}
+
+size_t bpai_model_scratch_size(const bpai_model *model)
+{
+    if(0 == model)
+        return 0;
+    
+    return 2*model->max_layer_size;
+}
+
+size_t bpai_input_size(const bpai_model *model)
+{
+    if(0 == model)
+        return 0;
+    
+    return model->num_inputs;
+}
+
+int bpai_encode_state(const bpai_model *model, const unsigned char *positions, double *input, size_t input_size)
+{
+    if(0 == model || 0 == positions || 0 == input)
+        return BPAI_ERROR_INVALID_ARGUMENT;
+    
+    if(input_size < bpai_input_size(model))
+        return BPAI_ERROR_BUFFER_TOO_SMALL;
+    
+    unsigned char ANN_positions[NUM_CARDS_PER_DECK];
+    
+    if(false == get_ANN_positions(positions, ANN_positions))
+        return BPAI_ERROR_INVALID_ARGUMENT;
+    
+    const size_t num_card_inputs = blind_poker_table::get_input_encoding_size(model->input_encoding);
+    
+    for(size_t i = 0; i < num_card_inputs; i++)
+        input[i] = 0;
+    
+    size_t active_inputs[4];
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+    {
+        const size_t num_active_inputs = get_active_inputs(model->input_encoding, i, ANN_positions[i], active_inputs);
+        
+        for(size_t j = 0; j < num_active_inputs; j++)
+            input[active_inputs[j]] = 1;
+    }
+    
+    // from the positions as given, as the training code does; they don't depend on the suits' labels
+    if(true == model->engineered_features)
+        get_engineered_features(positions, input + num_card_inputs);
+    
+    return BPAI_OK;
+}
+
+int bpai_decide(const bpai_model *model, const unsigned char *positions, double *scratch, size_t scratch_size, int *decision, double *probability)
+{
+    if(0 == model || 0 == positions || 0 == scratch || 0 == decision || 0 == probability)
+        return BPAI_ERROR_INVALID_ARGUMENT;
+    
+    if(scratch_size < bpai_model_scratch_size(model))
+        return BPAI_ERROR_BUFFER_TOO_SMALL;
+    
+    unsigned char ANN_positions[NUM_CARDS_PER_DECK];
+    
+    if(false == get_ANN_positions(positions, ANN_positions))
+        return BPAI_ERROR_INVALID_ARGUMENT;
+    
+    double *values = scratch;
+    double *next_values = scratch + model->max_layer_size;
+    
+    // first layer, adding the rows of the cards that are shown
+    const size_t first_layer_size = model->layer_sizes[0];
+    const double *const first_layer = &model->first_layer[0];
+    
+    for(size_t j = 0; j < first_layer_size; j++)
+        values[j] = first_layer[j];
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+    {
+        if(POSITION_NOT_SHOWN == ANN_positions[i])
+            continue;
+        
+        const double *const row = first_layer + first_layer_size*(1 + i*BPAI_NUM_POSITIONS + ANN_positions[i]);
+        
+        for(size_t j = 0; j < first_layer_size; j++)
+            values[j] += row[j];
+    }
+    
+    if(true == model->engineered_features)
+    {
+        double features[NUM_ENGINEERED_FEATURES];
+        get_engineered_features(positions, features);
+        
+        for(size_t i = 0; i < NUM_ENGINEERED_FEATURES; i++)
+        {
+            const double *const row = &model->feature_weights[first_layer_size*i];
+            
+            for(size_t j = 0; j < first_layer_size; j++)
+                values[j] += features[i] * row[j];
+        }
+    }
+    
+    for(size_t j = 0; j < first_layer_size; j++)
+        values[j] = WeightedNeuron::ActivationFunction(values[j]);
+    
+    // the other layers, dense
+    for(size_t i = 1; i < model->layer_sizes.size(); i++)
+    {
+        const size_t num_previous_values = model->layer_sizes[i - 1];
+        const double *weights = &model->layers[i - 1][0];
+        
+        for(size_t j = 0; j < model->layer_sizes[i]; j++)
+        {
+            double value = weights[0];
+            
+            for(size_t k = 0; k < num_previous_values; k++)
+                value += weights[1 + k] * values[k];
+            
+            next_values[j] = WeightedNeuron::ActivationFunction(value);
+            weights += 1 + num_previous_values;
+        }
+        
+        double *temp = values;
+        values = next_values;
+        next_values = temp;
+    }
+    
+    *probability = values[0];
+    *decision = (values[0] < 0.5) ? 0 : 1;
+    
+    return BPAI_OK;
+}
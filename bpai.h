@@ -0,0 +1,80 @@
+#ifndef BPAI_H
+#define BPAI_H
+
+
+/*
+ * C interface to the seat networks, for calling the bot in-process.
+ *
+ * A state is NUM_CARDS_PER_DECK (52) position bytes indexed by card id,
+ * card_id == (face - 2)*4 + suit with faces 2 .. 14 (ace) and suits
+ * hearts, spades, diamonds, clubs, as from blind_poker_table::get_card_positions.
+ *
+ * Nothing allocates after bpai_model_load: the encoding and the decision
+ * write to caller-owned buffers, and a model can be used from any number of
+ * threads at once as long as each has its own scratch buffer.
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+    #define BPAI_API __declspec(dllexport)
+#else
+    #define BPAI_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define BPAI_NUM_CARDS 52
+
+#define BPAI_POSITION_HAND0 0
+#define BPAI_POSITION_HAND1 1
+#define BPAI_POSITION_HAND2 2
+#define BPAI_POSITION_HAND3 3
+#define BPAI_POSITION_HAND4 4
+#define BPAI_POSITION_DISCARD_PILE 5
+#define BPAI_POSITION_TOP_OF_DISCARD_PILE 6
+#define BPAI_POSITION_TOP_OF_PICKUP_PILE 7
+#define BPAI_POSITION_NOT_SHOWN 8
+
+#define BPAI_OK 0
+#define BPAI_ERROR_INVALID_ARGUMENT -1
+#define BPAI_ERROR_FILE -2
+#define BPAI_ERROR_MODEL -3
+#define BPAI_ERROR_BUFFER_TOO_SMALL -4
+
+typedef struct bpai_model bpai_model;
+
+/* loads a file written by FFBPNeuralNet::SaveToFile */
+BPAI_API int bpai_model_load(const char *filename, bpai_model **model);
+BPAI_API void bpai_model_free(bpai_model *model);
+
+/* doubles of scratch space bpai_decide needs for this model */
+BPAI_API size_t bpai_model_scratch_size(const bpai_model *model);
+
+/*
+ * length of the model's input vector; the encoding (one-hot or binary card
+ * positions, with or without the engineered features) is the one its input
+ * size was trained with
+ */
+BPAI_API size_t bpai_input_size(const bpai_model *model);
+
+/* the model's network input for a state, as the training code builds it */
+BPAI_API int bpai_encode_state(const bpai_model *model, const unsigned char *positions, double *input, size_t input_size);
+
+/*
+ * decision is 0 or 1, as in play_ANN: before the top of the pickup pile is
+ * flipped, 0 takes the top of the discard pile and 1 flips; after, 0
+ * discards the flipped card and 1 keeps it. probability is the network output.
+ */
+BPAI_API int bpai_decide(const bpai_model *model, const unsigned char *positions, double *scratch, size_t scratch_size, int *decision, double *probability);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
@@ -1,4 +1,10 @@
     #include "cards.h"
+#include "feature_encoder.h"
+
+#include <cstring>
+
+#include <stdexcept>
+using std::out_of_range;
 
 bool card::operator<(const card &rhs) const
 {
@@ -38,17 +44,20 @@ void card::print(void) const
 
 blind_poker_table::blind_poker_table(void)
 {
+    // seeded from rand(), so that srand() still decides the whole game
+    set_rand_seed(static_cast<unsigned long long>(rand()) << 32 ^ static_cast<unsigned long long>(rand()));
+    
+    input_encoding = DEFAULT_INPUT_ENCODING;
+    
+    // sized once, deal_cards overwrites the cards in place
+    players_hands.assign(NUM_PLAYERS, vector<card>(NUM_CARDS_PER_HAND));
+    
     reset_table();
     current_player = 0;
 }
 
 void blind_poker_table::reset_table(void)
 {
-    players_hands.clear();
-    discard_pile.clear();
-    pickup_pile.clear();
-    card_id_lookup_helper.clear();
-    
     // initialize the deck
     size_t id = 0;
 
@@ -56,47 +65,73 @@ void blind_poker_table::reset_table(void)
     {
         for(size_t j = SUIT_HEARTS; j <= SUIT_CLUBS; j++)
         {
-            card c;
+            card &c = pickup_pile[id];
             
             c.card_id = id++;
             c.suit = j;
             c.face = i;
             c.shown = false;
-            
-            pickup_pile.push_back(c);
         }
     }
     
-    // make a backup of the cards for later use when looking up card_id
-    card_id_lookup_helper = pickup_pile;
+    pickup_pile_size = NUM_CARDS_PER_DECK;
     
-    // shuffle the deck
-    for(size_t i = 0; i < 100000; i++)
+    // shuffle the deck, Fisher-Yates
+    for(size_t i = NUM_CARDS_PER_DECK; i > 1; i--)
+        swap_cards(pickup_pile[i - 1], pickup_pile[get_rand() % i]);
+    
+    deal_cards();
+}
+
+void blind_poker_table::reset_table(const unsigned char *const src_deck_order)
+{
+    // stack the deck as given, bottom first, card_id == (face - FACE_2)*4 + suit
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
     {
-        size_t first_pos = rand() % NUM_CARDS_PER_DECK;
-        size_t second_pos = rand() % NUM_CARDS_PER_DECK;
+        card &c = pickup_pile[i];
         
-        card temp_card = pickup_pile[first_pos];
-        pickup_pile[first_pos] = pickup_pile[second_pos];
-        pickup_pile[second_pos] = temp_card;
+        c.card_id = src_deck_order[i];
+        c.suit = c.card_id%4;
+        c.face = c.card_id/4 + FACE_2;
+        c.shown = false;
     }
     
-    // deal cards to each player
-    players_hands.resize(NUM_PLAYERS);
+    pickup_pile_size = NUM_CARDS_PER_DECK;
     
+    deal_cards();
+    current_player = 0;
+}
+
+void blind_poker_table::deal_cards(void)
+{
+    // remember the order, for game records
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        deck_order[i] = static_cast<unsigned char>(pickup_pile[i].card_id);
+    
+    num_turns = 0;
+    
+    // nothing is shown until the first card is flipped
+    memset(card_positions, POSITION_NOT_SHOWN, sizeof(card_positions));
+    
+    // deal cards to each player
     for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
-    {
         for(size_t j = 0; j < NUM_PLAYERS; j++)
-        {
-            players_hands[j].push_back(pickup_pile[pickup_pile.size() - 1]);
-            pickup_pile.pop_back();
-        }
-    }
+            players_hands[j][i] = pickup_pile[--pickup_pile_size];
     
     // flip a card off of the pickup pile onto the discard pile
-    discard_pile.push_back(pickup_pile[pickup_pile.size() - 1]);
+    discard_pile[0] = pickup_pile[--pickup_pile_size];
     discard_pile[0].shown = true;
-    pickup_pile.pop_back();
+    discard_pile_size = 1;
+    
+    card_positions[discard_pile[0].card_id] = POSITION_TOP_OF_DISCARD_PILE;
+    
+    reset_face_masks();
+    
+    // hash the starting position from scratch, moves update it incrementally
+    state_hash = 0;
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        state_hash ^= get_zobrist_key(i, card_positions[i]);
 }
 
 void blind_poker_table::print_table(void) const
@@ -121,7 +156,7 @@ void blind_poker_table::print_table(void) const
     
     cout << "Discard pile: ";
     
-    for(size_t i = 0; i < discard_pile.size(); i++)
+    for(size_t i = 0; i < discard_pile_size; i++)
     {
         discard_pile[i].print();
         cout << ' ';
@@ -131,9 +166,9 @@ void blind_poker_table::print_table(void) const
     
     cout << "Top of pickup pile: ";
     
-    pickup_pile[pickup_pile.size() - 1].print();
+    pickup_pile[pickup_pile_size - 1].print();
     
-    if(false == pickup_pile[pickup_pile.size() - 1].shown)
+    if(false == pickup_pile[pickup_pile_size - 1].shown)
         cout << '*';
     
     cout << endl << endl;
@@ -155,480 +190,778 @@ void blind_poker_table::print_sorted_hand(const size_t player_index) const
 
 }
 
+void blind_poker_table::get_card_positions(unsigned char *const positions) const
+{
+    memcpy(positions, card_positions, NUM_CARDS_PER_DECK);
+}
+
 void blind_poker_table::get_card_states(vector<double> &states) const
 {
-    states.clear();
+    unsigned char positions[NUM_CARDS_PER_DECK];
+    get_card_positions(positions);
     
-    for(size_t card_id = 0; card_id < NUM_CARDS_PER_DECK; card_id++)
+    encode_card_positions(positions, states, input_encoding);
+}
+
+void blind_poker_table::get_canonical_card_states(vector<double> &states) const
+{
+    unsigned char positions[NUM_CARDS_PER_DECK];
+    unsigned char canonical_positions[NUM_CARDS_PER_DECK];
+    
+    get_card_positions(positions);
+    canonicalise_card_positions(positions, canonical_positions);
+    
+    encode_card_positions(canonical_positions, states, input_encoding);
+}
+
+unsigned long long blind_poker_table::get_canonical_state_hash(void) const
+{
+    unsigned char positions[NUM_CARDS_PER_DECK];
+    unsigned char canonical_positions[NUM_CARDS_PER_DECK];
+    
+    get_card_positions(positions);
+    canonicalise_card_positions(positions, canonical_positions);
+    
+    unsigned long long hash = 0;
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        hash ^= get_zobrist_key(i, canonical_positions[i]);
+    
+    return hash;
+}
+
+void blind_poker_table::encode_card_positions(const unsigned char *const positions, vector<double> &states, const size_t encoding)
+{
+    switch(encoding)
     {
-        bool found_card = false;
-        size_t position = POSITION_HAND0;
+    case INPUT_ENCODING_ONE_HOT:
         
-        // Check players' hands
-        for(size_t i = 0; i < NUM_PLAYERS; i++)
-        {
-            if(true == found_card)
-                break;
-            
-            // Check all cards in hand
-            for(size_t j = 0; j < NUM_CARDS_PER_HAND; j++)
-            {
-                if(true == found_card)
-                    break;
-                
-                if(card_id == players_hands[i][j].card_id)
-                {
-                    if(true == players_hands[i][j].shown)
-                    {
-                        //cout << "POSITION_HAND0 + " << i << endl;
-                        position = POSITION_HAND0 + i;
-                    }
-                    else
-                    {
-                        //cout << "POSITION_NOT_SHOWN" << endl;
-                        position = POSITION_NOT_SHOWN;
-                    }
-                    
-                    found_card = true;
-                }
-            }
-        }
+        // 9 neurons per state, the hot one is the position
+        states.assign(NUM_CARDS_PER_DECK*(POSITION_NOT_SHOWN + 1), 0);
         
-        // Check top of discard pile
-        if(false == found_card && card_id == discard_pile[discard_pile.size() - 1].card_id)
-        {
-            //cout << "POSITION_TOP_OF_DISCARD_PILE" << endl;
-            position = POSITION_TOP_OF_DISCARD_PILE;
-            found_card = true;
-        }
+        for(size_t card_id = 0; card_id < NUM_CARDS_PER_DECK; card_id++)
+            states[card_id*(POSITION_NOT_SHOWN + 1) + positions[card_id]] = 1;
+        
+        break;
         
-        // Check all except for top discard pile
-        for(size_t i = 0; i < discard_pile.size() - 1; i++)
+    case INPUT_ENCODING_BINARY:
+        
+        // 4 neurons per state, the position in binary, most significant bit first
+        states.resize(NUM_CARDS_PER_DECK*4);
+        
+        for(size_t card_id = 0; card_id < NUM_CARDS_PER_DECK; card_id++)
         {
-            if(true == found_card)
-                break;
+            const size_t position = positions[card_id];
             
-            if(card_id == discard_pile[i].card_id)
-            {
-                //cout << "POSITION_DISCARD_PILE" << endl;
-                position = POSITION_DISCARD_PILE;
-                found_card = true;
-            }
+            states[card_id*4] = static_cast<double>((position >> 3) & 1);
+            states[card_id*4 + 1] = static_cast<double>((position >> 2) & 1);
+            states[card_id*4 + 2] = static_cast<double>((position >> 1) & 1);
+            states[card_id*4 + 3] = static_cast<double>(position & 1);
         }
         
+        break;
+        
+    default:
+        
+        throw out_of_range("Invalid input encoding.");
+    }
+}
+
+void blind_poker_table::decode_card_states(const vector<double> &states, unsigned char *const positions)
+{
+    // the encoding is known from the number of states
+    const bool one_hot = (states.size() >= get_input_encoding_size(INPUT_ENCODING_ONE_HOT));
+    
+    for(size_t card_id = 0; card_id < NUM_CARDS_PER_DECK; card_id++)
+    {
+        size_t position = 0;
         
-        // check top of pickup pile, if it's shown that is
-        if(false == found_card && true == pickup_pile[pickup_pile.size() - 1].shown && card_id == pickup_pile[pickup_pile.size() - 1].card_id)
+        if(true == one_hot)
         {
-            //cout << "POSITION_TOP_OF_PICKUP_PILE" << endl;
-            position = POSITION_TOP_OF_PICKUP_PILE;
-            found_card = true;
+            // 9 neurons per state, the hot one is the position
+            for(size_t i = 1; i <= POSITION_NOT_SHOWN; i++)
+                if(states[card_id*(POSITION_NOT_SHOWN + 1) + i] > states[card_id*(POSITION_NOT_SHOWN + 1) + position])
+                    position = i;
         }
-        
-        // if not found by now, it's not shown in the pickup pile
-        if(false == found_card)
+        else
         {
-            //cout << "POSITION_NOT_SHOWN 2" << endl;
-            position = POSITION_NOT_SHOWN;
+            // 4 neurons per state, the position in binary, most significant bit first
+            for(size_t i = 0; i < 4; i++)
+                position = position*2 + (states[card_id*4 + i] > 0.5 ? 1 : 0);
         }
         
-        switch(position)
-        {
-                
-#ifdef USE_ONE_HOT_INPUT_ENCODING
-                
-            // 9 neurons per state
-            
-            case POSITION_HAND0:
-            {
-                // 0
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_HAND1:
-            {
-                // 1
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_HAND2:
-            {
-                // 2
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_HAND3:
-            {
-                // 3
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_HAND4:
-            {
-                // 4
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_DISCARD_PILE:
-            {
-                // 5
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_TOP_OF_DISCARD_PILE:
-            {
-                // 6
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_TOP_OF_PICKUP_PILE:
-            {
-                // 7
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_NOT_SHOWN:
-            {
-                // 8
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                break;
-            }
+        positions[card_id] = static_cast<unsigned char>(position);
+    }
+}
 
-#else
-            // 4 neurons per state
-                
-            case POSITION_HAND0:
-            {
-                // 0
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_HAND1:
-            {
-                // 1
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                break;
-            }
-            case POSITION_HAND2:
-            {
-                // 2
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_HAND3:
-            {
-                // 3
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(1);
-                break;
-            }
-            case POSITION_HAND4:
-            {
-                // 4
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_DISCARD_PILE:
-            {
-                // 5
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(1);
-                break;
-            }
-            case POSITION_TOP_OF_DISCARD_PILE:
-            {
-                // 6
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(1);
-                states.push_back(0);
-                break;
-            }
-            case POSITION_TOP_OF_PICKUP_PILE:
-            {
-                // 7
-                states.push_back(0);
-                states.push_back(1);
-                states.push_back(1);
-                states.push_back(1);
-                break;
-            }
-            case POSITION_NOT_SHOWN:
-            {
-                // 8
-                states.push_back(1);
-                states.push_back(0);
-                states.push_back(0);
-                states.push_back(0);
-                break;
-            }
-                
-#endif
+void blind_poker_table::set_input_encoding(const size_t encoding)
+{
+    if(INPUT_ENCODING_BINARY != encoding && INPUT_ENCODING_ONE_HOT != encoding)
+        throw out_of_range("Invalid input encoding.");
+    
+    input_encoding = encoding;
+}
+
+size_t blind_poker_table::get_input_encoding(void) const
+{
+    return input_encoding;
+}
+
+size_t blind_poker_table::get_input_encoding_size(const size_t encoding)
+{
+    if(INPUT_ENCODING_ONE_HOT == encoding)
+        return NUM_CARDS_PER_DECK*(POSITION_NOT_SHOWN + 1); // 52*9 == 468
+    
+    return NUM_CARDS_PER_DECK*4; // 52*4 == 208
+}
+
+size_t blind_poker_table::get_input_encoding_for_size(const size_t num_inputs, bool &engineered_features)
+{
+    for(size_t i = INPUT_ENCODING_BINARY; i <= INPUT_ENCODING_ONE_HOT; i++)
+    {
+        if(num_inputs == get_input_encoding_size(i) || num_inputs == get_input_encoding_size(i) + NUM_ENGINEERED_FEATURES)
+        {
+            engineered_features = (num_inputs != get_input_encoding_size(i));
+            return i;
         }
     }
+    
+    throw out_of_range("Network input size doesn't match any input encoding.");
 }
 
 void blind_poker_table::play_rand(void)
 {
     // make binary choice
     //
-    size_t choice0 = rand()%2;
+    size_t choice0 = get_rand()%2;
     
     if(0 == choice0) // take top of discard pile
     {
-        // get rand not shown index
-        // flip card in player's hand
-        // swap discard pile card with hand card
-        
-        size_t rand_index = get_rand_not_shown_index(current_player);
-        players_hands[current_player][rand_index].shown = true;
-        swap_cards(players_hands[current_player][rand_index], discard_pile[discard_pile.size() - 1]);
+        take_top_of_discard_pile(get_rand_not_shown_index(current_player));
     }
     else // flip top of pickup pile
     {
-        pickup_pile[pickup_pile.size() - 1].shown = true;
+        flip_top_of_pickup_pile();
         
-        size_t choice1 = rand()%2;
+        size_t choice1 = get_rand()%2;
         
         if(0 == choice1) // discard
-        {
-            // move top of pickup pile onto top of discard pile
-            // get rand shown index, flip card
-            
-            discard_pile.push_back(pickup_pile[pickup_pile.size() - 1]);
-            pickup_pile.pop_back();
-            
-            size_t rand_index = get_rand_not_shown_index(current_player);
-            players_hands[current_player][rand_index].shown = true;
-        }
+            discard_top_of_pickup_pile(get_rand_not_shown_index(current_player));
         else
-        {
-            // get rand shown index
-            // move hand card to top of discard pile
-            // move pickup pile top card to hand card
-            
-            size_t rand_index = get_rand_not_shown_index(current_player);
-            players_hands[current_player][rand_index].shown = true;
-            
-            discard_pile.push_back(players_hands[current_player][rand_index]);
-            players_hands[current_player][rand_index] = pickup_pile[pickup_pile.size() - 1];
-            pickup_pile.pop_back();
-        }
+            keep_top_of_pickup_pile(get_rand_not_shown_index(current_player));
     }
     
-    if(current_player == NUM_PLAYERS - 1)
-        current_player = 0;
+    next_player();
+}
+
+void blind_poker_table::play_action(const size_t action)
+{
+    if(ACTION_TAKE_DISCARD == action)
+    {
+        take_top_of_discard_pile(get_rand_not_shown_index(current_player));
+    }
     else
-        current_player++;
+    {
+        flip_top_of_pickup_pile();
+        
+        if(ACTION_FLIP_AND_DISCARD == action)
+            discard_top_of_pickup_pile(get_rand_not_shown_index(current_player));
+        else
+            keep_top_of_pickup_pile(get_rand_not_shown_index(current_player));
+    }
+    
+    next_player();
 }
 
-void blind_poker_table::play_ANN(vector<input_output_pair> &io, FFBPNeuralNet &NNet)
+void blind_poker_table::play_recorded_turn(const unsigned char turn, vector<input_output_pair> &io, const FFBPNeuralNet *const NNet)
 {
-    vector<double> input, output;
+    size_t action = turn & 3;
+    size_t hand_index = turn >> 2;
     
-    get_card_states(input);
-    NNet.FeedForward(input);
-    NNet.GetOutputValues(output);
+    // the samples play_ANN would have stored, with the outputs that give this turn's decisions
+    input_output_pair iop;
+    
+    if(0 != NNet)
+        get_ANN_input(iop.input, *NNet);
+    else
+        get_ANN_input(iop.input);
     
-    if(0 == floor(output[0] + 0.5))  // take top of discard pile
+    iop.output.assign(1, ACTION_TAKE_DISCARD == action ? 0.0 : 1.0);
+    io.push_back(iop);
+    
+    if(ACTION_TAKE_DISCARD == action)
     {
-        input_output_pair iop;
-        iop.input = input;
-        iop.output = output;
+        take_top_of_discard_pile(hand_index);
+    }
+    else
+    {
+        flip_top_of_pickup_pile();
+        
+        if(0 != NNet)
+            get_ANN_input(iop.input, *NNet);
+        else
+            get_ANN_input(iop.input);
+        
+        iop.output.assign(1, ACTION_FLIP_AND_DISCARD == action ? 0.0 : 1.0);
         io.push_back(iop);
         
-        // get rand shown index
-        // flip card in player's hand
-        // swap discard pile card with hand card
-        size_t rand_index = get_rand_not_shown_index(current_player);
-        players_hands[current_player][rand_index].shown = true;
-        swap_cards(players_hands[current_player][rand_index], discard_pile[discard_pile.size() - 1]);
+        if(ACTION_FLIP_AND_DISCARD == action)
+            discard_top_of_pickup_pile(hand_index);
+        else
+            keep_top_of_pickup_pile(hand_index);
     }
-    else  // flip top of pickup pile
+    
+    next_player();
+}
+
+void blind_poker_table::get_deck_order(unsigned char *const src_deck_order) const
+{
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        src_deck_order[i] = deck_order[i];
+}
+
+size_t blind_poker_table::get_num_turns(void) const
+{
+    return num_turns;
+}
+
+unsigned char blind_poker_table::get_turn(const size_t turn_index) const
+{
+    return turn_log[turn_index];
+}
+
+void blind_poker_table::play_ANN(vector<input_output_pair> &io, FFBPNeuralNet &NNet, decision_cache *const cache)
+{
+    vector<double> input, output;
+    
+    get_ANN_input(input, NNet);
+    get_ANN_output(input, NNet, cache, output);
+    
+    input_output_pair iop;
+    iop.input = input;
+    iop.output = output;
+    io.push_back(iop);
+    
+    if(true == play_ANN_decision(output[0]))
     {
-        input_output_pair iop;
+        // the state of the top of the pickup pile has changed to shown
+        get_ANN_input(input, NNet);
+        get_ANN_output(input, NNet, cache, output);
+        
         iop.input = input;
         iop.output = output;
         io.push_back(iop);
         
-        pickup_pile[pickup_pile.size() - 1].shown = true;
-        
-        // the state of the top of the pickup pile has changed to shown
-        get_card_states(input);
-        NNet.FeedForward(input);
-        NNet.GetOutputValues(output);
-        
-        if(0 == floor(output[0] + 0.5)) // discard
+        play_ANN_decision(output[0]);
+    }
+}
+
+bool blind_poker_table::play_ANN_decision(const double output)
+{
+    // the top of the pickup pile is only ever shown between the two decisions of a turn
+    if(false == pickup_pile[pickup_pile_size - 1].shown)
+    {
+        if(0 == floor(output + 0.5))  // take top of discard pile
         {
-            input_output_pair iop;
-            iop.input = input;
-            iop.output = output;
-            io.push_back(iop);
-            
-            // move top of pickup pile onto top of discard pile
-            // get rand shown index, flip card
-            
-            discard_pile.push_back(pickup_pile[pickup_pile.size() - 1]);
-            pickup_pile.pop_back();
-            
-            size_t rand_index = get_rand_not_shown_index(current_player);
-            players_hands[current_player][rand_index].shown = true;
+            take_top_of_discard_pile(get_rand_not_shown_index(current_player));
         }
-        else
+        else  // flip top of pickup pile
         {
-            input_output_pair iop;
-            iop.input = input;
-            iop.output = output;
-            io.push_back(iop);
-            
-            // get rand shown index
-            // move hand card to top of discard pile
-            // move pickup pile top card to hand card
-            
-            size_t rand_index = get_rand_not_shown_index(current_player);
-            players_hands[current_player][rand_index].shown = true;
-            
-            discard_pile.push_back(players_hands[current_player][rand_index]);
-            players_hands[current_player][rand_index] = pickup_pile[pickup_pile.size() - 1];
-            pickup_pile.pop_back();
+            flip_top_of_pickup_pile();
+            return true;
         }
     }
+    else
+    {
+        if(0 == floor(output + 0.5)) // discard
+            discard_top_of_pickup_pile(get_rand_not_shown_index(current_player));
+        else
+            keep_top_of_pickup_pile(get_rand_not_shown_index(current_player));
+    }
+    
+    next_player();
+    
+    return false;
+}
+
+void blind_poker_table::get_ANN_input(vector<double> &input) const
+{
+#ifdef USE_SUIT_CANONICAL_INPUT_ENCODING
+    
+    get_canonical_card_states(input);
+    
+#else
+    
+    get_card_states(input);
+    
+#endif
+}
+
+void blind_poker_table::get_ANN_input(vector<double> &input, const FFBPNeuralNet &NNet) const
+{
+    // the encoding the network was built for, whatever this table's is
+    bool engineered_features = false;
+    const size_t encoding = get_input_encoding_for_size(NNet.GetNumInputLayerNeurons(), engineered_features);
+    
+    unsigned char positions[NUM_CARDS_PER_DECK];
+    get_card_positions(positions);
+    
+    encode_ANN_input(positions, input, encoding);
+    
+    if(true == engineered_features)
+        append_engineered_features(*this, input);
+}
+
+unsigned long long blind_poker_table::get_ANN_input_hash(void) const
+{
+#ifdef USE_SUIT_CANONICAL_INPUT_ENCODING
+    
+    return get_canonical_state_hash();
+    
+#else
+    
+    return state_hash;
+    
+#endif
+}
+
+void blind_poker_table::encode_ANN_input(const unsigned char *const positions, vector<double> &input, const size_t encoding)
+{
+#ifdef USE_SUIT_CANONICAL_INPUT_ENCODING
+    
+    unsigned char canonical_positions[NUM_CARDS_PER_DECK];
+    canonicalise_card_positions(positions, canonical_positions);
+    
+    encode_card_positions(canonical_positions, input, encoding);
+    
+#else
+    
+    encode_card_positions(positions, input, encoding);
+    
+#endif
+}
+
+void blind_poker_table::encode_ANN_input(const unsigned char *const positions, vector<double> &input, const FFBPNeuralNet &NNet)
+{
+    bool engineered_features = false;
+    const size_t encoding = get_input_encoding_for_size(NNet.GetNumInputLayerNeurons(), engineered_features);
+    
+    encode_ANN_input(positions, input, encoding);
+    
+    if(true == engineered_features)
+        append_engineered_features(positions, input);
+}
+
+void blind_poker_table::get_ANN_output(const vector<double> &input, FFBPNeuralNet &NNet, decision_cache *const cache, vector<double> &output)
+{
+    // the cache only holds single output networks
+    if(0 == cache || 1 != NNet.GetNumOutputLayerNeurons())
+    {
+        NNet.FeedForward(input);
+        NNet.GetOutputValues(output);
+        return;
+    }
+    
+    double value = 0;
+    unsigned long long hash = get_ANN_input_hash();
+    
+    if(true == cache->lookup(hash, NNet.GetWeightsVersion(), value))
+    {
+        output.assign(1, value);
+        return;
+    }
+    
+    NNet.FeedForward(input);
+    NNet.GetOutputValues(output);
+    
+    cache->store(hash, NNet.GetWeightsVersion(), output[0]);
+}
+
+void blind_poker_table::take_top_of_discard_pile(const size_t hand_index)
+{
+    // flip card in player's hand
+    // swap discard pile card with hand card
+    
+    card &hand_card = players_hands[current_player][hand_index];
+    card &discard_card = discard_pile[discard_pile_size - 1];
+    
+    set_card_position(hand_card.card_id, POSITION_TOP_OF_DISCARD_PILE);
+    set_card_position(discard_card.card_id, POSITION_HAND0 + current_player);
+    
+    hand_card.shown = true;
+    swap_cards(hand_card, discard_card);
     
+    log_turn(ACTION_TAKE_DISCARD, hand_index);
+}
+
+void blind_poker_table::flip_top_of_pickup_pile(void)
+{
+    card &pickup_card = pickup_pile[pickup_pile_size - 1];
+    
+    set_card_position(pickup_card.card_id, POSITION_TOP_OF_PICKUP_PILE);
+    
+    pickup_card.shown = true;
+}
+
+void blind_poker_table::discard_top_of_pickup_pile(const size_t hand_index)
+{
+    // move top of pickup pile onto top of discard pile
+    // flip hand card
+    
+    set_card_position(discard_pile[discard_pile_size - 1].card_id, POSITION_DISCARD_PILE);
+    set_card_position(pickup_pile[pickup_pile_size - 1].card_id, POSITION_TOP_OF_DISCARD_PILE);
+    
+    discard_pile[discard_pile_size++] = pickup_pile[--pickup_pile_size];
+    
+    card &hand_card = players_hands[current_player][hand_index];
+    
+    set_card_position(hand_card.card_id, POSITION_HAND0 + current_player);
+    
+    hand_card.shown = true;
+    
+    log_turn(ACTION_FLIP_AND_DISCARD, hand_index);
+}
+
+void blind_poker_table::keep_top_of_pickup_pile(const size_t hand_index)
+{
+    // move hand card to top of discard pile
+    // move pickup pile top card to hand card
+    
+    card &hand_card = players_hands[current_player][hand_index];
+    
+    set_card_position(discard_pile[discard_pile_size - 1].card_id, POSITION_DISCARD_PILE);
+    set_card_position(hand_card.card_id, POSITION_TOP_OF_DISCARD_PILE);
+    set_card_position(pickup_pile[pickup_pile_size - 1].card_id, POSITION_HAND0 + current_player);
+    
+    hand_card.shown = true;
+    
+    discard_pile[discard_pile_size++] = hand_card;
+    hand_card = pickup_pile[--pickup_pile_size];
+    
+    log_turn(ACTION_FLIP_AND_KEEP, hand_index);
+}
+
+void blind_poker_table::log_turn(const size_t action, const size_t hand_index)
+{
+    if(num_turns < MAX_NUM_TURNS)
+        turn_log[num_turns++] = static_cast<unsigned char>(action | (hand_index << 2));
+}
+
+void blind_poker_table::next_player(void)
+{
     if(current_player == NUM_PLAYERS - 1)
         current_player = 0;
     else
         current_player++;
 }
 
-size_t blind_poker_table::get_rand_not_shown_index(const size_t player_index) const
+size_t blind_poker_table::get_current_player(void) const
+{
+    return current_player;
+}
+
+bool blind_poker_table::is_game_over(void) const
+{
+    // every turn shows one card of the player's hand
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        if(NUM_CARDS_PER_HAND != hand_num_shown(players_hands[i]))
+            return false;
+    
+    return true;
+}
+
+void blind_poker_table::randomise_unseen_cards(void)
+{
+    // gather every card that nobody can see: unshown hand cards and the
+    // pickup pile below a shown top card
+    card *unseen_slots[NUM_CARDS_PER_DECK];
+    size_t num_unseen_slots = 0;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        for(size_t j = 0; j < NUM_CARDS_PER_HAND; j++)
+            if(false == players_hands[i][j].shown)
+                unseen_slots[num_unseen_slots++] = &players_hands[i][j];
+    
+    for(size_t i = 0; i < pickup_pile_size; i++)
+        if(false == pickup_pile[i].shown)
+            unseen_slots[num_unseen_slots++] = &pickup_pile[i];
+    
+    // Fisher-Yates over the slots; every unseen card stays POSITION_NOT_SHOWN,
+    // so neither the state hash nor card_positions change
+    for(size_t i = num_unseen_slots; i > 1; i--)
+        swap_cards(*unseen_slots[i - 1], *unseen_slots[get_rand() % i]);
+}
+
+void blind_poker_table::save_snapshot(table_snapshot &snapshot) const
+{
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        for(size_t j = 0; j < NUM_CARDS_PER_HAND; j++)
+            snapshot.players_hands[i][j] = players_hands[i][j];
+    
+    // only the cards below the tops are in play
+    memcpy(snapshot.discard_pile, discard_pile, discard_pile_size*sizeof(card));
+    memcpy(snapshot.pickup_pile, pickup_pile, pickup_pile_size*sizeof(card));
+    snapshot.discard_pile_size = discard_pile_size;
+    snapshot.pickup_pile_size = pickup_pile_size;
+    memcpy(snapshot.card_positions, card_positions, sizeof(card_positions));
+    
+    snapshot.current_player = current_player;
+    snapshot.state_hash = state_hash;
+    snapshot.rand_state = rand_state;
+    
+    memcpy(snapshot.deck_order, deck_order, sizeof(deck_order));
+    memcpy(snapshot.turn_log, turn_log, sizeof(turn_log));
+    snapshot.num_turns = num_turns;
+}
+
+void blind_poker_table::restore_snapshot(const table_snapshot &snapshot)
+{
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        for(size_t j = 0; j < NUM_CARDS_PER_HAND; j++)
+            players_hands[i][j] = snapshot.players_hands[i][j];
+    
+    memcpy(discard_pile, snapshot.discard_pile, snapshot.discard_pile_size*sizeof(card));
+    memcpy(pickup_pile, snapshot.pickup_pile, snapshot.pickup_pile_size*sizeof(card));
+    discard_pile_size = snapshot.discard_pile_size;
+    pickup_pile_size = snapshot.pickup_pile_size;
+    memcpy(card_positions, snapshot.card_positions, sizeof(card_positions));
+    reset_face_masks();
+    
+    current_player = snapshot.current_player;
+    state_hash = snapshot.state_hash;
+    rand_state = snapshot.rand_state;
+    
+    memcpy(deck_order, snapshot.deck_order, sizeof(deck_order));
+    memcpy(turn_log, snapshot.turn_log, sizeof(turn_log));
+    num_turns = snapshot.num_turns;
+}
+
+void blind_poker_table::save_turn(turn_undo_record &record) const
+{
+    for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
+    {
+        record.hand[i] = players_hands[current_player][i];
+        record.hand_positions[i] = card_positions[record.hand[i].card_id];
+    }
+    
+    record.discard_pile_top = discard_pile[discard_pile_size - 1];
+    record.pickup_pile_top = pickup_pile[pickup_pile_size - 1];
+    record.discard_pile_size = discard_pile_size;
+    record.pickup_pile_size = pickup_pile_size;
+    record.discard_pile_top_position = card_positions[record.discard_pile_top.card_id];
+    record.pickup_pile_top_position = card_positions[record.pickup_pile_top.card_id];
+    
+    record.current_player = current_player;
+    record.state_hash = state_hash;
+    record.rand_state = rand_state;
+    record.num_turns = num_turns;
+}
+
+void blind_poker_table::restore_turn(const turn_undo_record &record)
+{
+    // a turn only moves cards between the hand and the tops of the piles,
+    // and a pile's cards above its old top are no longer in play
+    current_player = record.current_player;
+    discard_pile_size = record.discard_pile_size;
+    pickup_pile_size = record.pickup_pile_size;
+    discard_pile[discard_pile_size - 1] = record.discard_pile_top;
+    pickup_pile[pickup_pile_size - 1] = record.pickup_pile_top;
+    move_card(record.discard_pile_top.card_id, record.discard_pile_top_position);
+    move_card(record.pickup_pile_top.card_id, record.pickup_pile_top_position);
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
+    {
+        players_hands[current_player][i] = record.hand[i];
+        move_card(record.hand[i].card_id, record.hand_positions[i]);
+    }
+    
+    state_hash = record.state_hash;
+    rand_state = record.rand_state;
+    num_turns = record.num_turns;
+}
+
+turn_undo_stack::turn_undo_stack(void)
+{
+    depth = 0;
+}
+
+void turn_undo_stack::push(const blind_poker_table &table)
+{
+    if(depth >= MAX_NUM_TURNS)
+        throw out_of_range("Undo stack is full.");
+    
+    table.save_turn(records[depth++]);
+}
+
+void turn_undo_stack::undo(blind_poker_table &table)
+{
+    if(0 == depth)
+        throw out_of_range("Undo stack is empty.");
+    
+    table.restore_turn(records[--depth]);
+}
+
+void turn_undo_stack::clear(void)
+{
+    depth = 0;
+}
+
+size_t turn_undo_stack::get_depth(void) const
+{
+    return depth;
+}
+
+void blind_poker_table::set_rand_seed(const unsigned long long seed)
+{
+    // xorshift64* can't leave the all zero state
+    rand_state = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+size_t blind_poker_table::get_rand(void)
+{
+    // xorshift64*, a private generator so that tables can run on different threads
+    rand_state ^= rand_state >> 12;
+    rand_state ^= rand_state << 25;
+    rand_state ^= rand_state >> 27;
+    
+    return static_cast<size_t>((rand_state * 0x2545F4914F6CDD1DULL) >> 33);
+}
+
+unsigned long long blind_poker_table::get_state_hash(void) const
+{
+    return state_hash;
+}
+
+void blind_poker_table::set_card_position(const size_t card_id, const size_t new_position)
+{
+    state_hash ^= get_zobrist_key(card_id, card_positions[card_id]) ^ get_zobrist_key(card_id, new_position);
+    move_card(card_id, new_position);
+}
+
+// card_id == (face - FACE_2)*4 + suit
+void blind_poker_table::move_card(const size_t card_id, const size_t new_position)
+{
+    const unsigned short face_bit = static_cast<unsigned short>(1u << (card_id >> 2));
+    
+    face_masks[card_positions[card_id]*(SUIT_CLUBS + 1) + (card_id & 3)] ^= face_bit;
+    face_masks[new_position*(SUIT_CLUBS + 1) + (card_id & 3)] ^= face_bit;
+    
+    card_positions[card_id] = static_cast<unsigned char>(new_position);
+}
+
+void blind_poker_table::reset_face_masks(void)
+{
+    memset(face_masks, 0, sizeof(face_masks));
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        face_masks[card_positions[i]*(SUIT_CLUBS + 1) + (i & 3)] |= static_cast<unsigned short>(1u << (i >> 2));
+}
+
+const unsigned short *blind_poker_table::get_face_masks(void) const
+{
+    return face_masks;
+}
+
+static vector<unsigned long long> make_zobrist_keys(void)
+{
+    // fixed seed splitmix64, so that hashes are the same from run to run
+    vector<unsigned long long> keys(NUM_CARDS_PER_DECK*(POSITION_NOT_SHOWN + 1));
+    unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+    
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        seed += 0x9E3779B97F4A7C15ULL;
+        unsigned long long z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        keys[i] = z ^ (z >> 31);
+    }
+    
+    return keys;
+}
+
+unsigned long long blind_poker_table::get_zobrist_key(const size_t card_id, const size_t position)
+{
+    static const vector<unsigned long long> keys = make_zobrist_keys();
+    
+    return keys[card_id*(POSITION_NOT_SHOWN + 1) + position];
+}
+
+size_t blind_poker_table::get_rand_not_shown_index(const size_t player_index)
 {
     if(player_index >= NUM_PLAYERS)
         return 0;
     
-    vector<size_t> not_shown_positions;
+    size_t not_shown_positions[NUM_CARDS_PER_HAND];
+    size_t num_not_shown = 0;
     
     for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
         if(false == players_hands[player_index][i].shown)
-            not_shown_positions.push_back(i);
+            not_shown_positions[num_not_shown++] = i;
     
-    if(0 == not_shown_positions.size())
+    if(0 == num_not_shown)
         return 0;
     
-    return not_shown_positions[rand() % not_shown_positions.size()];
+    return not_shown_positions[get_rand() % num_not_shown];
 }
 
 size_t blind_poker_table::get_best_rank_finished(void) const
 {
-    size_t best_rank = 0;
-    size_t best_numeric_rank = 0;
-    size_t best_rank_player = 0;
+    vector< vector<size_t> > ranking;
+    get_showdown_ranking(ranking);
+    
+    // on a tie, the first of the winning players
+    return ranking[0][0];
+}
+
+void blind_poker_table::get_showdown_ranking(vector< vector<size_t> > &ranking) const
+{
+    ranking.clear();
+    
+    // evaluate each hand exactly once
+    unsigned int strengths[NUM_PLAYERS];
+    size_t order[NUM_PLAYERS];
     
-    // doesn't deal with ties yet
     for(size_t i = 0; i < NUM_PLAYERS; i++)
     {
-        if(rank_finished_hand(i) >= best_rank)
-        {
-            if(rank_finished_hand(i) == best_rank)
-            {
-                if(numeric_rank_finished_hand(i) <= best_numeric_rank)
-                    continue;
-            }
-            
-            best_rank = rank_finished_hand(i);
-            best_numeric_rank = numeric_rank_finished_hand(i);
-            best_rank_player = i;
-        }
+        strengths[i] = get_hand_strength(i);
+        order[i] = i;
+    }
+    
+    // insertion sort, strongest first, stable so that tied players stay in seat order
+    for(size_t i = 1; i < NUM_PLAYERS; i++)
+    {
+        size_t temp_index = order[i];
+        size_t j = i;
+        
+        for(; j > 0 && strengths[order[j - 1]] < strengths[temp_index]; j--)
+            order[j] = order[j - 1];
+        
+        order[j] = temp_index;
+    }
+    
+    // group tied players, each group splits the pot it wins
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        if(0 == i || strengths[order[i]] != strengths[order[i - 1]])
+            ranking.push_back(vector<size_t>());
+        
+        ranking[ranking.size() - 1].push_back(order[i]);
+    }
+}
+
+unsigned int blind_poker_table::get_hand_strength(const size_t player_index) const
+{
+    size_t faces[NUM_CARDS_PER_HAND];
+    size_t suits[NUM_CARDS_PER_HAND];
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
+    {
+        faces[i] = players_hands[player_index][i].face;
+        suits[i] = players_hands[player_index][i].suit;
     }
     
-    return best_rank_player;
+    return ::get_hand_strength(faces, suits);
 }
 
 size_t blind_poker_table::rank_finished_hand(const size_t player_index) const
@@ -1068,90 +1401,12 @@ bool blind_poker_table::is_finished_hand_high_card(const vector<card> &hand) con
 
 bool blind_poker_table::is_card_not_shown(const size_t card_id) const
 {
-    bool found_card = false;
-    size_t position = POSITION_HAND0;
-    
-    // Check players' hands
-    for(size_t i = 0; i < NUM_PLAYERS; i++)
-    {
-        if(true == found_card)
-            break;
-        
-        // Check all cards in hand
-        for(size_t j = 0; j < NUM_CARDS_PER_HAND; j++)
-        {
-            if(true == found_card)
-                break;
-            
-            if(card_id == players_hands[i][j].card_id)
-            {
-                if(true == players_hands[i][j].shown)
-                {
-                    //cout << "POSITION_HAND0 + " << i << endl;
-                    position = POSITION_HAND0 + i;
-                }
-                else
-                {
-                    //cout << "POSITION_NOT_SHOWN" << endl;
-                    position = POSITION_NOT_SHOWN;
-                }
-                
-                found_card = true;
-            }
-        }
-    }
-    
-    // Check top of discard pile
-    if(false == found_card && card_id == discard_pile[discard_pile.size() - 1].card_id)
-    {
-        //cout << "POSITION_TOP_OF_DISCARD_PILE" << endl;
-        position = POSITION_TOP_OF_DISCARD_PILE;
-        found_card = true;
-    }
-    
-    // Check all except for top discard pile
-    for(size_t i = 0; i < discard_pile.size() - 1; i++)
-    {
-        if(true == found_card)
-            break;
-        
-        if(card_id == discard_pile[i].card_id)
-        {
-            //cout << "POSITION_DISCARD_PILE" << endl;
-            position = POSITION_DISCARD_PILE;
-            found_card = true;
-        }
-    }
-    
-    
-    // check top of pickup pile, if it's shown that is
-    if(false == found_card && true == pickup_pile[pickup_pile.size() - 1].shown && card_id == pickup_pile[pickup_pile.size() - 1].card_id)
-    {
-        //cout << "POSITION_TOP_OF_PICKUP_PILE" << endl;
-        position = POSITION_TOP_OF_PICKUP_PILE;
-        found_card = true;
-    }
-    
-    // if not found by now, it's not shown in the pickup pile
-    if(false == found_card)
-    {
-        //cout << "POSITION_NOT_SHOWN 2" << endl;
-        position = POSITION_NOT_SHOWN;
-    }
-    
-    if(POSITION_NOT_SHOWN == position)
-        return true;
-    else
-        return false;
+    return POSITION_NOT_SHOWN == card_positions[card_id];
 }
 
 size_t blind_poker_table::get_card_id(const size_t face, const size_t suit) const
 {
-    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
-        if(card_id_lookup_helper[i].face == face && card_id_lookup_helper[i].suit == suit)
-            return card_id_lookup_helper[i].card_id;
-    
-    return 0;
+    return (face - FACE_2)*4 + suit;
 }
 
 size_t blind_poker_table::hand_num_shown(const vector<card> &hand) const
@@ -17,10 +17,17 @@ using std::random_shuffle;
 using std::shuffle;
 
 #include "ffbpneuralnet.h"
+#include "hand_evaluator.h"
+#include "decision_cache.h"
+#include "suit_isomorphism.h"
 
 
+// the tables' input encoding until set_input_encoding
 #define USE_ONE_HOT_INPUT_ENCODING
 
+// the networks see each state with its suits relabelled to a canonical order
+#define USE_SUIT_CANONICAL_INPUT_ENCODING
+
 
 #define SUIT_HEARTS 0
 #define SUIT_SPADES 1
@@ -69,6 +76,23 @@ using std::shuffle;
 
 #define MAX_EXTENT_SPREAD_FOR_STRAIGHT 4
 
+#define ACTION_TAKE_DISCARD 0
+#define ACTION_FLIP_AND_DISCARD 1
+#define ACTION_FLIP_AND_KEEP 2
+#define NUM_ACTIONS 3
+
+#define MAX_NUM_TURNS (NUM_PLAYERS*NUM_CARDS_PER_HAND)
+
+// network input encodings of the card positions
+#define INPUT_ENCODING_BINARY 0     // 4 inputs per card, the position in binary
+#define INPUT_ENCODING_ONE_HOT 1    // 9 inputs per card, one per position
+
+#ifdef USE_ONE_HOT_INPUT_ENCODING
+#define DEFAULT_INPUT_ENCODING INPUT_ENCODING_ONE_HOT
+#else
+#define DEFAULT_INPUT_ENCODING INPUT_ENCODING_BINARY
+#endif
+
 
 
 class card
@@ -92,23 +116,134 @@ public:
     vector<double> output;
 };
 
+// the whole game state of a blind_poker_table, plain data of a fixed size,
+// so saving and restoring one never allocates
+class table_snapshot
+{
+public:
+    
+    card players_hands[NUM_PLAYERS][NUM_CARDS_PER_HAND];
+    card discard_pile[NUM_CARDS_PER_DECK];
+    size_t discard_pile_size;
+    card pickup_pile[NUM_CARDS_PER_DECK];
+    size_t pickup_pile_size;
+    unsigned char card_positions[NUM_CARDS_PER_DECK];
+    
+    size_t current_player;
+    unsigned long long state_hash;
+    unsigned long long rand_state;
+    
+    unsigned char deck_order[NUM_CARDS_PER_DECK];
+    unsigned char turn_log[MAX_NUM_TURNS];
+    size_t num_turns;
+};
+
+// what one turn can change: the player's hand and the tops of both piles
+class turn_undo_record
+{
+public:
+    
+    card hand[NUM_CARDS_PER_HAND];
+    card discard_pile_top;
+    card pickup_pile_top;
+    size_t discard_pile_size;
+    size_t pickup_pile_size;
+    
+    unsigned char hand_positions[NUM_CARDS_PER_HAND];
+    unsigned char discard_pile_top_position;
+    unsigned char pickup_pile_top_position;
+    
+    size_t current_player;
+    unsigned long long state_hash;
+    unsigned long long rand_state;
+    size_t num_turns;
+};
+
 class blind_poker_table
 {
 public:
 
     blind_poker_table(void);
     void reset_table(void);
+    void reset_table(const unsigned char *const src_deck_order);
     void print_table(void) const;
     void print_sorted_hand(const size_t player_index) const;
+    size_t get_current_player(void) const;
+    bool is_game_over(void) const;
+    
+    // reshuffle the cards nobody has seen, giving a game consistent with what is shown
+    void randomise_unseen_cards(void);
+    void set_rand_seed(const unsigned long long seed);
+    
+    // branching for search and rollouts, without copying the table
+    void save_snapshot(table_snapshot &snapshot) const;
+    void restore_snapshot(const table_snapshot &snapshot);
+    
+    // what the current player's turn can change, before its decisions, and
+    // the table taken back to it; see turn_undo_stack
+    void save_turn(turn_undo_record &record) const;
+    void restore_turn(const turn_undo_record &record);
+    
     void get_card_states(vector<double> &states) const;
+    void get_card_positions(unsigned char *const positions) const;
+    unsigned long long get_state_hash(void) const;
+    
+    // [position*(SUIT_CLUBS + 1) + suit], bit face - FACE_2 set for each card
+    // there, kept up to date with the positions, for the feature encoder
+    const unsigned short *get_face_masks(void) const;
+    
+    // the same, for the representative of the state under the 24 suit permutations
+    void get_canonical_card_states(vector<double> &states) const;
+    unsigned long long get_canonical_state_hash(void) const;
+    
+    static void encode_card_positions(const unsigned char *const positions, vector<double> &states, const size_t encoding = DEFAULT_INPUT_ENCODING);
+    static void decode_card_states(const vector<double> &states, unsigned char *const positions);
+    
+    // INPUT_ENCODING_*, used by get_card_states and get_ANN_input
+    void set_input_encoding(const size_t encoding);
+    size_t get_input_encoding(void) const;
+    static size_t get_input_encoding_size(const size_t encoding);
+    
+    // the INPUT_ENCODING_* of a network with num_inputs inputs, and whether the
+    // engineered features follow the card states; out_of_range if none fits
+    static size_t get_input_encoding_for_size(const size_t num_inputs, bool &engineered_features);
     
     size_t get_best_rank_finished(void) const;
+    void get_showdown_ranking(vector< vector<size_t> > &ranking) const;
+    unsigned int get_hand_strength(const size_t player_index) const;
     void print_finished_rank(const size_t player_index) const;
     size_t rank_finished_hand(const size_t player_index) const;
     size_t numeric_rank_finished_hand(const size_t player_index) const;
     
     void play_rand(void);
-    void play_ANN(vector<input_output_pair> &io, FFBPNeuralNet &NNet);
+    void play_action(const size_t action);
+    void play_ANN(vector<input_output_pair> &io, FFBPNeuralNet &NNet, decision_cache *const cache = 0);
+    
+    // one of play_ANN's decisions, for callers that run the network themselves
+    // (e.g. batched over many tables); true if the top of the pickup pile was
+    // flipped and a second decision is needed for this turn
+    bool play_ANN_decision(const double output);
+    
+    // game records: the deck as dealt from, bottom card first, and one byte per
+    // turn, the ACTION_* in bits 0..1 and the hand index in bits 2..4
+    void get_deck_order(unsigned char *const src_deck_order) const;
+    size_t get_num_turns(void) const;
+    unsigned char get_turn(const size_t turn_index) const;
+    
+    // replays a recorded turn, storing the samples play_ANN would have stored,
+    // with NNet's inputs (see get_ANN_input) if there is one
+    void play_recorded_turn(const unsigned char turn, vector<input_output_pair> &io, const FFBPNeuralNet *const NNet = 0);
+    void get_ANN_input(vector<double> &input) const;
+    
+    // the input for NNet, in the encoding it was built for, with the engineered
+    // features (see feature_encoder.h) when the network has room for them
+    void get_ANN_input(vector<double> &input, const FFBPNeuralNet &NNet) const;
+    
+    // the network input for a position array from get_card_positions, for callers without a table
+    static void encode_ANN_input(const unsigned char *const positions, vector<double> &input, const size_t encoding = DEFAULT_INPUT_ENCODING);
+    
+    // the same, as NNet was built, like get_ANN_input(input, NNet)
+    static void encode_ANN_input(const unsigned char *const positions, vector<double> &input, const FFBPNeuralNet &NNet);
 
     
 protected:
@@ -118,7 +253,25 @@ protected:
     
     void swap_cards(card &a, card &b);
     
-    size_t get_rand_not_shown_index(const size_t player_index) const;
+    unsigned long long get_ANN_input_hash(void) const;
+    void get_ANN_output(const vector<double> &input, FFBPNeuralNet &NNet, decision_cache *const cache, vector<double> &output);
+    
+    // moves, each keeps card_positions and state_hash up to date
+    void take_top_of_discard_pile(const size_t hand_index);
+    void flip_top_of_pickup_pile(void);
+    void discard_top_of_pickup_pile(const size_t hand_index);
+    void keep_top_of_pickup_pile(const size_t hand_index);
+    void next_player(void);
+    void deal_cards(void);
+    void log_turn(const size_t action, const size_t hand_index);
+    
+    void set_card_position(const size_t card_id, const size_t new_position);
+    void move_card(const size_t card_id, const size_t new_position);
+    void reset_face_masks(void);
+    static unsigned long long get_zobrist_key(const size_t card_id, const size_t position);
+    
+    size_t get_rand(void);
+    size_t get_rand_not_shown_index(const size_t player_index);
     
     bool is_finished_hand_royal_flush(const vector<card> &hand) const;
     bool is_finished_hand_straight_flush(const vector<card> &hand) const;
@@ -144,10 +297,50 @@ protected:
     
     size_t current_player;
     vector< vector < card > > players_hands;
-    vector<card> discard_pile;
-    vector<card> pickup_pile;
     
-    vector<card> card_id_lookup_helper;
+    // both piles are bottom card first, the top card is at [size - 1]
+    card discard_pile[NUM_CARDS_PER_DECK];
+    size_t discard_pile_size;
+    card pickup_pile[NUM_CARDS_PER_DECK];
+    size_t pickup_pile_size;
+    
+    // every card's encoded position, see get_card_positions
+    unsigned char card_positions[NUM_CARDS_PER_DECK];
+    unsigned short face_masks[(POSITION_NOT_SHOWN + 1)*(SUIT_CLUBS + 1)];
+    
+    // Zobrist hash of card_positions
+    unsigned long long state_hash;
+    
+    unsigned long long rand_state;
+    
+    size_t input_encoding;
+    
+    unsigned char deck_order[NUM_CARDS_PER_DECK];
+    unsigned char turn_log[MAX_NUM_TURNS];
+    size_t num_turns;
+};
+
+// An undo stack of turns for lookahead: push before a turn's decisions, and
+// undo takes the table back to the last push. It's kept by the caller rather
+// than the table, so that tables stay cheap to copy. The records are only good
+// for the game they were pushed from, so clear it after dealing or restoring
+// a snapshot.
+class turn_undo_stack
+{
+public:
+    
+    turn_undo_stack(void);
+    
+    void push(const blind_poker_table &table);
+    void undo(blind_poker_table &table);
+    void clear(void);
+    size_t get_depth(void) const;
+    
+protected:
+    
+    // a game has at most MAX_NUM_TURNS turns to undo
+    turn_undo_record records[MAX_NUM_TURNS];
+    size_t depth;
 };
 
 
@@ -0,0 +1,768 @@
+#include "cfr_solver.h"
+
+#include <fstream>
+using std::ifstream;
+using std::ofstream;
+
+#include <ios>
+using std::ios;
+
+#include <stdexcept>
+using std::runtime_error;
+using std::out_of_range;
+
+#include <thread>
+using std::thread;
+
+#include <functional>
+
+#include <string>
+using std::string;
+
+#include <cstring>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+static const unsigned char cfr_checkpoint_header[8] = { 'B', 'P', 'C', 'R', CFR_CHECKPOINT_VERSION, NUM_PLAYERS, CFR_NUM_ACTIONS, 0 };
+
+
+// splitmix64, so that nearby iteration numbers give unrelated seeds
+static unsigned long long mix_seed(const unsigned long long seed, const unsigned long long index)
+{
+    unsigned long long z = seed + 0x9E3779B97F4A7C15ULL*(index + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// xorshift64*, uniform in [0, 1)
+static double get_rand_unit(unsigned long long &rand_state)
+{
+    rand_state ^= rand_state >> 12;
+    rand_state ^= rand_state << 25;
+    rand_state ^= rand_state >> 27;
+    
+    return static_cast<double>((rand_state * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+}
+
+static size_t sample_action(const double *const strategy, unsigned long long &rand_state)
+{
+    return (get_rand_unit(rand_state) < strategy[0]) ? 0 : 1;
+}
+
+// the player's share of the pot, split between the best hands
+static double get_pot_share(const blind_poker_table &table, const size_t player_index)
+{
+    unsigned int strengths[NUM_PLAYERS];
+    unsigned int best_strength = 0;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        strengths[i] = table.get_hand_strength(i);
+        
+        if(strengths[i] > best_strength)
+            best_strength = strengths[i];
+    }
+    
+    if(strengths[player_index] != best_strength)
+        return 0.0;
+    
+    size_t num_winners = 0;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        if(strengths[i] == best_strength)
+            num_winners++;
+    
+    return 1.0 / num_winners;
+}
+
+
+cfr_solver::cfr_solver(const size_t src_num_slots_log2, const size_t src_num_shards_log2, const size_t src_num_threads)
+{
+    set_size(src_num_slots_log2, src_num_shards_log2);
+    
+    num_threads = src_num_threads;
+    
+    if(0 == num_threads)
+        num_threads = thread::hardware_concurrency();
+    
+    if(0 == num_threads)
+        num_threads = 1;
+}
+
+void cfr_solver::set_size(const size_t src_num_slots_log2, const size_t src_num_shards_log2)
+{
+    if(src_num_slots_log2 < 4 || src_num_slots_log2 > 30 || src_num_shards_log2 > src_num_slots_log2 - 4)
+        throw out_of_range("Invalid CFR table size.");
+    
+    num_slots_log2 = src_num_slots_log2;
+    num_shards_log2 = src_num_shards_log2;
+    
+    const size_t num_slots = static_cast<size_t>(1) << num_slots_log2;
+    
+    keys.assign(num_slots, 0);
+    regrets.assign(num_slots*CFR_NUM_ACTIONS, 0.0f);
+    strategy_sums.assign(num_slots*CFR_NUM_ACTIONS, 0.0f);
+    
+    // mutexes can't be moved, so make a new vector rather than resizing
+    vector<mutex> temp_locks(static_cast<size_t>(1) << num_shards_log2);
+    shard_locks.swap(temp_locks);
+    
+    num_iterations.store(0);
+    num_info_sets.store(0);
+}
+
+unsigned long long cfr_solver::get_info_set_key(const unsigned char *const positions, const size_t player_index)
+{
+    size_t faces[NUM_CARDS_PER_HAND + 1];
+    size_t suits[NUM_CARDS_PER_HAND + 1];
+    size_t num_shown = 0;
+    size_t offered_card = 0;
+    size_t decision = 0;
+    
+    // the player's shown cards, and the card on offer: the top of the
+    // discard pile, or the top of the pickup pile once it's been flipped
+    for(size_t card_id = 0; card_id < NUM_CARDS_PER_DECK; card_id++)
+    {
+        if(POSITION_HAND0 + player_index == positions[card_id] && num_shown < NUM_CARDS_PER_HAND)
+        {
+            faces[num_shown] = card_id/4 + FACE_2;
+            suits[num_shown] = card_id%4;
+            num_shown++;
+        }
+        else if(POSITION_TOP_OF_PICKUP_PILE == positions[card_id])
+        {
+            offered_card = card_id;
+            decision = 1;
+        }
+        else if(POSITION_TOP_OF_DISCARD_PILE == positions[card_id] && 0 == decision)
+        {
+            offered_card = card_id;
+        }
+    }
+    
+    const size_t offered_face = offered_card/4 + FACE_2;
+    const size_t offered_suit = offered_card%4;
+    
+    // pairs among the shown cards: 0 none, 1 a pair, 2 two pair, 3 three of a kind or more
+    size_t num_pairs = 0, max_multiple = 1;
+    
+    for(size_t i = 0; i < num_shown; i++)
+    {
+        size_t multiple = 1;
+        
+        for(size_t j = 0; j < num_shown; j++)
+            if(i != j && faces[i] == faces[j])
+                multiple++;
+        
+        if(multiple > max_multiple)
+            max_multiple = multiple;
+        
+        if(2 == multiple)
+            num_pairs++;
+    }
+    
+    num_pairs /= 2;
+    
+    size_t made = num_pairs;
+    
+    if(max_multiple >= 3)
+        made = 3;
+    
+    size_t num_matches = 0;
+    size_t flush_open = 1;
+    
+    for(size_t i = 0; i < num_shown; i++)
+    {
+        if(faces[i] == offered_face)
+            num_matches++;
+        
+        if(suits[i] != offered_suit)
+            flush_open = 0;
+    }
+    
+    // a straight is open if the faces are distinct and fit in a span of 5, the ace high or low
+    faces[num_shown] = offered_face;
+    
+    size_t straight_open = (0 == num_matches && 0 == made) ? 1 : 0;
+    
+    if(1 == straight_open)
+    {
+        size_t high_min = FACE_A, high_max = FACE_A_LOW, low_min = FACE_A, low_max = FACE_A_LOW;
+        
+        for(size_t i = 0; i <= num_shown; i++)
+        {
+            const size_t low_face = (FACE_A == faces[i]) ? FACE_A_LOW : faces[i];
+            
+            high_min = (faces[i] < high_min) ? faces[i] : high_min;
+            high_max = (faces[i] > high_max) ? faces[i] : high_max;
+            low_min = (low_face < low_min) ? low_face : low_min;
+            low_max = (low_face > low_max) ? low_face : low_max;
+        }
+        
+        if(high_max - high_min > MAX_EXTENT_SPREAD_FOR_STRAIGHT && low_max - low_min > MAX_EXTENT_SPREAD_FOR_STRAIGHT)
+            straight_open = 0;
+    }
+    
+    // 2 - 5, 6 - 9, 10 - K, A
+    const size_t face_bucket = (offered_face - FACE_2)/4;
+    
+    // the top bit keeps every key away from 0, the empty slot
+    return (static_cast<unsigned long long>(1) << 63) |
+           decision |
+           (num_shown << 1) |
+           (made << 4) |
+           (num_matches << 6) |
+           (flush_open << 8) |
+           (straight_open << 9) |
+           (face_bucket << 10) |
+           (player_index << 12);
+}
+
+size_t cfr_solver::get_shard(const unsigned long long key) const
+{
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - num_slots_log2)) >> (num_slots_log2 - num_shards_log2);
+}
+
+size_t cfr_solver::find_slot(const unsigned long long key) const
+{
+    const size_t num_slots = keys.size();
+    const size_t shard_mask = (static_cast<size_t>(1) << (num_slots_log2 - num_shards_log2)) - 1;
+    const size_t home = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - num_slots_log2));
+    const size_t shard_base = home & ~shard_mask;
+    
+    // linear probing, wrapping within the shard
+    for(size_t i = 0; i <= shard_mask; i++)
+    {
+        const size_t slot = shard_base + ((home + i) & shard_mask);
+        
+        if(key == keys[slot])
+            return slot;
+        
+        if(0 == keys[slot])
+            return num_slots;
+    }
+    
+    return num_slots;
+}
+
+size_t cfr_solver::add_slot(const unsigned long long key)
+{
+    const size_t shard_mask = (static_cast<size_t>(1) << (num_slots_log2 - num_shards_log2)) - 1;
+    const size_t home = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - num_slots_log2));
+    const size_t shard_base = home & ~shard_mask;
+    
+    for(size_t i = 0; i <= shard_mask; i++)
+    {
+        const size_t slot = shard_base + ((home + i) & shard_mask);
+        
+        if(key == keys[slot])
+            return slot;
+        
+        if(0 == keys[slot])
+        {
+            keys[slot] = key;
+            num_info_sets.fetch_add(1);
+            return slot;
+        }
+    }
+    
+    throw runtime_error("CFR table shard is full.");
+}
+
+void cfr_solver::get_current_strategy(const unsigned long long key, double *const strategy)
+{
+    double positive_regrets[CFR_NUM_ACTIONS];
+    
+    {
+        std::lock_guard<mutex> lock(shard_locks[get_shard(key)]);
+        
+        const size_t slot = add_slot(key);
+        
+        for(size_t i = 0; i < CFR_NUM_ACTIONS; i++)
+            positive_regrets[i] = regrets[slot*CFR_NUM_ACTIONS + i];
+    }
+    
+    // regret matching, the regrets are never below zero
+    double sum = 0;
+    
+    for(size_t i = 0; i < CFR_NUM_ACTIONS; i++)
+        sum += positive_regrets[i];
+    
+    for(size_t i = 0; i < CFR_NUM_ACTIONS; i++)
+        strategy[i] = (sum > 0) ? positive_regrets[i] / sum : 1.0 / CFR_NUM_ACTIONS;
+}
+
+void cfr_solver::get_average_strategy(const unsigned long long key, double *const strategy) const
+{
+    double sums[CFR_NUM_ACTIONS] = { 0 };
+    
+    {
+        std::lock_guard<mutex> lock(shard_locks[get_shard(key)]);
+        
+        const size_t slot = find_slot(key);
+        
+        if(slot < keys.size())
+            for(size_t i = 0; i < CFR_NUM_ACTIONS; i++)
+                sums[i] = strategy_sums[slot*CFR_NUM_ACTIONS + i];
+    }
+    
+    double sum = 0;
+    
+    for(size_t i = 0; i < CFR_NUM_ACTIONS; i++)
+        sum += sums[i];
+    
+    // uniform for an info set that was never reached
+    for(size_t i = 0; i < CFR_NUM_ACTIONS; i++)
+        strategy[i] = (sum > 0) ? sums[i] / sum : 1.0 / CFR_NUM_ACTIONS;
+}
+
+void cfr_solver::get_average_strategy(const blind_poker_table &table, double *const strategy) const
+{
+    unsigned char positions[NUM_CARDS_PER_DECK];
+    table.get_card_positions(positions);
+    
+    get_average_strategy(get_info_set_key(positions, table.get_current_player()), strategy);
+}
+
+bool cfr_solver::play_decision(blind_poker_table &table, unsigned long long &rand_state) const
+{
+    double strategy[CFR_NUM_ACTIONS];
+    get_average_strategy(table, strategy);
+    
+    return table.play_ANN_decision(static_cast<double>(sample_action(strategy, rand_state)));
+}
+
+double cfr_solver::traverse(blind_poker_table &table, const size_t traverser, const float weight, unsigned long long &rand_state)
+{
+    if(true == table.is_game_over())
+        return get_pot_share(table, traverser);
+    
+    unsigned char positions[NUM_CARDS_PER_DECK];
+    table.get_card_positions(positions);
+    
+    const size_t player_index = table.get_current_player();
+    const unsigned long long key = get_info_set_key(positions, player_index);
+    
+    double strategy[CFR_NUM_ACTIONS];
+    get_current_strategy(key, strategy);
+    
+    // the other seats sample one action, and add their strategy to the average
+    if(player_index != traverser)
+    {
+        {
+            std::lock_guard<mutex> lock(shard_locks[get_shard(key)]);
+            
+            const size_t slot = add_slot(key);
+            
+            for(size_t i = 0; i < CFR_NUM_ACTIONS; i++)
+                strategy_sums[slot*CFR_NUM_ACTIONS + i] += weight*static_cast<float>(strategy[i]);
+        }
+        
+        table.play_ANN_decision(static_cast<double>(sample_action(strategy, rand_state)));
+        
+        return traverse(table, traverser, weight, rand_state);
+    }
+    
+    // the traverser tries every action from the same state
+    table_snapshot snapshot;
+    table.save_snapshot(snapshot);
+    
+    double values[CFR_NUM_ACTIONS];
+    double node_value = 0;
+    
+    for(size_t i = 0; i < CFR_NUM_ACTIONS; i++)
+    {
+        if(0 != i)
+            table.restore_snapshot(snapshot);
+        
+        table.play_ANN_decision(static_cast<double>(i));
+        values[i] = traverse(table, traverser, weight, rand_state);
+        node_value += strategy[i]*values[i];
+    }
+    
+    // regret matching+: the regrets are floored at zero
+    {
+        std::lock_guard<mutex> lock(shard_locks[get_shard(key)]);
+        
+        const size_t slot = add_slot(key);
+        
+        for(size_t i = 0; i < CFR_NUM_ACTIONS; i++)
+        {
+            const float regret = regrets[slot*CFR_NUM_ACTIONS + i] + static_cast<float>(values[i] - node_value);
+            regrets[slot*CFR_NUM_ACTIONS + i] = (regret > 0.0f) ? regret : 0.0f;
+        }
+    }
+    
+    return node_value;
+}
+
+void cfr_solver::iteration_thread(const size_t last_iteration, const unsigned long long seed)
+{
+    blind_poker_table table;
+    
+    while(true)
+    {
+        const size_t iteration = next_iteration.fetch_add(1);
+        
+        if(iteration >= last_iteration)
+            break;
+        
+        // the deal and the samples depend only on the iteration
+        unsigned long long rand_state = mix_seed(seed, iteration) | 1;
+        
+        table.set_rand_seed(mix_seed(seed ^ 0x5DEECE66DULL, iteration));
+        table.reset_table();
+        
+        // linear averaging, later iterations count for more
+        traverse(table, iteration % NUM_PLAYERS, static_cast<float>(iteration + 1), rand_state);
+        
+        num_iterations.fetch_add(1);
+    }
+}
+
+void cfr_solver::run(const size_t num_new_iterations, const unsigned long long seed)
+{
+    const size_t last_iteration = num_iterations.load() + num_new_iterations;
+    
+    next_iteration.store(num_iterations.load());
+    
+    vector<thread> threads;
+    
+    for(size_t i = 1; i < num_threads; i++)
+        threads.push_back(thread(&cfr_solver::iteration_thread, this, last_iteration, seed));
+    
+    iteration_thread(last_iteration, seed);
+    
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+void cfr_solver::exploitability_thread(const size_t first_game, const size_t game_step, const size_t num_games, const unsigned long long seed, map<unsigned long long, vector<double> > &gains) const
+{
+    blind_poker_table table;
+    
+    for(size_t i = first_game; i < num_games; i += game_step)
+    {
+        const size_t deviator = i % NUM_PLAYERS;
+        unsigned long long rand_state = mix_seed(seed, i) | 1;
+        
+        table.set_rand_seed(mix_seed(seed ^ 0x5DEECE66DULL, i));
+        table.reset_table();
+        
+        while(false == table.is_game_over())
+        {
+            if(deviator != table.get_current_player())
+            {
+                play_decision(table, rand_state);
+                continue;
+            }
+            
+            unsigned char positions[NUM_CARDS_PER_DECK];
+            table.get_card_positions(positions);
+            
+            const unsigned long long key = get_info_set_key(positions, deviator);
+            
+            // the value of each action, the rest of the game played by the
+            // average strategy with the same random numbers for both
+            table_snapshot snapshot;
+            table.save_snapshot(snapshot);
+            
+            const unsigned long long playout_rand_state = mix_seed(rand_state, 0) | 1;
+            
+            // even and odd games are summed apart, see estimate_exploitability
+            vector<double> &all_sums = gains[key];
+            all_sums.resize(2*CFR_NUM_ACTIONS, 0.0);
+            
+            double *const sums = &all_sums[(i/NUM_PLAYERS % 2)*CFR_NUM_ACTIONS];
+            
+            for(size_t j = 0; j < CFR_NUM_ACTIONS; j++)
+            {
+                unsigned long long temp_rand_state = playout_rand_state;
+                
+                table.restore_snapshot(snapshot);
+                table.play_ANN_decision(static_cast<double>(j));
+                
+                while(false == table.is_game_over())
+                    play_decision(table, temp_rand_state);
+                
+                sums[j] += get_pot_share(table, deviator);
+            }
+            
+            // carry on along the average strategy
+            table.restore_snapshot(snapshot);
+            play_decision(table, rand_state);
+        }
+    }
+}
+
+double cfr_solver::estimate_exploitability(const size_t num_games, const unsigned long long seed) const
+{
+    size_t temp_num_threads = num_threads < num_games ? num_threads : num_games;
+    
+    if(0 == temp_num_threads)
+        return 0;
+    
+    // per info set: the summed value of each action, over the even and the odd games
+    vector< map<unsigned long long, vector<double> > > gains(temp_num_threads);
+    vector<thread> threads;
+    
+    for(size_t i = 1; i < temp_num_threads; i++)
+        threads.push_back(thread(&cfr_solver::exploitability_thread, this, i, temp_num_threads, num_games, seed, std::ref(gains[i])));
+    
+    exploitability_thread(0, temp_num_threads, num_games, seed, gains[0]);
+    
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    
+    for(size_t i = 1; i < temp_num_threads; i++)
+    {
+        for(map<unsigned long long, vector<double> >::const_iterator ci = gains[i].begin(); ci != gains[i].end(); ci++)
+        {
+            vector<double> &sums = gains[0][ci->first];
+            sums.resize(2*CFR_NUM_ACTIONS, 0.0);
+            
+            for(size_t j = 0; j < 2*CFR_NUM_ACTIONS; j++)
+                sums[j] += ci->second[j];
+        }
+    }
+    
+    // each info set switches to its best action; the best action on the
+    // even games is valued on the odd games and the other way around, as the
+    // best of a few noisy sums would overstate the gain
+    double total_gain = 0;
+    
+    for(map<unsigned long long, vector<double> >::const_iterator ci = gains[0].begin(); ci != gains[0].end(); ci++)
+    {
+        double strategy[CFR_NUM_ACTIONS];
+        get_average_strategy(ci->first, strategy);
+        
+        for(size_t j = 0; j < 2; j++)
+        {
+            const double *const sums = &ci->second[j*CFR_NUM_ACTIONS];
+            const double *const other_sums = &ci->second[(1 - j)*CFR_NUM_ACTIONS];
+            
+            size_t best_action = 0;
+            double strategy_value = 0;
+            
+            for(size_t k = 0; k < CFR_NUM_ACTIONS; k++)
+            {
+                if(other_sums[k] > other_sums[best_action])
+                    best_action = k;
+                
+                strategy_value += strategy[k]*sums[k];
+            }
+            
+            total_gain += sums[best_action] - strategy_value;
+        }
+    }
+    
+    // every game has one deviating seat, so this is the mean over the seats
+    return total_gain / num_games;
+}
+
+size_t cfr_solver::get_num_iterations(void) const
+{
+    return num_iterations.load();
+}
+
+size_t cfr_solver::get_num_info_sets(void) const
+{
+    return num_info_sets.load();
+}
+
+void cfr_solver::save_checkpoint(const char *const filename) const
+{
+    const size_t num_slots = keys.size();
+    const size_t file_size = CFR_CHECKPOINT_HEADER_SIZE + num_slots*sizeof(unsigned long long) + 2*num_slots*CFR_NUM_ACTIONS*sizeof(float);
+    
+    unsigned char header[CFR_CHECKPOINT_HEADER_SIZE];
+    const unsigned int sizes[2] = { static_cast<unsigned int>(num_slots_log2), static_cast<unsigned int>(num_shards_log2) };
+    const unsigned long long counts[2] = { static_cast<unsigned long long>(num_iterations.load()), static_cast<unsigned long long>(num_info_sets.load()) };
+    
+    memcpy(header, cfr_checkpoint_header, sizeof(cfr_checkpoint_header));
+    memcpy(header + 8, sizes, sizeof(sizes));
+    memcpy(header + 16, counts, sizeof(counts));
+    
+    // written beside the old checkpoint and renamed over it, so a crash leaves one or the other
+    const string temp_filename = string(filename) + ".tmp";
+    
+#ifndef _WIN32
+    
+    int fd = open(temp_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    
+    if(-1 == fd)
+        throw runtime_error("Error opening file.");
+    
+    if(0 != ftruncate(fd, static_cast<off_t>(file_size)))
+    {
+        close(fd);
+        throw runtime_error("Error writing to file.");
+    }
+    
+    void *temp_data = mmap(0, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    
+    if(MAP_FAILED == temp_data)
+        throw runtime_error("Error writing to file.");
+    
+    unsigned char *data = static_cast<unsigned char *>(temp_data);
+    
+    memcpy(data, header, CFR_CHECKPOINT_HEADER_SIZE);
+    data += CFR_CHECKPOINT_HEADER_SIZE;
+    memcpy(data, &keys[0], num_slots*sizeof(unsigned long long));
+    data += num_slots*sizeof(unsigned long long);
+    memcpy(data, &regrets[0], num_slots*CFR_NUM_ACTIONS*sizeof(float));
+    data += num_slots*CFR_NUM_ACTIONS*sizeof(float);
+    memcpy(data, &strategy_sums[0], num_slots*CFR_NUM_ACTIONS*sizeof(float));
+    
+    const bool synced = (0 == msync(temp_data, file_size, MS_SYNC));
+    munmap(temp_data, file_size);
+    
+    if(false == synced)
+        throw runtime_error("Error writing to file.");
+    
+#else
+    
+    ofstream out(temp_filename.c_str(), ios::binary);
+    
+    if(out.fail())
+        throw runtime_error("Error opening file.");
+    
+    out.write((const char *)header, CFR_CHECKPOINT_HEADER_SIZE);
+    out.write((const char *)&keys[0], num_slots*sizeof(unsigned long long));
+    out.write((const char *)&regrets[0], num_slots*CFR_NUM_ACTIONS*sizeof(float));
+    out.write((const char *)&strategy_sums[0], num_slots*CFR_NUM_ACTIONS*sizeof(float));
+    out.close();
+    
+    if(out.fail())
+        throw runtime_error("Error writing to file.");
+    
+    remove(filename);
+    
+#endif
+    
+    if(0 != rename(temp_filename.c_str(), filename))
+        throw runtime_error("Error writing to file.");
+}
+
+void cfr_solver::load_checkpoint(const char *const filename)
+{
+    vector<unsigned char> file_data;
+    const unsigned char *data = 0;
+    size_t data_size = 0;
+    
+#ifndef _WIN32
+    
+    void *mapped_data = MAP_FAILED;
+    
+    int fd = open(filename, O_RDONLY);
+    
+    if(-1 == fd)
+        throw runtime_error("Error opening file.");
+    
+    struct stat file_stat;
+    
+    if(0 == fstat(fd, &file_stat) && S_ISREG(file_stat.st_mode) && file_stat.st_size >= CFR_CHECKPOINT_HEADER_SIZE)
+    {
+        // read once, front to back
+        mapped_data = mmap(0, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        
+        if(MAP_FAILED != mapped_data)
+        {
+            madvise(mapped_data, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+            
+            data = static_cast<const unsigned char *>(mapped_data);
+            data_size = static_cast<size_t>(file_stat.st_size);
+        }
+    }
+    
+    close(fd);
+    
+#endif
+    
+    // fall back to reading the whole file
+    if(0 == data)
+    {
+        ifstream in(filename, ios::binary);
+        
+        if(in.fail())
+            throw runtime_error("Error opening file.");
+        
+        in.seekg(0, ios::end);
+        file_data.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0, ios::beg);
+        
+        if(file_data.size() < CFR_CHECKPOINT_HEADER_SIZE)
+            throw runtime_error("Error reading from file.");
+        
+        in.read((char *)&file_data[0], file_data.size());
+        
+        if(in.fail())
+            throw runtime_error("Error reading from file.");
+        
+        data = &file_data[0];
+        data_size = file_data.size();
+    }
+    
+    try
+    {
+        if(0 != memcmp(data, cfr_checkpoint_header, 4))
+            throw runtime_error("Not a CFR checkpoint file.");
+        
+        if(0 != memcmp(data, cfr_checkpoint_header, sizeof(cfr_checkpoint_header)))
+            throw runtime_error("CFR checkpoint file is for a different version or game size.");
+        
+        unsigned int sizes[2] = { 0, 0 };
+        unsigned long long counts[2] = { 0, 0 };
+        
+        memcpy(sizes, data + 8, sizeof(sizes));
+        memcpy(counts, data + 16, sizeof(counts));
+        
+        if(sizes[0] > 30)
+            throw runtime_error("Error reading from file.");
+        
+        const size_t num_slots = static_cast<size_t>(1) << sizes[0];
+        
+        if(data_size != CFR_CHECKPOINT_HEADER_SIZE + num_slots*sizeof(unsigned long long) + 2*num_slots*CFR_NUM_ACTIONS*sizeof(float))
+            throw runtime_error("Error reading from file.");
+        
+        set_size(sizes[0], sizes[1]);
+        
+        const unsigned char *temp_data = data + CFR_CHECKPOINT_HEADER_SIZE;
+        
+        memcpy(&keys[0], temp_data, num_slots*sizeof(unsigned long long));
+        temp_data += num_slots*sizeof(unsigned long long);
+        memcpy(&regrets[0], temp_data, num_slots*CFR_NUM_ACTIONS*sizeof(float));
+        temp_data += num_slots*CFR_NUM_ACTIONS*sizeof(float);
+        memcpy(&strategy_sums[0], temp_data, num_slots*CFR_NUM_ACTIONS*sizeof(float));
+        
+        num_iterations.store(static_cast<size_t>(counts[0]));
+        num_info_sets.store(static_cast<size_t>(counts[1]));
+    }
+    catch(...)
+    {
+#ifndef _WIN32
+        
+        if(MAP_FAILED != mapped_data)
+            munmap(mapped_data, data_size);
+        
+#endif
+        
+        throw;
+    }
+    
+#ifndef _WIN32
+    
+    if(MAP_FAILED != mapped_data)
+        munmap(mapped_data, data_size);
+    
+#endif
+}
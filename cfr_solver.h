@@ -0,0 +1,114 @@
+#ifndef CFR_SOLVER_H
+#define CFR_SOLVER_H
+
+
+#include "cards.h"
+
+#include <mutex>
+using std::mutex;
+
+#include <atomic>
+using std::atomic;
+
+
+// two choices at every decision, as play_ANN_decision's output: 0 takes the
+// top of the discard pile (or discards the flipped card), 1 flips the top of
+// the pickup pile (or keeps the flipped card)
+#define CFR_NUM_ACTIONS 2
+
+#define CFR_CHECKPOINT_HEADER_SIZE 32
+#define CFR_CHECKPOINT_VERSION 1
+
+
+// Monte Carlo CFR+ on an abstraction of blind poker, played out on
+// blind_poker_table with snapshots.
+//
+// An info set is abstracted to what the player to move knows about its own
+// hand and the card on offer: which decision it is, how many of its cards are
+// shown, the pairs among them, how many of them match the offered card's face,
+// whether a flush or a straight is still open with the offered card, a bucket
+// of the offered card's face, and the seat. Suits are only ever compared, so
+// the key is the same for every relabelling of the suits.
+//
+// Each iteration deals a game and runs an external sampling traversal for one
+// seat, the seats taking turns. Regrets are floored at zero (regret matching+)
+// and the average strategy is weighted by the iteration number.
+//
+// The regrets and strategy sums are flat float arrays, a slot per info set,
+// found by open addressing on a hash of the key. The slots are split into
+// shards of consecutive slots, each with a lock, so threads only contend when
+// they update info sets in the same shard.
+//
+// Checkpoint layout, all native endian, written and read through a mapping:
+//
+//   header   'B' 'P' 'C' 'R', version, NUM_PLAYERS, CFR_NUM_ACTIONS, 0,
+//            log2 of slots, log2 of shards (unsigned int),
+//            iterations, info sets (unsigned long long)
+//   keys     one unsigned long long per slot, 0 for an empty slot
+//   regrets  CFR_NUM_ACTIONS floats per slot
+//   sums     CFR_NUM_ACTIONS floats per slot, the average strategy's weights
+class cfr_solver
+{
+public:
+    
+    // num_threads == 0 means one per hardware thread
+    cfr_solver(const size_t src_num_slots_log2 = 17, const size_t src_num_shards_log2 = 6, const size_t src_num_threads = 0);
+    
+    // continues from the iterations done so far, each iteration's deal and
+    // samples depend only on seed and the iteration number
+    void run(const size_t num_iterations, const unsigned long long seed);
+    
+    // the average strategy at the table's current decision
+    void get_average_strategy(const blind_poker_table &table, double *const strategy) const;
+    
+    // plays one decision of the average strategy, true if a second decision is needed this turn
+    bool play_decision(blind_poker_table &table, unsigned long long &rand_state) const;
+    
+    // the average gain in pot share per game that a seat gets by deviating
+    // from the average strategy, one decision at a time, to the best action
+    // for each abstract info set (a local best response), the others keeping
+    // to the average strategy; an estimate from below of the abstraction's
+    // exploitability, the best actions being chosen on half the games each
+    double estimate_exploitability(const size_t num_games, const unsigned long long seed) const;
+    
+    size_t get_num_iterations(void) const;
+    size_t get_num_info_sets(void) const;
+    
+    void save_checkpoint(const char *const filename) const;
+    void load_checkpoint(const char *const filename);
+    
+    static unsigned long long get_info_set_key(const unsigned char *const positions, const size_t player_index);
+    
+protected:
+    
+    double traverse(blind_poker_table &table, const size_t traverser, const float weight, unsigned long long &rand_state);
+    void iteration_thread(const size_t last_iteration, const unsigned long long seed);
+    void exploitability_thread(const size_t first_game, const size_t game_step, const size_t num_games, const unsigned long long seed, map<unsigned long long, vector<double> > &gains) const;
+    
+    // call with the key's shard locked; find_slot gives the number of slots for a missing key
+    size_t find_slot(const unsigned long long key) const;
+    size_t add_slot(const unsigned long long key);
+    size_t get_shard(const unsigned long long key) const;
+    
+    void get_current_strategy(const unsigned long long key, double *const strategy);
+    void get_average_strategy(const unsigned long long key, double *const strategy) const;
+    
+    void set_size(const size_t src_num_slots_log2, const size_t src_num_shards_log2);
+    
+    size_t num_slots_log2;
+    size_t num_shards_log2;
+    size_t num_threads;
+    
+    vector<unsigned long long> keys;
+    vector<float> regrets;
+    vector<float> strategy_sums;
+    
+    mutable vector<mutex> shard_locks;
+    
+    atomic<size_t> num_iterations;
+    atomic<size_t> next_iteration;
+    atomic<size_t> num_info_sets;
+};
+
+
+#endif
@@ -0,0 +1,267 @@
+#include "convergence_monitor.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <stdexcept>
+using std::out_of_range;
+
+#include <cmath>
+
+
+rolling_statistics::rolling_statistics(const size_t src_window_size, const double src_decay)
+{
+    if(0 == src_window_size)
+        throw out_of_range("Invalid window size.");
+    
+    if(src_decay < 0 || src_decay >= 1)
+        throw out_of_range("Invalid decay.");
+    
+    window.assign(src_window_size, 0.0);
+    next_index = 0;
+    count = 0;
+    window_sum = 0;
+    window_sum_of_squares = 0;
+    shift = 0;
+    
+    decay = src_decay;
+    mean = 0;
+    variance = 0;
+}
+
+void rolling_statistics::add(const double value)
+{
+    // the first values are averaged evenly, until 1 / count falls below 1 - decay
+    double alpha = 1.0 - decay;
+    
+    count++;
+    
+    if(1.0 / count > alpha)
+        alpha = 1.0 / count;
+    
+    // the window keeps values less the first one, so the sum of squares doesn't cancel out
+    if(1 == count)
+        shift = value;
+    
+    const double difference = value - mean;
+    
+    mean += alpha*difference;
+    variance = (1.0 - alpha)*(variance + alpha*difference*difference);
+    
+    const double shifted_value = value - shift;
+    
+    window_sum += shifted_value - window[next_index];
+    window_sum_of_squares += shifted_value*shifted_value - window[next_index]*window[next_index];
+    window[next_index] = shifted_value;
+    
+    next_index++;
+    
+    if(window.size() == next_index)
+    {
+        next_index = 0;
+        
+        window_sum = 0;
+        window_sum_of_squares = 0;
+        
+        for(size_t i = 0; i < window.size(); i++)
+        {
+            window_sum += window[i];
+            window_sum_of_squares += window[i]*window[i];
+        }
+    }
+}
+
+size_t rolling_statistics::get_count(void) const
+{
+    return count;
+}
+
+bool rolling_statistics::is_window_full(void) const
+{
+    return count >= window.size();
+}
+
+double rolling_statistics::get_mean(void) const
+{
+    return mean;
+}
+
+double rolling_statistics::get_variance(void) const
+{
+    return variance;
+}
+
+double rolling_statistics::get_window_mean(void) const
+{
+    const size_t n = (count < window.size()) ? count : window.size();
+    
+    if(0 == n)
+        return 0;
+    
+    return shift + window_sum / n;
+}
+
+double rolling_statistics::get_window_variance(void) const
+{
+    const size_t n = (count < window.size()) ? count : window.size();
+    
+    if(0 == n)
+        return 0;
+    
+    const double window_mean = window_sum / n;
+    const double window_variance = window_sum_of_squares / n - window_mean*window_mean;
+    
+    return (window_variance > 0) ? window_variance : 0;
+}
+
+
+convergence_monitor_settings::convergence_monitor_settings(void)
+{
+    window_size = 1000;
+    decay = 0.999;
+    metric = CONVERGENCE_METRIC_LOSS;
+    min_improvement = 0.01;
+    patience = 5;
+    max_learning_rate_decays = 3;
+    learning_rate_decay = 0.5;
+}
+
+convergence_monitor::convergence_monitor(const size_t src_num_seats, const convergence_monitor_settings &src_settings)
+{
+    if(src_settings.metric >= NUM_CONVERGENCE_METRICS)
+        throw out_of_range("Invalid convergence metric.");
+    
+    if(0 == src_settings.patience)
+        throw out_of_range("Invalid patience.");
+    
+    settings = src_settings;
+    num_seats = src_num_seats;
+    
+    statistics.assign(num_seats*NUM_CONVERGENCE_METRICS, rolling_statistics(settings.window_size, settings.decay));
+    best_values.assign(num_seats, 0.0);
+    has_best_value.assign(num_seats, false);
+    checks_without_progress.assign(num_seats, 0);
+    
+    num_games = 0;
+    num_learning_rate_decays = 0;
+}
+
+void convergence_monitor::add(const size_t seat, const size_t metric, const double value)
+{
+    if(seat >= num_seats || metric >= NUM_CONVERGENCE_METRICS)
+        throw out_of_range("Invalid seat or metric.");
+    
+    statistics[seat*NUM_CONVERGENCE_METRICS + metric].add(value);
+}
+
+size_t convergence_monitor::end_game(void)
+{
+    num_games++;
+    
+    if(0 != num_games % settings.window_size)
+        return CONVERGENCE_CONTINUE;
+    
+    size_t num_plateaued = 0;
+    
+    for(size_t i = 0; i < num_seats; i++)
+    {
+        const rolling_statistics &s = statistics[i*NUM_CONVERGENCE_METRICS + settings.metric];
+        
+        // no verdict until the seat has a full window
+        if(false == s.is_window_full())
+            continue;
+        
+        // lower is better from here on
+        double value = s.get_window_mean();
+        
+        if(CONVERGENCE_METRIC_WIN_RATE == settings.metric)
+            value = -value;
+        
+        if(false == has_best_value[i])
+        {
+            best_values[i] = value;
+            has_best_value[i] = true;
+        }
+        else if(value < best_values[i] - settings.min_improvement*fabs(best_values[i]))
+        {
+            best_values[i] = value;
+            checks_without_progress[i] = 0;
+        }
+        else
+        {
+            checks_without_progress[i]++;
+        }
+        
+        if(true == has_plateaued(i))
+            num_plateaued++;
+    }
+    
+    if(0 == num_seats || num_plateaued != num_seats)
+        return CONVERGENCE_CONTINUE;
+    
+    if(num_learning_rate_decays >= settings.max_learning_rate_decays)
+        return CONVERGENCE_STOP;
+    
+    // a fresh run of patience at the lower learning rate
+    num_learning_rate_decays++;
+    checks_without_progress.assign(num_seats, 0);
+    
+    return CONVERGENCE_DECAY_LEARNING_RATE;
+}
+
+const rolling_statistics &convergence_monitor::get_statistics(const size_t seat, const size_t metric) const
+{
+    if(seat >= num_seats || metric >= NUM_CONVERGENCE_METRICS)
+        throw out_of_range("Invalid seat or metric.");
+    
+    return statistics[seat*NUM_CONVERGENCE_METRICS + metric];
+}
+
+bool convergence_monitor::has_plateaued(const size_t seat) const
+{
+    return checks_without_progress[seat] >= settings.patience;
+}
+
+size_t convergence_monitor::get_num_games(void) const
+{
+    return num_games;
+}
+
+size_t convergence_monitor::get_num_learning_rate_decays(void) const
+{
+    return num_learning_rate_decays;
+}
+
+void convergence_monitor::print(const size_t first_player_index) const
+{
+    const char *const names[NUM_CONVERGENCE_METRICS] = { "loss", "win rate", "entropy" };
+    
+    cout << num_games << " games, " << num_learning_rate_decays << " learning rate decays" << endl;
+    
+    for(size_t i = 0; i < num_seats; i++)
+    {
+        cout << "player " << first_player_index + i + 1 << ":";
+        
+        // exponential mean / last window's mean
+        for(size_t j = 0; j < NUM_CONVERGENCE_METRICS; j++)
+        {
+            const rolling_statistics &s = statistics[i*NUM_CONVERGENCE_METRICS + j];
+            
+            cout << " " << names[j] << " " << s.get_mean() << " / " << s.get_window_mean();
+        }
+        
+        if(true == has_plateaued(i))
+            cout << " (plateaued)";
+        
+        cout << endl;
+    }
+}
+
+double convergence_monitor::get_decision_entropy(const double output)
+{
+    if(output <= 0 || output >= 1)
+        return 0;
+    
+    return -(output*log2(output) + (1 - output)*log2(1 - output));
+}
@@ -0,0 +1,131 @@
+#ifndef CONVERGENCE_MONITOR_H
+#define CONVERGENCE_MONITOR_H
+
+
+#include <vector>
+using std::vector;
+
+#include <cstddef>
+using std::size_t;
+
+
+#define CONVERGENCE_METRIC_LOSS 0
+#define CONVERGENCE_METRIC_WIN_RATE 1
+#define CONVERGENCE_METRIC_ENTROPY 2
+#define NUM_CONVERGENCE_METRICS 3
+
+// what convergence_monitor::end_game asks of the training loop
+#define CONVERGENCE_CONTINUE 0
+#define CONVERGENCE_DECAY_LEARNING_RATE 1
+#define CONVERGENCE_STOP 2
+
+
+// Mean and variance of a stream of values over two windows: an exponential
+// one, and the last window_size values. Adding a value is O(1); the window's
+// running sums are recomputed each time the ring buffer wraps, so rounding
+// errors don't build up.
+class rolling_statistics
+{
+public:
+    
+    rolling_statistics(const size_t src_window_size = 1000, const double src_decay = 0.999);
+    
+    void add(const double value);
+    
+    size_t get_count(void) const;
+    bool is_window_full(void) const;
+    
+    // exponential window, each value's weight decays by src_decay per new value
+    double get_mean(void) const;
+    double get_variance(void) const;
+    
+    // the last window_size values
+    double get_window_mean(void) const;
+    double get_window_variance(void) const;
+    
+protected:
+    
+    vector<double> window;
+    size_t next_index;
+    size_t count;
+    double window_sum;
+    double window_sum_of_squares;
+    double shift;
+    
+    double decay;
+    double mean;
+    double variance;
+};
+
+class convergence_monitor_settings
+{
+public:
+    
+    convergence_monitor_settings(void);
+    
+    // games per fixed window, and between plateau checks
+    size_t window_size;
+    
+    // per value, of the exponential windows
+    double decay;
+    
+    // the CONVERGENCE_METRIC_* watched for a plateau; win rate is to be
+    // maximised, loss and entropy minimised
+    size_t metric;
+    
+    // a window mean this much better than the best so far, relative to it, is progress
+    double min_improvement;
+    
+    // checks without progress before a seat has plateaued
+    size_t patience;
+    
+    // learning rate decays before a plateau stops training, and the factor of each
+    size_t max_learning_rate_decays;
+    double learning_rate_decay;
+};
+
+// Per-seat loss, win rate and decision entropy over rolling windows. Every
+// window_size games the watched metric's window mean is compared to the best
+// so far; once every seat has gone patience checks without progress, training
+// has plateaued, and the monitor asks for a learning rate decay, or to stop
+// when the decays have run out.
+class convergence_monitor
+{
+public:
+    
+    convergence_monitor(const size_t src_num_seats, const convergence_monitor_settings &src_settings = convergence_monitor_settings());
+    
+    void add(const size_t seat, const size_t metric, const double value);
+    
+    // once per game, after its values are added; CONVERGENCE_*
+    size_t end_game(void);
+    
+    const rolling_statistics &get_statistics(const size_t seat, const size_t metric) const;
+    bool has_plateaued(const size_t seat) const;
+    size_t get_num_games(void) const;
+    size_t get_num_learning_rate_decays(void) const;
+    
+    // seat i is printed as "player first_player_index + i + 1", as main.cpp numbers the table's players
+    void print(const size_t first_player_index = 0) const;
+    
+    // in bits, of a decision made with probability output of choosing 1
+    static double get_decision_entropy(const double output);
+    
+protected:
+    
+    convergence_monitor_settings settings;
+    size_t num_seats;
+    
+    // [seat*NUM_CONVERGENCE_METRICS + metric]
+    vector<rolling_statistics> statistics;
+    
+    vector<double> best_values;
+    vector<bool> has_best_value;
+    vector<size_t> checks_without_progress;
+    
+    size_t num_games;
+    size_t num_learning_rate_decays;
+};
+
+
+#endif
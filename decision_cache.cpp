@@ -0,0 +1,89 @@
+#include "decision_cache.h"
+
+#include <cstring>
+
+#include <stdexcept>
+using std::out_of_range;
+
+
+decision_cache::decision_cache(const size_t src_num_entries_log2) : checks(static_cast<size_t>(1) << src_num_entries_log2), data(static_cast<size_t>(1) << src_num_entries_log2)
+{
+    if(src_num_entries_log2 == 0 || src_num_entries_log2 > 30)
+        throw out_of_range("Invalid number of cache entries.");
+
+    index_mask = (static_cast<unsigned long long>(1) << src_num_entries_log2) - 1;
+
+    clear();
+}
+
+bool decision_cache::lookup(const unsigned long long state_hash, const unsigned long long weights_version, double &output)
+{
+    const unsigned long long key = get_key(state_hash, weights_version);
+    const size_t index = static_cast<size_t>(key & index_mask);
+
+    const unsigned long long temp_data = data[index].load(std::memory_order_relaxed);
+    const unsigned long long temp_check = checks[index].load(std::memory_order_relaxed);
+
+    num_lookups.fetch_add(1, std::memory_order_relaxed);
+
+    if((temp_check ^ temp_data) != key)
+        return false;
+
+    num_hits.fetch_add(1, std::memory_order_relaxed);
+
+    memcpy(&output, &temp_data, sizeof(double));
+
+    return true;
+}
+
+void decision_cache::store(const unsigned long long state_hash, const unsigned long long weights_version, const double output)
+{
+    const unsigned long long key = get_key(state_hash, weights_version);
+    const size_t index = static_cast<size_t>(key & index_mask);
+
+    unsigned long long temp_data = 0;
+    memcpy(&temp_data, &output, sizeof(double));
+
+    // always replace, the newest entry is the most likely to be looked up again
+    data[index].store(temp_data, std::memory_order_relaxed);
+    checks[index].store(key ^ temp_data, std::memory_order_relaxed);
+}
+
+void decision_cache::clear(void)
+{
+    // (0, 0) would match the key 0, so mark empty slots with a check that never matches
+    for(size_t i = 0; i < checks.size(); i++)
+    {
+        data[i].store(0, std::memory_order_relaxed);
+        checks[i].store(~static_cast<unsigned long long>(i), std::memory_order_relaxed);
+    }
+
+    num_lookups.store(0);
+    num_hits.store(0);
+}
+
+size_t decision_cache::get_num_lookups(void) const
+{
+    return num_lookups.load();
+}
+
+size_t decision_cache::get_num_hits(void) const
+{
+    return num_hits.load();
+}
+
+double decision_cache::get_hit_rate(void) const
+{
+    size_t temp_lookups = num_lookups.load();
+
+    if(0 == temp_lookups)
+        return 0;
+
+    return static_cast<double>(num_hits.load()) / static_cast<double>(temp_lookups);
+}
+
+unsigned long long decision_cache::get_key(const unsigned long long state_hash, const unsigned long long weights_version) const
+{
+    // spread the version over all bits so that version n and n + 1 don't share slots
+    return state_hash ^ ((weights_version + 1) * 0x9E3779B97F4A7C15ULL);
+}
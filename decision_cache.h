@@ -0,0 +1,49 @@
+#ifndef DECISION_CACHE_H
+#define DECISION_CACHE_H
+
+
+#include <vector>
+using std::vector;
+
+#include <atomic>
+using std::atomic;
+
+#include <cstddef>
+using std::size_t;
+
+
+// Bounded, lock-free cache of a single output network's output, keyed by
+// blind_poker_table::get_state_hash. Use one cache per network.
+//
+// Each slot stores (key ^ data, data). A reader only accepts a slot when the
+// two words agree, so a slot torn by a concurrent writer reads as a miss and
+// no lock is needed. The network's weights version is mixed into the key,
+// which drops every entry as soon as the weights change.
+class decision_cache
+{
+public:
+
+    decision_cache(const size_t src_num_entries_log2 = 16);
+
+    bool lookup(const unsigned long long state_hash, const unsigned long long weights_version, double &output);
+    void store(const unsigned long long state_hash, const unsigned long long weights_version, const double output);
+    void clear(void);
+
+    size_t get_num_lookups(void) const;
+    size_t get_num_hits(void) const;
+    double get_hit_rate(void) const;
+
+protected:
+
+    unsigned long long get_key(const unsigned long long state_hash, const unsigned long long weights_version) const;
+
+    vector< atomic<unsigned long long> > checks;
+    vector< atomic<unsigned long long> > data;
+    unsigned long long index_mask;
+
+    atomic<size_t> num_lookups;
+    atomic<size_t> num_hits;
+};
+
+
+#endif
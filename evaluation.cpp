@@ -0,0 +1,100 @@
+#include "evaluation.h"
+
+#include <chrono>
+
+#include <stdexcept>
+using std::out_of_range;
+
+
+// splitmix64, a different stream per game
+static unsigned long long get_game_rand(unsigned long long &state)
+{
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void evaluate_networks(vector<FFBPNeuralNet> &NNets, const size_t num_games, const unsigned long long seed, evaluation_result &result)
+{
+    if(NNets.size() != NUM_PLAYERS - 1)
+        throw out_of_range("Invalid number of networks.");
+    
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        result.seat_win_rates[i] = 0;
+    
+    vector<input_output_pair> io;
+    blind_poker_table bpt;
+    
+    for(size_t i = 0; i < num_games; i++)
+    {
+        unsigned long long rand_state = seed ^ (i * 0xD1B54A32D192ED03ULL);
+        
+        // deal from a deck shuffled by this game's stream, not rand()
+        unsigned char deck_order[NUM_CARDS_PER_DECK];
+        
+        for(size_t j = 0; j < NUM_CARDS_PER_DECK; j++)
+            deck_order[j] = static_cast<unsigned char>(j);
+        
+        for(size_t j = NUM_CARDS_PER_DECK - 1; j > 0; j--)
+        {
+            size_t k = static_cast<size_t>(get_game_rand(rand_state) % (j + 1));
+            
+            unsigned char temp = deck_order[j];
+            deck_order[j] = deck_order[k];
+            deck_order[k] = temp;
+        }
+        
+        bpt.reset_table(deck_order);
+        bpt.set_rand_seed(get_game_rand(rand_state));
+        
+        while(false == bpt.is_game_over())
+        {
+            const size_t player = bpt.get_current_player();
+            
+            if(0 == player)
+            {
+                bpt.play_rand();
+            }
+            else
+            {
+                io.clear();
+                bpt.play_ANN(io, NNets[player - 1]);
+            }
+        }
+        
+        vector< vector<size_t> > ranking;
+        bpt.get_showdown_ranking(ranking);
+        
+        for(size_t j = 0; j < ranking[0].size(); j++)
+            result.seat_win_rates[ranking[0][j]] += 1.0 / ranking[0].size();
+    }
+    
+    result.ANN_win_rate = 0;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        if(0 != num_games)
+            result.seat_win_rates[i] /= num_games;
+        
+        if(0 != i)
+            result.ANN_win_rate += result.seat_win_rates[i] / (NUM_PLAYERS - 1);
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    
+    result.num_games = num_games;
+    result.games_per_second = (0 == seconds) ? 0 : num_games / seconds;
+}
+
+void print_evaluation_result(const evaluation_result &result)
+{
+    cout << "games: " << result.num_games << " (" << result.games_per_second << " per second)" << endl;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        cout << "player " << i + 1 << " win rate: " << result.seat_win_rates[i] << endl;
+    
+    cout << "network win rate: " << result.ANN_win_rate << endl;
+}
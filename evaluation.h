@@ -0,0 +1,32 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+
+#include "cards.h"
+
+
+class evaluation_result
+{
+public:
+    
+    // mean share of the pot per seat, tied winners split it
+    double seat_win_rates[NUM_PLAYERS];
+    
+    // mean over the network seats, 1.0 / NUM_PLAYERS is as good as play_rand
+    double ANN_win_rate;
+    
+    size_t num_games;
+    double games_per_second;
+};
+
+// A fixed evaluation set: seat 0 plays play_rand and seat i + 1 plays
+// NNets[i], as in the serial loop, over num_games deals that depend only on
+// the seed. Networks compared on the same seed see the same deals and the
+// same random opponent, so the difference in win rate is down to the networks.
+// The networks aren't trained.
+void evaluate_networks(vector<FFBPNeuralNet> &NNets, const size_t num_games, const unsigned long long seed, evaluation_result &result);
+
+void print_evaluation_result(const evaluation_result &result);
+
+
+#endif
@@ -0,0 +1,140 @@
+#include "feature_encoder.h"
+
+
+#define NUM_SUITS (SUIT_CLUBS + 1)
+#define NUM_FACES (FACE_A - FACE_2 + 1)
+
+
+static inline unsigned int popcount(unsigned int x)
+{
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    
+    return (x * 0x01010101u) >> 24;
+}
+
+// per 13 bit face mask (bit i for FACE_2 + i): how many faces it has, and
+// the most of them in any five face window, the ace also playing low
+class face_mask_table
+{
+public:
+    
+    face_mask_table(void)
+    {
+        for(unsigned int i = 0; i < (1u << NUM_FACES); i++)
+        {
+            const unsigned int faces = (i << 1) | (i >> (NUM_FACES - 1));
+            
+            counts[i] = static_cast<unsigned char>(popcount(i));
+            spans[i] = 0;
+            
+            for(size_t j = 0; j + NUM_CARDS_PER_HAND <= NUM_FACES + 1; j++)
+            {
+                const unsigned char window = static_cast<unsigned char>(popcount((faces >> j) & ((1u << NUM_CARDS_PER_HAND) - 1)));
+                spans[i] = window > spans[i] ? window : spans[i];
+            }
+        }
+    }
+    
+    unsigned char counts[1u << NUM_FACES];
+    unsigned char spans[1u << NUM_FACES];
+};
+
+static const face_mask_table face_mask_lookup;
+
+// masks[position*NUM_SUITS + suit], as blind_poker_table::get_face_masks
+static void get_features(const unsigned short *const masks, double *const values)
+{
+    double *value = values;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        const unsigned int a = masks[(POSITION_HAND0 + i)*NUM_SUITS + 0];
+        const unsigned int b = masks[(POSITION_HAND0 + i)*NUM_SUITS + 1];
+        const unsigned int c = masks[(POSITION_HAND0 + i)*NUM_SUITS + 2];
+        const unsigned int d = masks[(POSITION_HAND0 + i)*NUM_SUITS + 3];
+        
+        // faces shown at least two, three and four times
+        const unsigned int at_least_2 = (a & b) | (a & c) | (a & d) | (b & c) | (b & d) | (c & d);
+        const unsigned int at_least_3 = (a & b & c) | (a & b & d) | (a & c & d) | (b & c & d);
+        const unsigned int at_least_4 = a & b & c & d;
+        
+        unsigned int max_suit_count = face_mask_lookup.counts[a];
+        
+        max_suit_count = face_mask_lookup.counts[b] > max_suit_count ? face_mask_lookup.counts[b] : max_suit_count;
+        max_suit_count = face_mask_lookup.counts[c] > max_suit_count ? face_mask_lookup.counts[c] : max_suit_count;
+        max_suit_count = face_mask_lookup.counts[d] > max_suit_count ? face_mask_lookup.counts[d] : max_suit_count;
+        
+        *value++ = face_mask_lookup.counts[at_least_2 & ~at_least_3] * 0.5;
+        *value++ = face_mask_lookup.counts[at_least_3 & ~at_least_4];
+        *value++ = face_mask_lookup.counts[at_least_4];
+        *value++ = max_suit_count * (1.0 / NUM_CARDS_PER_HAND);
+        *value++ = face_mask_lookup.spans[a | b | c | d] * (1.0 / NUM_CARDS_PER_HAND);
+    }
+    
+    // shown anywhere, so everything but POSITION_NOT_SHOWN
+    unsigned int seen[NUM_SUITS];
+    
+    for(size_t i = 0; i < NUM_SUITS; i++)
+        seen[i] = NUM_FACES - face_mask_lookup.counts[masks[POSITION_NOT_SHOWN*NUM_SUITS + i]];
+    
+    // most first, with a five comparator network
+    const size_t network[5][2] = { {0, 1}, {2, 3}, {0, 2}, {1, 3}, {1, 2} };
+    
+    for(size_t i = 0; i < 5; i++)
+    {
+        unsigned int &x = seen[network[i][0]];
+        unsigned int &y = seen[network[i][1]];
+        
+        const unsigned int hi = x > y ? x : y;
+        const unsigned int lo = x > y ? y : x;
+        
+        x = hi;
+        y = lo;
+    }
+    
+    for(size_t i = 0; i < NUM_SUITS; i++)
+        *value++ = seen[i] * (1.0 / NUM_FACES);
+}
+
+static void append_features(const unsigned short *const masks, vector<double> &features)
+{
+    // filled in place, then appended at once
+    double values[NUM_ENGINEERED_FEATURES];
+    
+    get_features(masks, values);
+    
+    features.insert(features.end(), values, values + NUM_ENGINEERED_FEATURES);
+}
+
+static void get_face_masks(const unsigned char *const positions, unsigned short *const masks)
+{
+    // card_id == (face - FACE_2)*4 + suit
+    for(size_t i = 0; i < (POSITION_NOT_SHOWN + 1)*NUM_SUITS; i++)
+        masks[i] = 0;
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        masks[positions[i]*NUM_SUITS + (i & 3)] |= static_cast<unsigned short>(1u << (i >> 2));
+}
+
+void append_engineered_features(const unsigned char *const positions, vector<double> &features)
+{
+    unsigned short masks[(POSITION_NOT_SHOWN + 1)*NUM_SUITS];
+    
+    get_face_masks(positions, masks);
+    append_features(masks, features);
+}
+
+void append_engineered_features(const blind_poker_table &table, vector<double> &features)
+{
+    append_features(table.get_face_masks(), features);
+}
+
+void get_engineered_features(const unsigned char *const positions, double *const features)
+{
+    unsigned short masks[(POSITION_NOT_SHOWN + 1)*NUM_SUITS];
+    
+    get_face_masks(positions, masks);
+    get_features(masks, features);
+}
@@ -0,0 +1,32 @@
+#ifndef FEATURE_ENCODER_H
+#define FEATURE_ENCODER_H
+
+
+#include "cards.h"
+
+
+// per player: pairs, three of a kinds and four of a kinds among the shown
+// cards of the hand, the most shown cards of one suit, and the most distinct
+// faces in any five face straight window; then the shown cards of each suit
+// over the whole table, most first
+#define NUM_ENGINEERED_FEATURES_PER_PLAYER 5
+#define NUM_ENGINEERED_FEATURES (NUM_ENGINEERED_FEATURES_PER_PLAYER*NUM_PLAYERS + SUIT_CLUBS + 1)
+
+
+// Appends NUM_ENGINEERED_FEATURES values in [0, 1], for a position array
+// from blind_poker_table::get_card_positions. They're built from one 13 bit
+// face mask per (player, suit) with table popcounts, shifts and ands rather
+// than by looking at the cards one by one, and none of them depend on how the
+// suits are labelled.
+void append_engineered_features(const unsigned char *const positions, vector<double> &features);
+
+// the same for a table's current state, from the face masks it keeps up to
+// date as cards move, so without going over the positions
+void append_engineered_features(const blind_poker_table &table, vector<double> &features);
+
+// the same as the first, written to features[0 .. NUM_ENGINEERED_FEATURES)
+// for callers that don't allocate
+void get_engineered_features(const unsigned char *const positions, double *const features);
+
+
+#endif
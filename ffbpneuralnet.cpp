@@ -1,5 +1,6 @@
 #include "ffbpneuralnet.h"
 #include "weighted_neuron.h"
+#include "fixed_ffbpneuralnet.h"
 
 #include <sstream>
 using std::ostringstream;
@@ -19,10 +20,22 @@ using std::runtime_error;
 using std::cout;
 using std::endl;
 
+#include <algorithm>
+using std::nth_element;
+
+#include <utility>
+using std::pair;
+
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
 #include <cfloat>
+#include <cstring>
+
+
+// mark the optional sections after the dense weights
+static const char sparse_section_tag[4] = { 'C', 'S', 'R', '1' };
+static const char optimiser_section_tag[4] = { 'O', 'P', 'T', '1' };
 
 
 FFBPNeuralNet::FFBPNeuralNet(const size_t &src_num_input_neurons, const vector<size_t> &src_num_hidden_layers_neurons, const size_t &src_num_output_neurons)
@@ -72,10 +85,34 @@ FFBPNeuralNet::FFBPNeuralNet(const size_t &src_num_input_neurons, const vector<s
 
     learning_rate = 1.0;    // 0.25 might be a good value
     momentum = 1.0; // 0.5 might be a good value
+
+	weights_version = 0;
+	fixed_net_version = ~0ULL;
+	last_fed_forward_version = ~0ULL;
+	sparse_version = ~0ULL;
+
+	optimiser = OPTIMISER_CLASSIC;
+	second_moment_decay = GetDefaultSecondMomentDecay(optimiser);
+	momentum_set = false;
+	second_moment_decay_set = false;
+	epsilon = 1e-8;
+	optimiser_step = 0;
 }
 
 FFBPNeuralNet::FFBPNeuralNet(const char *const src_filename)
 {
+	weights_version = 0;
+	fixed_net_version = ~0ULL;
+	last_fed_forward_version = ~0ULL;
+	sparse_version = ~0ULL;
+
+	optimiser = OPTIMISER_CLASSIC;
+	second_moment_decay = GetDefaultSecondMomentDecay(optimiser);
+	momentum_set = false;
+	second_moment_decay_set = false;
+	epsilon = 1e-8;
+	optimiser_step = 0;
+
 	LoadFromFile(src_filename);
 }
 
@@ -91,6 +128,43 @@ void FFBPNeuralNet::FeedForward(const vector<double> &src_inputs)
 
 	InputLayer = src_inputs;
 
+	if(sparse_version == weights_version)
+	{
+		SparseFeedForward(&InputLayer[0], SparseValues);
+
+		// keep the neurons' values, BackPropagate uses them
+		for(size_t i = 0; i < HiddenLayers.size(); i++)
+			for(size_t j = 0; j < HiddenLayers[i].size(); j++)
+				HiddenLayers[i][j].SetValue(SparseValues[i][j]);
+
+		for(size_t i = 0; i < OutputLayer.size(); i++)
+			OutputLayer[i].SetValue(SparseValues[HiddenLayers.size()][i]);
+
+		return;
+	}
+
+	// the weights haven't changed since the last feed, so they'll likely stay
+	// the same for a while (playing rather than training); worth a copy in the
+	// compiled-in shape, if there is one
+	if(weights_version == last_fed_forward_version && fixed_net_version != weights_version)
+		UpdateFixedNet();
+
+	last_fed_forward_version = weights_version;
+
+	if(0 != FixedNet.get() && fixed_net_version == weights_version)
+	{
+		FixedNet->Evaluate(&InputLayer[0], &FixedNetValues[0]);
+
+		// keep the neurons' values, BackPropagate uses them
+		for(size_t i = 0; i < HiddenLayers[0].size(); i++)
+			HiddenLayers[0][i].SetValue(FixedNetValues[i]);
+
+		for(size_t i = 0; i < OutputLayer.size(); i++)
+			OutputLayer[i].SetValue(FixedNetValues[HiddenLayers[0].size() + i]);
+
+		return;
+	}
+
 	// feed input values to first hidden layer's neurons
 	for(size_t i = 0; i < HiddenLayers[0].size(); i++)
 		HiddenLayers[0][i].SetInputValues(InputLayer);
@@ -121,6 +195,68 @@ void FFBPNeuralNet::FeedForward(const vector<double> &src_inputs)
 		OutputLayer[i].SetInputValues(PreviousLayerValues);
 }
 
+void FFBPNeuralNet::FeedForwardBatch(const vector<double> &src_inputs, const size_t num_rows, vector<double> &src_outputs) const
+{
+	// sanity check
+	if(src_inputs.size() != num_rows * InputLayer.size())
+		throw out_of_range("Invalid input vector size.");
+
+	if(sparse_version == weights_version)
+	{
+		vector< vector<double> > Values;
+
+		src_outputs.resize(num_rows * OutputLayer.size());
+
+		for(size_t i = 0; i < num_rows; i++)
+		{
+			SparseFeedForward(&src_inputs[i*InputLayer.size()], Values);
+
+			for(size_t j = 0; j < OutputLayer.size(); j++)
+				src_outputs[i*OutputLayer.size() + j] = Values[HiddenLayers.size()][j];
+		}
+
+		return;
+	}
+
+	if(0 != FixedNet.get() && fixed_net_version == weights_version)
+	{
+		const size_t num_values = HiddenLayers[0].size() + OutputLayer.size();
+		vector<double> Values(num_values);
+
+		src_outputs.resize(num_rows * OutputLayer.size());
+
+		for(size_t i = 0; i < num_rows; i++)
+		{
+			FixedNet->Evaluate(&src_inputs[i*InputLayer.size()], &Values[0]);
+
+			for(size_t j = 0; j < OutputLayer.size(); j++)
+				src_outputs[i*OutputLayer.size() + j] = Values[HiddenLayers[0].size() + j];
+		}
+
+		return;
+	}
+
+	vector<double> PreviousLayerValues(src_inputs);
+	vector<double> LayerValues;
+
+	// a layer at a time, each neuron over every row while its weights are in cache
+	for(size_t i = 0; i <= HiddenLayers.size(); i++)
+	{
+		const vector<WeightedNeuron> &Layer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+		const size_t num_previous_values = PreviousLayerValues.size() / (0 == num_rows ? 1 : num_rows);
+
+		LayerValues.resize(num_rows * Layer.size());
+
+		for(size_t j = 0; j < Layer.size(); j++)
+			for(size_t k = 0; k < num_rows; k++)
+				LayerValues[k*Layer.size() + j] = Layer[j].ComputeValue(&PreviousLayerValues[k*num_previous_values]);
+
+		PreviousLayerValues.swap(LayerValues);
+	}
+
+	src_outputs.swap(PreviousLayerValues);
+}
+
 void FFBPNeuralNet::GetOutputValues(vector<double> &src_outputs)
 {
 	src_outputs.clear();
@@ -149,6 +285,14 @@ size_t FFBPNeuralNet::GetMaximumOutputNeuron(void) const
 
 double FFBPNeuralNet::BackPropagate(const vector<double> &src_desired_outputs)
 {
+	if(OPTIMISER_CLASSIC != optimiser)
+	{
+		double error_rate = ComputeGradients(src_desired_outputs, Gradients);
+		ApplyGradients(Gradients);
+
+		return error_rate;
+	}
+
 	// generate output layer errors
 	vector<double> OutputLayerErrors(OutputLayer.size());
 
@@ -290,9 +434,297 @@ double FFBPNeuralNet::BackPropagate(const vector<double> &src_desired_outputs)
 		HiddenLayers[0][j].SetBiasWeight(bias_weight);
 	}
 
+	weights_version++;
+
+	return error_rate;
+}
+
+double FFBPNeuralNet::ComputeGradients(const vector<double> &src_desired_outputs, vector< vector<double> > &src_gradients) const
+{
+	if(src_desired_outputs.size() != OutputLayer.size())
+		throw out_of_range("Invalid output vector size.");
+
+	vector<double> OutputErrors(OutputLayer.size());
+
+	double error_rate = 0.0;
+
+	for(size_t i = 0; i < OutputLayer.size(); i++)
+	{
+		OutputErrors[i] = WeightedNeuron::DerivativeOfActivationFunction(OutputLayer[i].GetValue()) * (src_desired_outputs[i] - OutputLayer[i].GetValue());
+		error_rate += (OutputLayer[i].GetValue() - src_desired_outputs[i]) * (OutputLayer[i].GetValue() - src_desired_outputs[i]);
+	}
+
+	error_rate /= static_cast<double>(OutputLayer.size()); // create mean
+
+	ComputeGradientsFromErrors(OutputErrors, src_gradients);
+
 	return error_rate;
 }
 
+void FFBPNeuralNet::ComputeOutputGradients(vector< vector<double> > &src_gradients) const
+{
+	vector<double> OutputErrors(OutputLayer.size());
+
+	for(size_t i = 0; i < OutputLayer.size(); i++)
+		OutputErrors[i] = WeightedNeuron::DerivativeOfActivationFunction(OutputLayer[i].GetValue());
+
+	ComputeGradientsFromErrors(OutputErrors, src_gradients);
+}
+
+void FFBPNeuralNet::ComputeGradientsFromErrors(const vector<double> &src_output_errors, vector< vector<double> > &src_gradients) const
+{
+	const size_t num_layers = HiddenLayers.size() + 1;
+
+	// the errors, as in BackPropagate
+	vector< vector<double> > Errors(num_layers);
+
+	Errors[num_layers - 1] = src_output_errors;
+
+	for(size_t i = num_layers - 1; i > 0; i--)
+	{
+		const vector<WeightedNeuron> &NextLayer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+		const vector<WeightedNeuron> &Layer = HiddenLayers[i - 1];
+
+		Errors[i - 1].resize(Layer.size());
+
+		for(size_t j = 0; j < Layer.size(); j++)
+		{
+			double sum = 0.0;
+
+			for(size_t k = 0; k < NextLayer.size(); k++)
+				sum += Errors[i][k] * NextLayer[k].GetWeight(j);
+
+			Errors[i - 1][j] = sum * WeightedNeuron::DerivativeOfActivationFunction(Layer[j].GetValue());
+		}
+	}
+
+	// error times the value coming in along each weight
+	src_gradients.resize(num_layers);
+
+	vector<double> PreviousLayerValues(InputLayer);
+
+	for(size_t i = 0; i < num_layers; i++)
+	{
+		const vector<WeightedNeuron> &Layer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+		const size_t row_size = PreviousLayerValues.size() + 1;
+
+		src_gradients[i].resize(Layer.size() * row_size);
+
+		for(size_t j = 0; j < Layer.size(); j++)
+		{
+			double *const gradients = &src_gradients[i][j*row_size];
+
+			for(size_t k = 0; k < PreviousLayerValues.size(); k++)
+				gradients[k] = Errors[i][j] * PreviousLayerValues[k];
+
+			gradients[row_size - 1] = Errors[i][j] * Layer[j].GetBias();
+		}
+
+		PreviousLayerValues.resize(Layer.size());
+
+		for(size_t j = 0; j < Layer.size(); j++)
+			PreviousLayerValues[j] = Layer[j].GetValue();
+	}
+}
+
+// one optimiser step over n weights, w[i] += step(g[i]), updating the moments in m and s
+static void update_weights(const size_t optimiser, const size_t n, double *const w, const double *const g, double *const m, double *const s,
+                           const double learning_rate, const double momentum, const double second_moment_decay, const double epsilon,
+                           const double first_moment_correction, const double second_moment_correction)
+{
+	switch(optimiser)
+	{
+	case OPTIMISER_MOMENTUM:
+		for(size_t i = 0; i < n; i++)
+		{
+			m[i] = momentum * m[i] + learning_rate * g[i];
+			w[i] += m[i];
+		}
+		break;
+
+	case OPTIMISER_NESTEROV:
+		for(size_t i = 0; i < n; i++)
+		{
+			m[i] = momentum * m[i] + learning_rate * g[i];
+			w[i] += momentum * m[i] + learning_rate * g[i];
+		}
+		break;
+
+	case OPTIMISER_RMSPROP:
+		for(size_t i = 0; i < n; i++)
+		{
+			s[i] = second_moment_decay * s[i] + (1.0 - second_moment_decay) * g[i] * g[i];
+			w[i] += learning_rate * g[i] / (sqrt(s[i]) + epsilon);
+		}
+		break;
+
+	case OPTIMISER_ADAM:
+		for(size_t i = 0; i < n; i++)
+		{
+			m[i] = momentum * m[i] + (1.0 - momentum) * g[i];
+			s[i] = second_moment_decay * s[i] + (1.0 - second_moment_decay) * g[i] * g[i];
+			w[i] += learning_rate * (m[i] * first_moment_correction) / (sqrt(s[i] * second_moment_correction) + epsilon);
+		}
+		break;
+
+	default: // OPTIMISER_CLASSIC, m holds the previous adjustments
+		for(size_t i = 0; i < n; i++)
+		{
+			const double delta_weight = learning_rate * g[i];
+			w[i] = w[i] + delta_weight + momentum * m[i];
+			m[i] = delta_weight;
+		}
+		break;
+	}
+}
+
+void FFBPNeuralNet::ApplyGradients(const vector< vector<double> > &src_gradients)
+{
+	if(src_gradients.size() != HiddenLayers.size() + 1)
+		throw out_of_range("Invalid gradients size.");
+
+	if(FirstMoments.size() != src_gradients.size())
+		ResetOptimiserState();
+
+	for(size_t i = 0; i < src_gradients.size(); i++)
+		if(FirstMoments[i].size() != src_gradients[i].size())
+			ResetOptimiserState();
+
+	optimiser_step++;
+
+	const double first_moment_correction = 1.0 / (1.0 - pow(momentum, static_cast<double>(optimiser_step)));
+	const double second_moment_correction = 1.0 / (1.0 - pow(second_moment_decay, static_cast<double>(optimiser_step)));
+
+	// one update_weights call per neuron: its weights are in the neuron, its
+	// gradient and moments are its row of the layer's buffers
+	for(size_t i = 0; i < src_gradients.size(); i++)
+	{
+		vector<WeightedNeuron> &Layer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+		const size_t row_size = src_gradients[i].size() / Layer.size();
+
+		for(size_t j = 0; j < Layer.size(); j++)
+		{
+			const double *const g = &src_gradients[i][j*row_size];
+			double *const m = &FirstMoments[i][j*row_size];
+			double *const s = &SecondMoments[i][j*row_size];
+
+			// the classic rule keeps its momentum in the neuron, and none for the bias
+			if(OPTIMISER_CLASSIC == optimiser)
+			{
+				update_weights(optimiser, row_size - 1, Layer[j].GetWeightsData(), g, Layer[j].GetPreviousWeightAdjustmentsData(), s, learning_rate, momentum, second_moment_decay, epsilon, first_moment_correction, second_moment_correction);
+				Layer[j].SetBiasWeight(Layer[j].GetBiasWeight() + learning_rate * g[row_size - 1]);
+				continue;
+			}
+
+			update_weights(optimiser, row_size - 1, Layer[j].GetWeightsData(), g, m, s, learning_rate, momentum, second_moment_decay, epsilon, first_moment_correction, second_moment_correction);
+
+			double bias_weight = Layer[j].GetBiasWeight();
+			update_weights(optimiser, 1, &bias_weight, g + row_size - 1, m + row_size - 1, s + row_size - 1, learning_rate, momentum, second_moment_decay, epsilon, first_moment_correction, second_moment_correction);
+			Layer[j].SetBiasWeight(bias_weight);
+		}
+	}
+
+	weights_version++;
+}
+
+size_t FFBPNeuralNet::GetOptimiser(void) const
+{
+	return optimiser;
+}
+
+void FFBPNeuralNet::SetOptimiser(const size_t &src_optimiser)
+{
+	if(src_optimiser > OPTIMISER_ADAM)
+		throw out_of_range("Invalid optimiser.");
+
+	// the decays set so far are kept, whichever order the calls came in
+	const double new_momentum = momentum_set ? momentum : GetDefaultMomentum(src_optimiser);
+	const double new_second_moment_decay = second_moment_decay_set ? second_moment_decay : GetDefaultSecondMomentDecay(src_optimiser);
+
+	if(false == IsValidOptimiserDecays(src_optimiser, new_momentum, new_second_moment_decay))
+		throw out_of_range("Invalid decays for the optimiser.");
+
+	optimiser = src_optimiser;
+	momentum = new_momentum;
+	second_moment_decay = new_second_moment_decay;
+
+	ResetOptimiserState();
+}
+
+double FFBPNeuralNet::GetSecondMomentDecay(void) const
+{
+	return second_moment_decay;
+}
+
+void FFBPNeuralNet::SetSecondMomentDecay(const double &src_second_moment_decay)
+{
+	if(false == IsValidOptimiserDecays(optimiser, momentum, src_second_moment_decay))
+		throw out_of_range("Invalid second moment decay.");
+
+	second_moment_decay = src_second_moment_decay;
+	second_moment_decay_set = true;
+}
+
+double FFBPNeuralNet::GetEpsilon(void) const
+{
+	return epsilon;
+}
+
+void FFBPNeuralNet::SetEpsilon(const double &src_epsilon)
+{
+	epsilon = src_epsilon;
+}
+
+bool FFBPNeuralNet::IsValidOptimiserDecays(const size_t &src_optimiser, const double &src_momentum, const double &src_second_moment_decay)
+{
+	// a momentum of 1 or more never decays the velocity, so it grows without bound
+	if((OPTIMISER_MOMENTUM == src_optimiser || OPTIMISER_NESTEROV == src_optimiser || OPTIMISER_ADAM == src_optimiser) && (src_momentum < 0 || src_momentum >= 1))
+		return false;
+
+	if((OPTIMISER_RMSPROP == src_optimiser || OPTIMISER_ADAM == src_optimiser) && (src_second_moment_decay < 0 || src_second_moment_decay >= 1))
+		return false;
+
+	return true;
+}
+
+double FFBPNeuralNet::GetDefaultMomentum(const size_t &src_optimiser)
+{
+	// the classic rule's is the constructor's, RMSProp has none
+	if(OPTIMISER_CLASSIC == src_optimiser)
+		return 1.0;
+	else if(OPTIMISER_RMSPROP == src_optimiser)
+		return 0.0;
+
+	return 0.9;
+}
+
+double FFBPNeuralNet::GetDefaultSecondMomentDecay(const size_t &src_optimiser)
+{
+	if(OPTIMISER_RMSPROP == src_optimiser)
+		return 0.9;
+
+	return 0.999;
+}
+
+void FFBPNeuralNet::ResetOptimiserState(void)
+{
+	const size_t num_layers = HiddenLayers.size() + 1;
+
+	FirstMoments.resize(num_layers);
+	SecondMoments.resize(num_layers);
+
+	for(size_t i = 0; i < num_layers; i++)
+	{
+		const vector<WeightedNeuron> &Layer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+		const size_t size = Layer.size() * (Layer[0].GetNumInputs() + 1);
+
+		FirstMoments[i].assign(size, 0.0);
+		SecondMoments[i].assign(size, 0.0);
+	}
+
+	optimiser_step = 0;
+}
+
 size_t FFBPNeuralNet::GetNumInputLayerNeurons(void) const
 {
 	return InputLayer.size();
@@ -300,6 +732,8 @@ size_t FFBPNeuralNet::GetNumInputLayerNeurons(void) const
 
 void FFBPNeuralNet::ResetNumInputLayerNeurons(const size_t &src_num_input_neurons)
 {
+	weights_version++;
+
 	if(src_num_input_neurons == 0)
         throw out_of_range("Invalid number of input neurons.");
 
@@ -317,6 +751,8 @@ size_t FFBPNeuralNet::GetNumHiddenLayers(void) const
 
 void FFBPNeuralNet::AddHiddenLayer(const size_t &insert_before_index, const size_t &src_num_hidden_layer_neurons)
 {
+	weights_version++;
+
 	vector<WeightedNeuron> NewHiddenLayer;
 
 	if(insert_before_index == 0) // insert before first layer
@@ -350,6 +786,8 @@ void FFBPNeuralNet::AddHiddenLayer(const size_t &insert_before_index, const size
 
 void FFBPNeuralNet::RemoveHiddenLayer(const size_t &index)
 {
+	weights_version++;
+
 	if(index >= HiddenLayers.size())
 		throw out_of_range("Invalid hidden layer index.");
 
@@ -377,6 +815,8 @@ size_t FFBPNeuralNet::GetNumHiddenLayerNeurons(const size_t &index) const
 
 void FFBPNeuralNet::ResetNumHiddenLayerNeurons(const size_t &index, const size_t &src_num_hidden_layer_neurons)
 {
+	weights_version++;
+
 	if(index >= HiddenLayers.size())
 		throw out_of_range("Invalid hidden layer index.");
 
@@ -440,6 +880,8 @@ size_t FFBPNeuralNet::GetNumOutputLayerNeurons(void) const
 
 void FFBPNeuralNet::ResetNumOutputLayerNeurons(const size_t &src_num_output_neurons)
 {
+	weights_version++;
+
 	if(src_num_output_neurons == 0)
         throw out_of_range("Invalid number of output neurons.");
 
@@ -457,6 +899,25 @@ void FFBPNeuralNet::ResetNumOutputLayerNeurons(const size_t &src_num_output_neur
 	}
 }
 
+const WeightedNeuron &FFBPNeuralNet::GetHiddenLayerNeuron(const size_t &layer_index, const size_t &neuron_index) const
+{
+	if(layer_index >= HiddenLayers.size())
+		throw out_of_range("Invalid hidden layer index.");
+
+	if(neuron_index >= HiddenLayers[layer_index].size())
+		throw out_of_range("Invalid neuron index.");
+
+	return HiddenLayers[layer_index][neuron_index];
+}
+
+const WeightedNeuron &FFBPNeuralNet::GetOutputLayerNeuron(const size_t &neuron_index) const
+{
+	if(neuron_index >= OutputLayer.size())
+		throw out_of_range("Invalid neuron index.");
+
+	return OutputLayer[neuron_index];
+}
+
 double FFBPNeuralNet::GetLearningRate(void) const
 {
 	return learning_rate;
@@ -474,7 +935,183 @@ double FFBPNeuralNet::GetMomentum(void) const
 
 void FFBPNeuralNet::SetMomentum(const double &src_momentum)
 {
+	if(false == IsValidOptimiserDecays(optimiser, src_momentum, second_moment_decay))
+		throw out_of_range("Invalid momentum.");
+
 	momentum = src_momentum;
+	momentum_set = true;
+}
+
+unsigned long long FFBPNeuralNet::GetWeightsVersion(void) const
+{
+	return weights_version;
+}
+
+void FFBPNeuralNet::PruneWeights(const double &threshold)
+{
+	for(size_t i = 0; i <= HiddenLayers.size(); i++)
+	{
+		vector<WeightedNeuron> &Layer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+
+		for(size_t j = 0; j < Layer.size(); j++)
+		{
+			for(size_t k = 0; k < Layer[j].GetNumInputs(); k++)
+			{
+				if(fabs(Layer[j].GetWeight(k)) < threshold)
+				{
+					Layer[j].SetWeight(k, 0.0);
+					Layer[j].SetPreviousWeightAdjustment(k, 0.0);
+				}
+			}
+		}
+	}
+
+	weights_version++;
+
+	UpdateSparseLayers();
+}
+
+void FFBPNeuralNet::PruneWeightsTopK(const size_t &k)
+{
+	if(k == 0)
+		throw out_of_range("Invalid number of weights to keep.");
+
+	vector< pair<double, size_t> > Magnitudes;
+
+	for(size_t i = 0; i <= HiddenLayers.size(); i++)
+	{
+		vector<WeightedNeuron> &Layer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+
+		for(size_t j = 0; j < Layer.size(); j++)
+		{
+			if(Layer[j].GetNumInputs() <= k)
+				continue;
+
+			// largest magnitudes first, ties by index
+			Magnitudes.clear();
+
+			for(size_t l = 0; l < Layer[j].GetNumInputs(); l++)
+				Magnitudes.push_back(pair<double, size_t>(-fabs(Layer[j].GetWeight(l)), l));
+
+			nth_element(Magnitudes.begin(), Magnitudes.begin() + k, Magnitudes.end());
+
+			for(size_t l = k; l < Magnitudes.size(); l++)
+			{
+				Layer[j].SetWeight(Magnitudes[l].second, 0.0);
+				Layer[j].SetPreviousWeightAdjustment(Magnitudes[l].second, 0.0);
+			}
+		}
+	}
+
+	weights_version++;
+
+	UpdateSparseLayers();
+}
+
+bool FFBPNeuralNet::IsSparse(void) const
+{
+	return sparse_version == weights_version;
+}
+
+size_t FFBPNeuralNet::GetNumWeights(void) const
+{
+	size_t num_weights = 0;
+
+	for(size_t i = 0; i < HiddenLayers.size(); i++)
+		for(size_t j = 0; j < HiddenLayers[i].size(); j++)
+			num_weights += HiddenLayers[i][j].GetNumInputs();
+
+	for(size_t i = 0; i < OutputLayer.size(); i++)
+		num_weights += OutputLayer[i].GetNumInputs();
+
+	return num_weights;
+}
+
+size_t FFBPNeuralNet::GetNumNonzeroWeights(void) const
+{
+	size_t num_weights = 0;
+
+	for(size_t i = 0; i <= HiddenLayers.size(); i++)
+	{
+		const vector<WeightedNeuron> &Layer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+
+		for(size_t j = 0; j < Layer.size(); j++)
+			for(size_t k = 0; k < Layer[j].GetNumInputs(); k++)
+				if(0.0 != Layer[j].GetWeight(k))
+					num_weights++;
+	}
+
+	return num_weights;
+}
+
+void FFBPNeuralNet::UpdateSparseLayers(void)
+{
+	SparseLayers.resize(HiddenLayers.size() + 1);
+
+	for(size_t i = 0; i <= HiddenLayers.size(); i++)
+	{
+		const vector<WeightedNeuron> &Layer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+		SparseLayer &Sparse = SparseLayers[i];
+
+		Sparse.RowOffsets.assign(1, 0);
+		Sparse.Columns.clear();
+		Sparse.Values.clear();
+		Sparse.BiasTerms.clear();
+
+		for(size_t j = 0; j < Layer.size(); j++)
+		{
+			for(size_t k = 0; k < Layer[j].GetNumInputs(); k++)
+			{
+				if(0.0 != Layer[j].GetWeight(k))
+				{
+					Sparse.Columns.push_back(static_cast<unsigned int>(k));
+					Sparse.Values.push_back(Layer[j].GetWeight(k));
+				}
+			}
+
+			Sparse.RowOffsets.push_back(Sparse.Values.size());
+			Sparse.BiasTerms.push_back(Layer[j].GetBias() * Layer[j].GetBiasWeight());
+		}
+	}
+
+	sparse_version = weights_version;
+}
+
+void FFBPNeuralNet::SparseFeedForward(const double *const src_inputs, vector< vector<double> > &src_values) const
+{
+	src_values.resize(SparseLayers.size());
+
+	for(size_t i = 0; i < SparseLayers.size(); i++)
+	{
+		const SparseLayer &Sparse = SparseLayers[i];
+		const double *const PreviousLayerValues = (0 == i) ? src_inputs : &src_values[i - 1][0];
+
+		src_values[i].resize(Sparse.BiasTerms.size());
+
+		for(size_t j = 0; j < Sparse.BiasTerms.size(); j++)
+		{
+			double value = Sparse.BiasTerms[j];
+
+			for(size_t k = Sparse.RowOffsets[j]; k < Sparse.RowOffsets[j + 1]; k++)
+				value += PreviousLayerValues[Sparse.Columns[k]] * Sparse.Values[k];
+
+			src_values[i][j] = WeightedNeuron::ActivationFunction(value);
+		}
+	}
+}
+
+void FFBPNeuralNet::UpdateFixedNet(void)
+{
+	// refilled in place, unless a copy of this network still evaluates with it
+	if(0 != FixedNet.get() && true == FixedNet.unique() && true == FixedNet->HasSameShape(*this))
+		FixedNet->CopyWeightsFrom(*this);
+	else
+		FixedNet = CreateFixedFFBPNeuralNet(*this);
+
+	fixed_net_version = weights_version;
+
+	if(0 != FixedNet.get())
+		FixedNetValues.resize(HiddenLayers[0].size() + OutputLayer.size());
 }
 
 void FFBPNeuralNet::SaveToFile(const char *const filename) const
@@ -604,6 +1241,61 @@ void FFBPNeuralNet::SaveToFile(const char *const filename) const
 		if(out.fail())
 			throw runtime_error("Error writing to file.");
 	}
+
+	// a pruned network's nonzero weights follow, older readers stop before them
+	if(true == IsSparse())
+	{
+		out.write(sparse_section_tag, sizeof(sparse_section_tag));
+
+		temp_size_t = SparseLayers.size();
+		out.write((const char *)&temp_size_t, sizeof(size_t));
+
+		for(size_t i = 0; i < SparseLayers.size(); i++)
+		{
+			temp_size_t = SparseLayers[i].BiasTerms.size();
+			out.write((const char *)&temp_size_t, sizeof(size_t));
+
+			temp_size_t = SparseLayers[i].Values.size();
+			out.write((const char *)&temp_size_t, sizeof(size_t));
+
+			out.write((const char *)&SparseLayers[i].RowOffsets[0], SparseLayers[i].RowOffsets.size()*sizeof(size_t));
+
+			if(0 != SparseLayers[i].Values.size())
+			{
+				out.write((const char *)&SparseLayers[i].Columns[0], SparseLayers[i].Columns.size()*sizeof(unsigned int));
+				out.write((const char *)&SparseLayers[i].Values[0], SparseLayers[i].Values.size()*sizeof(double));
+			}
+		}
+
+		if(out.fail())
+			throw runtime_error("Error writing to file.");
+	}
+
+	// the classic rule's state is the previous weight adjustments, already written
+	if(OPTIMISER_CLASSIC != optimiser)
+	{
+		out.write(optimiser_section_tag, sizeof(optimiser_section_tag));
+
+		out.write((const char *)&optimiser, sizeof(size_t));
+		out.write((const char *)&second_moment_decay, sizeof(double));
+		out.write((const char *)&epsilon, sizeof(double));
+		out.write((const char *)&optimiser_step, sizeof(unsigned long long));
+
+		temp_size_t = FirstMoments.size();
+		out.write((const char *)&temp_size_t, sizeof(size_t));
+
+		for(size_t i = 0; i < FirstMoments.size(); i++)
+		{
+			temp_size_t = FirstMoments[i].size();
+			out.write((const char *)&temp_size_t, sizeof(size_t));
+
+			out.write((const char *)&FirstMoments[i][0], FirstMoments[i].size()*sizeof(double));
+			out.write((const char *)&SecondMoments[i][0], SecondMoments[i].size()*sizeof(double));
+		}
+
+		if(out.fail())
+			throw runtime_error("Error writing to file.");
+	}
 }
 
 //have to set number of input neurons
@@ -614,6 +1306,8 @@ void FFBPNeuralNet::LoadFromFile(const char *const filename)
 	if(in.fail() || in.eof())
 		throw runtime_error("Error opening file.");
 
+	weights_version++;
+
 	size_t temp_size_t = 0;
 	double temp_double = 0.0;
 	WeightedNeuron temp_weighted_neuron(1);
@@ -752,4 +1446,114 @@ void FFBPNeuralNet::LoadFromFile(const char *const filename)
 
 		OutputLayer[i].SetBiasWeight(temp_double);
 	}
+
+	// a loaded network is usually played rather than trained
+	UpdateFixedNet();
+
+	// the file's momentum is kept as if set, its second moment decay only comes with the optimiser's state
+	optimiser = OPTIMISER_CLASSIC;
+	momentum_set = true;
+	second_moment_decay_set = false;
+	ResetOptimiserState();
+
+	// optional sections, a pruned network's compressed sparse rows and the optimiser's state
+	char tag[sizeof(sparse_section_tag)];
+
+	while(true)
+	{
+		in.read(tag, sizeof(tag));
+
+		if(in.fail())
+			break;
+
+		if(0 == memcmp(tag, sparse_section_tag, sizeof(tag)))
+			LoadSparseLayers(in);
+		else if(0 == memcmp(tag, optimiser_section_tag, sizeof(tag)))
+			LoadOptimiserState(in);
+		else
+			break;
+	}
+}
+
+void FFBPNeuralNet::LoadSparseLayers(ifstream &in)
+{
+	size_t temp_size_t = 0;
+
+	in.read((char *)&temp_size_t, sizeof(size_t));
+	if(in.fail() || temp_size_t != HiddenLayers.size() + 1)
+		throw runtime_error("Error reading from file.");
+
+	SparseLayers.resize(temp_size_t);
+
+	for(size_t i = 0; i < SparseLayers.size(); i++)
+	{
+		const vector<WeightedNeuron> &Layer = (i < HiddenLayers.size()) ? HiddenLayers[i] : OutputLayer;
+		SparseLayer &Sparse = SparseLayers[i];
+
+		size_t num_rows = 0, num_values = 0;
+
+		in.read((char *)&num_rows, sizeof(size_t));
+		in.read((char *)&num_values, sizeof(size_t));
+		if(in.fail() || num_rows != Layer.size() || num_values > num_rows*Layer[0].GetNumInputs())
+			throw runtime_error("Error reading from file.");
+
+		Sparse.RowOffsets.resize(num_rows + 1);
+		Sparse.Columns.resize(num_values);
+		Sparse.Values.resize(num_values);
+		Sparse.BiasTerms.resize(num_rows);
+
+		in.read((char *)&Sparse.RowOffsets[0], Sparse.RowOffsets.size()*sizeof(size_t));
+
+		if(0 != num_values)
+		{
+			in.read((char *)&Sparse.Columns[0], Sparse.Columns.size()*sizeof(unsigned int));
+			in.read((char *)&Sparse.Values[0], Sparse.Values.size()*sizeof(double));
+		}
+
+		if(in.fail())
+			throw runtime_error("Error reading from file.");
+
+		for(size_t j = 0; j < num_rows; j++)
+		{
+			if(Sparse.RowOffsets[j] > Sparse.RowOffsets[j + 1] || Sparse.RowOffsets[j + 1] > num_values)
+				throw runtime_error("Error reading from file.");
+
+			for(size_t k = Sparse.RowOffsets[j]; k < Sparse.RowOffsets[j + 1]; k++)
+				if(Sparse.Columns[k] >= Layer[j].GetNumInputs())
+					throw runtime_error("Error reading from file.");
+
+			Sparse.BiasTerms[j] = Layer[j].GetBias() * Layer[j].GetBiasWeight();
+		}
+	}
+
+	sparse_version = weights_version;
+}
+
+void FFBPNeuralNet::LoadOptimiserState(ifstream &in)
+{
+	size_t temp_size_t = 0;
+
+	in.read((char *)&optimiser, sizeof(size_t));
+	in.read((char *)&second_moment_decay, sizeof(double));
+	in.read((char *)&epsilon, sizeof(double));
+	in.read((char *)&optimiser_step, sizeof(unsigned long long));
+
+	in.read((char *)&temp_size_t, sizeof(size_t));
+	if(in.fail() || optimiser > OPTIMISER_ADAM || temp_size_t != FirstMoments.size() || false == IsValidOptimiserDecays(optimiser, momentum, second_moment_decay))
+		throw runtime_error("Error reading from file.");
+
+	second_moment_decay_set = true;
+
+	for(size_t i = 0; i < FirstMoments.size(); i++)
+	{
+		in.read((char *)&temp_size_t, sizeof(size_t));
+		if(in.fail() || temp_size_t != FirstMoments[i].size())
+			throw runtime_error("Error reading from file.");
+
+		in.read((char *)&FirstMoments[i][0], FirstMoments[i].size()*sizeof(double));
+		in.read((char *)&SecondMoments[i][0], SecondMoments[i].size()*sizeof(double));
+	}
+
+	if(in.fail())
+		throw runtime_error("Error reading from file.");
 }
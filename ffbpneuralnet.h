@@ -8,6 +8,23 @@
 #include <vector>
 using std::vector;
 
+#include <memory>
+using std::shared_ptr;
+
+#include <fstream>
+using std::ifstream;
+
+
+class FixedFFBPNeuralNetBase;
+
+
+// weight update rules, g being the downhill gradient of the squared error
+#define OPTIMISER_CLASSIC 0		// w += learning_rate*g + momentum*(the previous learning_rate*g)
+#define OPTIMISER_MOMENTUM 1	// v = momentum*v + learning_rate*g, w += v
+#define OPTIMISER_NESTEROV 2	// the same, looking ahead: w += momentum*v + learning_rate*g
+#define OPTIMISER_RMSPROP 3		// s = decay*s + (1 - decay)*g*g, w += learning_rate*g/(sqrt(s) + epsilon)
+#define OPTIMISER_ADAM 4		// RMSProp over a momentum-averaged g, bias corrected
+
 
 class FFBPNeuralNet
 {
@@ -23,6 +40,8 @@ public:
 
         for(size_t i = 0; i < OutputLayer.size(); i++)
             OutputLayer[i].PerturbWeights(scale);
+
+        weights_version++;
             
             vector< vector<WeightedNeuron> > HiddenLayers;
         vector<WeightedNeuron> OutputLayer;
@@ -32,6 +51,11 @@ public:
 	// to feed data into network
 	void FeedForward(const vector<double> &src_inputs);
 
+	// to feed many inputs at once, without changing the network's state, so it is safe to
+	// call from several threads; src_inputs holds num_rows input vectors back to back,
+	// and src_outputs gets num_rows output vectors back to back
+	void FeedForwardBatch(const vector<double> &src_inputs, const size_t num_rows, vector<double> &src_outputs) const;
+
 	// to obtain the outputs based on previously fed data
 	void GetOutputValues(vector<double> &src_outputs);
 
@@ -41,6 +65,31 @@ public:
 	// provide desired outputs, which will be compared against the currently set output values
 	double BackPropagate(const vector<double> &src_desired_outputs);
 
+	// BackPropagate in two halves: the downhill gradient of the squared error for the
+	// last fed input, per layer (hidden layers, then the output layer), neuron-major
+	// with each neuron's bias weight after its weights; then one optimiser step along it
+	double ComputeGradients(const vector<double> &src_desired_outputs, vector< vector<double> > &src_gradients) const;
+	void ApplyGradients(const vector< vector<double> > &src_gradients);
+
+	// the gradient of the sum of the outputs for the last fed input, in the same layout,
+	// for learners that move the outputs themselves (TD(lambda))
+	void ComputeOutputGradients(vector< vector<double> > &src_gradients) const;
+
+	// the update rule, OPTIMISER_*; the momentum is also Adam's first moment decay,
+	// and the second moment decay is RMSProp's and Adam's. The rules' state is
+	// kept in one buffer per layer, and written to the model file. A decay the
+	// caller hasn't set (or a model file didn't hold) takes the selected rule's
+	// usual value: momentum 0.9, RMSProp's decay 0.9, Adam's 0.999. While a rule
+	// is selected the decays it uses must be in [0, 1), the classic rule's
+	// momentum aside; SetOptimiser throws out_of_range rather than select a rule
+	// the decays already set don't suit
+	size_t GetOptimiser(void) const;
+	void SetOptimiser(const size_t &src_optimiser);
+	double GetSecondMomentDecay(void) const;
+	void SetSecondMomentDecay(const double &src_second_moment_decay);
+	double GetEpsilon(void) const;
+	void SetEpsilon(const double &src_epsilon);
+
 	// layer manipulation functions
 	size_t GetNumInputLayerNeurons(void) const;
 	void ResetNumInputLayerNeurons(const size_t &src_num_input_neurons);
@@ -55,6 +104,10 @@ public:
 	size_t GetNumOutputLayerNeurons(void) const;
 	void ResetNumOutputLayerNeurons(const size_t &src_num_output_neurons);
 
+	// read-only access to the weights, for inference outside this class
+	const WeightedNeuron &GetHiddenLayerNeuron(const size_t &layer_index, const size_t &neuron_index) const;
+	const WeightedNeuron &GetOutputLayerNeuron(const size_t &neuron_index) const;
+
 	double GetLearningRate(void) const;
 	void SetLearningRate(const double &src_learning_rate);
 	double GetMomentum(void) const;
@@ -63,13 +116,80 @@ public:
 	void SaveToFile(const char *const filename) const;
 	void LoadFromFile(const char *const filename);
 
+	// changes whenever the weights or the topology change, for caches of the outputs
+	unsigned long long GetWeightsVersion(void) const;
+
+	// magnitude pruning, of every layer: zero the weights below the threshold, or all
+	// but the k largest of each neuron. Until the weights next change, FeedForward uses
+	// the remaining weights in compressed sparse rows, which SaveToFile also writes
+	void PruneWeights(const double &threshold);
+	void PruneWeightsTopK(const size_t &k);
+	bool IsSparse(void) const;
+	size_t GetNumWeights(void) const;
+	size_t GetNumNonzeroWeights(void) const;
+
 protected:
+	// backpropagates the output layer's errors, and multiplies through by each weight's input
+	void ComputeGradientsFromErrors(const vector<double> &src_output_errors, vector< vector<double> > &src_gradients) const;
+
 	vector<double> InputLayer;
 	vector< vector<WeightedNeuron> > HiddenLayers;
 	vector<WeightedNeuron> OutputLayer;
 
 	double learning_rate;
 	double momentum;
+
+	unsigned long long weights_version;
+
+	// a copy of the weights in a compiled-in shape, see fixed_ffbpneuralnet.h,
+	// used while fixed_net_version == weights_version
+	void UpdateFixedNet(void);
+
+	shared_ptr<FixedFFBPNeuralNetBase> FixedNet;
+	vector<double> FixedNetValues;
+	unsigned long long fixed_net_version;
+	unsigned long long last_fed_forward_version;
+
+	// a layer's nonzero weights, one row per neuron
+	class SparseLayer
+	{
+	public:
+		vector<size_t> RowOffsets;
+		vector<unsigned int> Columns;
+		vector<double> Values;
+		vector<double> BiasTerms;
+	};
+
+	// hidden layers then the output layer, used while sparse_version == weights_version
+	void UpdateSparseLayers(void);
+	void LoadSparseLayers(ifstream &in);
+	void SparseFeedForward(const double *const src_inputs, vector< vector<double> > &src_values) const;
+
+	vector<SparseLayer> SparseLayers;
+	vector< vector<double> > SparseValues;
+	unsigned long long sparse_version;
+
+	// whether the decays the optimiser uses are in [0, 1), Adam's bias
+	// corrections divide by zero otherwise
+	static bool IsValidOptimiserDecays(const size_t &src_optimiser, const double &src_momentum, const double &src_second_moment_decay);
+
+	// the decays a rule starts with when they weren't set
+	static double GetDefaultMomentum(const size_t &src_optimiser);
+	static double GetDefaultSecondMomentDecay(const size_t &src_optimiser);
+
+	// laid out like the gradients, zeroed when the topology changes
+	void ResetOptimiserState(void);
+	void LoadOptimiserState(ifstream &in);
+
+	size_t optimiser;
+	double second_moment_decay;
+	bool momentum_set;
+	bool second_moment_decay_set;
+	double epsilon;
+	unsigned long long optimiser_step;
+	vector< vector<double> > FirstMoments;
+	vector< vector<double> > SecondMoments;
+	vector< vector<double> > Gradients;
 };
 
 
@@ -0,0 +1,43 @@
+#include "fixed_ffbpneuralnet.h"
+
+#include <new>
+#include <cstdlib>
+#include <cstdint>
+
+
+void *FixedFFBPNeuralNetBase::operator new(size_t size)
+{
+	// over-allocate, and keep the malloc'd pointer just before the aligned block
+	void *const p = malloc(size + FIXED_FFBP_ALIGNMENT + sizeof(void *));
+
+	if(0 == p)
+		throw std::bad_alloc();
+
+	uintptr_t aligned = (reinterpret_cast<uintptr_t>(p) + sizeof(void *) + FIXED_FFBP_ALIGNMENT - 1) & ~static_cast<uintptr_t>(FIXED_FFBP_ALIGNMENT - 1);
+
+	reinterpret_cast<void **>(aligned)[-1] = p;
+
+	return reinterpret_cast<void *>(aligned);
+}
+
+void FixedFFBPNeuralNetBase::operator delete(void *p)
+{
+	if(0 != p)
+		free(static_cast<void **>(p)[-1]);
+}
+
+shared_ptr<FixedFFBPNeuralNetBase> CreateFixedFFBPNeuralNet(const FFBPNeuralNet &src_NNet)
+{
+	shared_ptr<FixedFFBPNeuralNetBase> FixedNet;
+
+	if(true == FixedOneHotFFBPNeuralNet::HasShape(src_NNet))
+		FixedNet.reset(new FixedOneHotFFBPNeuralNet());
+	else if(true == FixedBinaryFFBPNeuralNet::HasShape(src_NNet))
+		FixedNet.reset(new FixedBinaryFFBPNeuralNet());
+	else
+		return FixedNet;
+
+	FixedNet->CopyWeightsFrom(src_NNet);
+
+	return FixedNet;
+}
@@ -0,0 +1,319 @@
+#ifndef FIXED_FFBPNEURALNET_H
+#define FIXED_FFBPNEURALNET_H
+
+
+#include "ffbpneuralnet.h"
+
+#include <array>
+using std::array;
+
+#include <fstream>
+#include <ios>
+#include <stdexcept>
+#include <cstddef>
+#include <algorithm>
+
+
+// the shapes main.cpp builds, see CreateFixedFFBPNeuralNet
+#define FIXED_FFBP_SHAPE_ONE_HOT_INPUTS 468
+#define FIXED_FFBP_SHAPE_ONE_HOT_HIDDEN 22
+#define FIXED_FFBP_SHAPE_BINARY_INPUTS 208
+#define FIXED_FFBP_SHAPE_BINARY_HIDDEN 14
+
+#define FIXED_FFBP_ALIGNMENT 64
+
+
+// What FFBPNeuralNet dispatches to: a stateless forward pass over values laid
+// out as [hidden layer values][output layer values]. Allocated on
+// FIXED_FFBP_ALIGNMENT byte boundaries, so the weight arrays are aligned.
+class FixedFFBPNeuralNetBase
+{
+public:
+	virtual ~FixedFFBPNeuralNetBase(void) {}
+
+	virtual void Evaluate(const double *const src_inputs, double *const src_values) const = 0;
+
+	// refills the weights and biases Evaluate reads, and nothing else, from a
+	// network of the same shape
+	virtual bool HasSameShape(const FFBPNeuralNet &src_NNet) const = 0;
+	virtual void CopyWeightsFrom(const FFBPNeuralNet &src_NNet) = 0;
+
+	static void *operator new(size_t size);
+	static void operator delete(void *p);
+};
+
+// The FFBPNeuralNet with one hidden layer, with its sizes known at compile
+// time. Weights are neuron-major in fixed arrays, so every loop has a
+// constant trip count that the compiler can unroll and vectorise. The math,
+// including the momentum and bias updates, is FFBPNeuralNet's, and the file
+// format is SaveToFile's.
+template<size_t NumInputs, size_t NumHiddenNeurons, size_t NumOutputs>
+class FixedFFBPNeuralNet : public FixedFFBPNeuralNetBase
+{
+public:
+	// empty, for CopyFrom or CopyWeightsFrom to fill
+	FixedFFBPNeuralNet(void)
+	{
+		learning_rate = 0;
+		momentum = 0;
+	}
+
+	FixedFFBPNeuralNet(const FFBPNeuralNet &src_NNet)
+	{
+		CopyFrom(src_NNet);
+	}
+
+	FixedFFBPNeuralNet(const char *const src_filename)
+	{
+		LoadFromFile(src_filename);
+	}
+
+	static bool HasShape(const FFBPNeuralNet &src_NNet)
+	{
+		return NumInputs == src_NNet.GetNumInputLayerNeurons() &&
+		       1 == src_NNet.GetNumHiddenLayers() &&
+		       NumHiddenNeurons == src_NNet.GetNumHiddenLayerNeurons(0) &&
+		       NumOutputs == src_NNet.GetNumOutputLayerNeurons();
+	}
+
+	bool HasSameShape(const FFBPNeuralNet &src_NNet) const
+	{
+		return HasShape(src_NNet);
+	}
+
+	void CopyWeightsFrom(const FFBPNeuralNet &src_NNet)
+	{
+		if(false == HasShape(src_NNet))
+			throw std::out_of_range("Network shape doesn't match.");
+
+		for(size_t i = 0; i < NumHiddenNeurons; i++)
+		{
+			const WeightedNeuron &neuron = src_NNet.GetHiddenLayerNeuron(0, i);
+			const double *const weights = neuron.GetWeightsData();
+
+			std::copy(weights, weights + NumInputs, &HiddenWeights[i*NumInputs]);
+
+			HiddenBiases[i] = neuron.GetBias();
+			HiddenBiasWeights[i] = neuron.GetBiasWeight();
+		}
+
+		for(size_t i = 0; i < NumOutputs; i++)
+		{
+			const WeightedNeuron &neuron = src_NNet.GetOutputLayerNeuron(i);
+			const double *const weights = neuron.GetWeightsData();
+
+			std::copy(weights, weights + NumHiddenNeurons, &OutputWeights[i*NumHiddenNeurons]);
+
+			OutputBiases[i] = neuron.GetBias();
+			OutputBiasWeights[i] = neuron.GetBiasWeight();
+		}
+	}
+
+	// CopyWeightsFrom, plus the training state and values, for training this copy on its own
+	void CopyFrom(const FFBPNeuralNet &src_NNet)
+	{
+		CopyWeightsFrom(src_NNet);
+
+		learning_rate = src_NNet.GetLearningRate();
+		momentum = src_NNet.GetMomentum();
+
+		for(size_t i = 0; i < NumHiddenNeurons; i++)
+		{
+			const WeightedNeuron &neuron = src_NNet.GetHiddenLayerNeuron(0, i);
+
+			for(size_t j = 0; j < NumInputs; j++)
+				HiddenPreviousWeightAdjustments[i*NumInputs + j] = neuron.GetPreviousWeightAdjustment(j);
+
+			Values[i] = neuron.GetValue();
+		}
+
+		for(size_t i = 0; i < NumOutputs; i++)
+		{
+			const WeightedNeuron &neuron = src_NNet.GetOutputLayerNeuron(i);
+
+			for(size_t j = 0; j < NumHiddenNeurons; j++)
+				OutputPreviousWeightAdjustments[i*NumHiddenNeurons + j] = neuron.GetPreviousWeightAdjustment(j);
+
+			Values[NumHiddenNeurons + i] = neuron.GetValue();
+		}
+
+		Inputs.fill(0.0);
+	}
+
+	void Evaluate(const double *const src_inputs, double *const src_values) const
+	{
+		for(size_t i = 0; i < NumHiddenNeurons; i++)
+		{
+			const double *const weights = &HiddenWeights[i*NumInputs];
+			double value = HiddenBiases[i] * HiddenBiasWeights[i];
+
+			for(size_t j = 0; j < NumInputs; j++)
+				value += src_inputs[j] * weights[j];
+
+			src_values[i] = WeightedNeuron::ActivationFunction(value);
+		}
+
+		for(size_t i = 0; i < NumOutputs; i++)
+		{
+			const double *const weights = &OutputWeights[i*NumHiddenNeurons];
+			double value = OutputBiases[i] * OutputBiasWeights[i];
+
+			for(size_t j = 0; j < NumHiddenNeurons; j++)
+				value += src_values[j] * weights[j];
+
+			src_values[NumHiddenNeurons + i] = WeightedNeuron::ActivationFunction(value);
+		}
+	}
+
+	void FeedForward(const vector<double> &src_inputs)
+	{
+		if(src_inputs.size() != NumInputs)
+			throw std::out_of_range("Invalid input vector size.");
+
+		for(size_t i = 0; i < NumInputs; i++)
+			Inputs[i] = src_inputs[i];
+
+		Evaluate(&Inputs[0], &Values[0]);
+	}
+
+	void GetOutputValues(vector<double> &src_outputs) const
+	{
+		src_outputs.assign(Values.begin() + NumHiddenNeurons, Values.end());
+	}
+
+	double BackPropagate(const vector<double> &src_desired_outputs)
+	{
+		const double *const HiddenValues = &Values[0];
+		const double *const OutputValues = &Values[NumHiddenNeurons];
+
+		array<double, NumOutputs> OutputErrors;
+		array<double, NumHiddenNeurons> HiddenErrors;
+
+		double error_rate = 0.0;
+
+		for(size_t i = 0; i < NumOutputs; i++)
+		{
+			OutputErrors[i] = WeightedNeuron::DerivativeOfActivationFunction(OutputValues[i]) * (src_desired_outputs[i] - OutputValues[i]);
+			error_rate += (OutputValues[i] - src_desired_outputs[i]) * (OutputValues[i] - src_desired_outputs[i]);
+		}
+
+		error_rate /= static_cast<double>(NumOutputs);
+
+		for(size_t i = 0; i < NumHiddenNeurons; i++)
+		{
+			double sum = 0.0;
+
+			for(size_t j = 0; j < NumOutputs; j++)
+				sum += OutputErrors[j] * OutputWeights[j*NumHiddenNeurons + i];
+
+			HiddenErrors[i] = sum * WeightedNeuron::DerivativeOfActivationFunction(HiddenValues[i]);
+		}
+
+		for(size_t i = 0; i < NumOutputs; i++)
+		{
+			double *const weights = &OutputWeights[i*NumHiddenNeurons];
+			double *const previous_adjustments = &OutputPreviousWeightAdjustments[i*NumHiddenNeurons];
+
+			for(size_t j = 0; j < NumHiddenNeurons; j++)
+			{
+				const double delta_weight = learning_rate * OutputErrors[i] * HiddenValues[j];
+				weights[j] = weights[j] + delta_weight + momentum * previous_adjustments[j];
+				previous_adjustments[j] = delta_weight;
+			}
+
+			OutputBiasWeights[i] += learning_rate * OutputErrors[i] * OutputBiases[i];
+		}
+
+		for(size_t i = 0; i < NumHiddenNeurons; i++)
+		{
+			double *const weights = &HiddenWeights[i*NumInputs];
+			double *const previous_adjustments = &HiddenPreviousWeightAdjustments[i*NumInputs];
+
+			for(size_t j = 0; j < NumInputs; j++)
+			{
+				const double delta_weight = learning_rate * HiddenErrors[i] * Inputs[j];
+				weights[j] = weights[j] + delta_weight + momentum * previous_adjustments[j];
+				previous_adjustments[j] = delta_weight;
+			}
+
+			HiddenBiasWeights[i] += learning_rate * HiddenErrors[i] * HiddenBiases[i];
+		}
+
+		return error_rate;
+	}
+
+	void SaveToFile(const char *const filename) const
+	{
+		std::ofstream out(filename, std::ios::binary);
+
+		if(out.fail())
+			throw std::runtime_error("Error creating/opening file.");
+
+		const size_t header[4] = { NumInputs, 1, NumHiddenNeurons, NumOutputs };
+
+		out.write((const char *)header, 4*sizeof(size_t));
+		out.write((const char *)&learning_rate, sizeof(double));
+		out.write((const char *)&momentum, sizeof(double));
+
+		for(size_t i = 0; i < NumHiddenNeurons; i++)
+			WriteNeuron(out, NumInputs, &HiddenWeights[i*NumInputs], &HiddenPreviousWeightAdjustments[i*NumInputs], HiddenBiases[i], HiddenBiasWeights[i]);
+
+		for(size_t i = 0; i < NumOutputs; i++)
+			WriteNeuron(out, NumHiddenNeurons, &OutputWeights[i*NumHiddenNeurons], &OutputPreviousWeightAdjustments[i*NumHiddenNeurons], OutputBiases[i], OutputBiasWeights[i]);
+
+		if(out.fail())
+			throw std::runtime_error("Error writing to file.");
+	}
+
+	void LoadFromFile(const char *const filename)
+	{
+		// FFBPNeuralNet does the parsing, and says which shape it is
+		FFBPNeuralNet NNet(filename);
+
+		CopyFrom(NNet);
+	}
+
+	double GetLearningRate(void) const { return learning_rate; }
+	void SetLearningRate(const double &src_learning_rate) { learning_rate = src_learning_rate; }
+	double GetMomentum(void) const { return momentum; }
+	void SetMomentum(const double &src_momentum) { momentum = src_momentum; }
+
+protected:
+	static void WriteNeuron(std::ofstream &out, const size_t num_inputs, const double *const weights, const double *const previous_adjustments, const double bias, const double bias_weight)
+	{
+		out.write((const char *)&num_inputs, sizeof(size_t));
+
+		for(size_t i = 0; i < num_inputs; i++)
+		{
+			out.write((const char *)&weights[i], sizeof(double));
+			out.write((const char *)&previous_adjustments[i], sizeof(double));
+		}
+
+		out.write((const char *)&bias, sizeof(double));
+		out.write((const char *)&bias_weight, sizeof(double));
+	}
+
+	alignas(FIXED_FFBP_ALIGNMENT) array<double, NumHiddenNeurons*NumInputs> HiddenWeights;
+	alignas(FIXED_FFBP_ALIGNMENT) array<double, NumHiddenNeurons*NumInputs> HiddenPreviousWeightAdjustments;
+	alignas(FIXED_FFBP_ALIGNMENT) array<double, NumOutputs*NumHiddenNeurons> OutputWeights;
+	alignas(FIXED_FFBP_ALIGNMENT) array<double, NumOutputs*NumHiddenNeurons> OutputPreviousWeightAdjustments;
+	alignas(FIXED_FFBP_ALIGNMENT) array<double, NumInputs> Inputs;
+	alignas(FIXED_FFBP_ALIGNMENT) array<double, NumHiddenNeurons + NumOutputs> Values;
+
+	array<double, NumHiddenNeurons> HiddenBiases;
+	array<double, NumHiddenNeurons> HiddenBiasWeights;
+	array<double, NumOutputs> OutputBiases;
+	array<double, NumOutputs> OutputBiasWeights;
+
+	double learning_rate;
+	double momentum;
+};
+
+typedef FixedFFBPNeuralNet<FIXED_FFBP_SHAPE_ONE_HOT_INPUTS, FIXED_FFBP_SHAPE_ONE_HOT_HIDDEN, 1> FixedOneHotFFBPNeuralNet;
+typedef FixedFFBPNeuralNet<FIXED_FFBP_SHAPE_BINARY_INPUTS, FIXED_FFBP_SHAPE_BINARY_HIDDEN, 1> FixedBinaryFFBPNeuralNet;
+
+// a copy of the network's weights (CopyWeightsFrom) in the matching compiled-in shape, or 0
+shared_ptr<FixedFFBPNeuralNetBase> CreateFixedFFBPNeuralNet(const FFBPNeuralNet &src_NNet);
+
+
+#endif
@@ -0,0 +1,267 @@
+#include "game_record.h"
+
+#include <ios>
+using std::ios;
+
+#include <stdexcept>
+using std::runtime_error;
+using std::out_of_range;
+
+#include <cstring>
+#include <cmath>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+#define GAME_RECORD_WRITE_BUFFER_SIZE 65536
+#define GAME_RECORD_READ_BUFFER_SIZE (1 << 20)
+
+
+static const unsigned char game_record_header[GAME_RECORD_HEADER_SIZE] = { 'B', 'P', 'G', 'R', GAME_RECORD_VERSION, NUM_PLAYERS, NUM_CARDS_PER_HAND, 0 };
+
+
+void game_record::set(const blind_poker_table &table)
+{
+    if(MAX_NUM_TURNS != table.get_num_turns())
+        throw runtime_error("Game isn't finished.");
+    
+    table.get_deck_order(deck_order);
+    
+    for(size_t i = 0; i < MAX_NUM_TURNS; i++)
+        turns[i] = table.get_turn(i);
+    
+    vector< vector<size_t> > ranking;
+    table.get_showdown_ranking(ranking);
+    
+    winners = 0;
+    
+    for(size_t i = 0; i < ranking[0].size(); i++)
+        winners |= static_cast<unsigned char>(1 << ranking[0][i]);
+}
+
+game_record_writer::game_record_writer(const char *const filename)
+{
+    out.open(filename, ios::binary | ios::app);
+    
+    if(out.fail())
+        throw runtime_error("Error creating/opening file.");
+    
+    // a new log starts with the header
+    out.seekp(0, ios::end);
+    
+    if(0 == out.tellp())
+    {
+        out.write((const char *)game_record_header, GAME_RECORD_HEADER_SIZE);
+        
+        if(out.fail())
+            throw runtime_error("Error writing to file.");
+    }
+    
+    buffer.reserve(GAME_RECORD_WRITE_BUFFER_SIZE);
+}
+
+game_record_writer::~game_record_writer(void)
+{
+    // can't throw from here
+    if(0 != buffer.size())
+        out.write((const char *)&buffer[0], buffer.size());
+}
+
+void game_record_writer::write(const blind_poker_table &table)
+{
+    game_record record;
+    record.set(table);
+    
+    write(record);
+}
+
+void game_record_writer::write(const game_record &record)
+{
+    buffer.insert(buffer.end(), record.deck_order, record.deck_order + NUM_CARDS_PER_DECK);
+    buffer.insert(buffer.end(), record.turns, record.turns + MAX_NUM_TURNS);
+    buffer.push_back(record.winners);
+    
+    if(buffer.size() + GAME_RECORD_SIZE > GAME_RECORD_WRITE_BUFFER_SIZE)
+        flush();
+}
+
+void game_record_writer::flush(void)
+{
+    if(0 != buffer.size())
+        out.write((const char *)&buffer[0], buffer.size());
+    
+    out.flush();
+    
+    if(out.fail())
+        throw runtime_error("Error writing to file.");
+    
+    buffer.clear();
+}
+
+game_record_reader::game_record_reader(const char *const filename)
+{
+    mapped_data = 0;
+    mapped_size = 0;
+    mapped_offset = 0;
+    
+#ifndef _WIN32
+    
+    int fd = open(filename, O_RDONLY);
+    
+    if(-1 == fd)
+        throw runtime_error("Error opening file.");
+    
+    struct stat file_stat;
+    
+    if(0 == fstat(fd, &file_stat) && S_ISREG(file_stat.st_mode) && file_stat.st_size >= GAME_RECORD_HEADER_SIZE)
+    {
+        void *data = mmap(0, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        
+        if(MAP_FAILED != data)
+        {
+            madvise(data, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+            
+            mapped_data = static_cast<const unsigned char *>(data);
+            mapped_size = static_cast<size_t>(file_stat.st_size);
+        }
+    }
+    
+    close(fd);
+    
+    if(0 != mapped_data)
+    {
+        try
+        {
+            check_header(mapped_data);
+        }
+        catch(...)
+        {
+            munmap(const_cast<unsigned char *>(mapped_data), mapped_size);
+            throw;
+        }
+        
+        mapped_offset = GAME_RECORD_HEADER_SIZE;
+        return;
+    }
+    
+#endif
+    
+    // fall back to streaming
+    stream_buffer.resize(GAME_RECORD_READ_BUFFER_SIZE);
+    in.rdbuf()->pubsetbuf(&stream_buffer[0], stream_buffer.size());
+    
+    in.open(filename, ios::binary);
+    
+    if(in.fail())
+        throw runtime_error("Error opening file.");
+    
+    unsigned char header[GAME_RECORD_HEADER_SIZE];
+    in.read((char *)header, GAME_RECORD_HEADER_SIZE);
+    
+    if(in.fail())
+        throw runtime_error("Error reading from file.");
+    
+    check_header(header);
+}
+
+game_record_reader::~game_record_reader(void)
+{
+#ifndef _WIN32
+    
+    if(0 != mapped_data)
+        munmap(const_cast<unsigned char *>(mapped_data), mapped_size);
+    
+#endif
+}
+
+bool game_record_reader::read(game_record &record)
+{
+    unsigned char temp_record[GAME_RECORD_SIZE];
+    const unsigned char *data = temp_record;
+    
+    if(0 != mapped_data)
+    {
+        // a partly written last record is ignored
+        if(mapped_offset + GAME_RECORD_SIZE > mapped_size)
+            return false;
+        
+        data = mapped_data + mapped_offset;
+        mapped_offset += GAME_RECORD_SIZE;
+    }
+    else
+    {
+        in.read((char *)temp_record, GAME_RECORD_SIZE);
+        
+        if(in.fail())
+            return false;
+    }
+    
+    memcpy(record.deck_order, data, NUM_CARDS_PER_DECK);
+    memcpy(record.turns, data + NUM_CARDS_PER_DECK, MAX_NUM_TURNS);
+    record.winners = data[NUM_CARDS_PER_DECK + MAX_NUM_TURNS];
+    
+    return true;
+}
+
+void game_record_reader::check_header(const unsigned char *const header)
+{
+    if(0 != memcmp(header, game_record_header, 4))
+        throw runtime_error("Not a game record file.");
+    
+    if(0 != memcmp(header, game_record_header, GAME_RECORD_HEADER_SIZE))
+        throw runtime_error("Game record file is for a different version or game size.");
+}
+
+size_t train_from_game_records(const char *const filename, vector<FFBPNeuralNet> &NNets)
+{
+    if(NNets.size() != NUM_PLAYERS - 1)
+        throw out_of_range("Invalid number of networks.");
+    
+    game_record_reader reader(filename);
+    game_record record;
+    
+    size_t num_games = 0;
+    
+    while(true == reader.read(record))
+    {
+        blind_poker_table bpt;
+        bpt.reset_table(record.deck_order);
+        
+        vector< vector<input_output_pair> > nnet_io;
+        nnet_io.resize(NUM_PLAYERS);
+        
+        // with each seat network's own inputs, seat 0's samples aren't used
+        for(size_t i = 0; i < MAX_NUM_TURNS; i++)
+        {
+            const size_t seat = bpt.get_current_player();
+            
+            bpt.play_recorded_turn(record.turns[i], nnet_io[seat], 0 == seat ? 0 : &NNets[seat - 1]);
+        }
+        
+        // seat 0 is the random player, the others learn as in the serial loop
+        for(size_t i = 1; i < NUM_PLAYERS; i++)
+        {
+            // if winner, do nothing
+            if(0 != (record.winners & (1 << i)))
+                continue;
+            
+            for(size_t j = 0; j < nnet_io[i].size(); j++)
+            {
+                // if loser, switch 0 for 1 and 1 for 0
+                nnet_io[i][j].output[0] = 1.0 - nnet_io[i][j].output[0];
+                
+                NNets[i - 1].FeedForward(nnet_io[i][j].input);
+                NNets[i - 1].BackPropagate(nnet_io[i][j].output);
+            }
+        }
+        
+        num_games++;
+    }
+    
+    return num_games;
+}
@@ -0,0 +1,90 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+
+#include "cards.h"
+
+#include <fstream>
+using std::ofstream;
+using std::ifstream;
+
+
+// Append-only binary game log.
+//
+// file header, 8 bytes:
+//   "BPGR", format version, NUM_PLAYERS, NUM_CARDS_PER_HAND, 0
+// then fixed size records of GAME_RECORD_SIZE bytes:
+//   NUM_CARDS_PER_DECK card ids, the deck bottom card first
+//   MAX_NUM_TURNS turns, see blind_poker_table::get_turn
+//   one byte with bit i set if player i won or tied for the win
+//
+// The deck order and turns are enough to replay the whole game, so any
+// network input encoding can be rebuilt from a log later.
+
+#define GAME_RECORD_VERSION 1
+#define GAME_RECORD_HEADER_SIZE 8
+#define GAME_RECORD_SIZE (NUM_CARDS_PER_DECK + MAX_NUM_TURNS + 1)
+
+
+class game_record
+{
+public:
+    
+    // from a finished game
+    void set(const blind_poker_table &table);
+    
+    unsigned char deck_order[NUM_CARDS_PER_DECK];
+    unsigned char turns[MAX_NUM_TURNS];
+    unsigned char winners;
+};
+
+class game_record_writer
+{
+public:
+    
+    game_record_writer(const char *const filename);
+    ~game_record_writer(void);
+    
+    void write(const blind_poker_table &table);
+    void write(const game_record &record);
+    void flush(void);
+    
+protected:
+    
+    ofstream out;
+    vector<unsigned char> buffer;
+};
+
+// Reads a log front to back, memory-mapped where the platform allows it
+// (with a sequential access hint, so the kernel reads ahead), otherwise
+// streamed through a large read buffer.
+class game_record_reader
+{
+public:
+    
+    game_record_reader(const char *const filename);
+    ~game_record_reader(void);
+    
+    // false at the end of the log
+    bool read(game_record &record);
+    
+protected:
+    
+    static void check_header(const unsigned char *const header);
+    
+    // mapped file, or 0 when streaming
+    const unsigned char *mapped_data;
+    size_t mapped_size;
+    size_t mapped_offset;
+    
+    ifstream in;
+    vector<char> stream_buffer;
+};
+
+// Rebuilds the inputs play_ANN saw from every game in the log and trains the
+// seat networks (NNets[i] plays seat i + 1) the way the serial loop does.
+// Returns the number of games.
+size_t train_from_game_records(const char *const filename, vector<FFBPNeuralNet> &NNets);
+
+
+#endif
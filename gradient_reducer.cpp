@@ -0,0 +1,337 @@
+#include "gradient_reducer.h"
+
+#include <stdexcept>
+using std::out_of_range;
+
+#include <atomic>
+using std::memory_order_relaxed;
+
+
+// adds value to sum, keeping the low bits lost in compensation (Kahan)
+static inline void add_compensated(double &sum, double &compensation, const double value)
+{
+    const double y = value - compensation;
+    const double t = sum + y;
+    
+    compensation = (t - sum) - y;
+    sum = t;
+}
+
+static inline void add_atomic(atomic<double> &sum, const double value)
+{
+    double expected = sum.load(memory_order_relaxed);
+    
+    while(false == sum.compare_exchange_weak(expected, expected + value, memory_order_relaxed))
+        ;
+}
+
+
+gradient_reducer::gradient_reducer(const size_t src_num_threads, const size_t src_block_size, const size_t src_summation) : pool(src_num_threads)
+{
+    if(0 == src_block_size)
+        throw out_of_range("Invalid block size.");
+    
+    if(GRADIENT_SUMMATION_PLAIN != src_summation && GRADIENT_SUMMATION_KAHAN != src_summation)
+        throw out_of_range("Invalid summation.");
+    
+    block_size = src_block_size;
+    summation = src_summation;
+    
+    sample_gradients.resize(pool.get_num_threads());
+}
+
+void gradient_reducer::prepare(const FFBPNeuralNet &NNet, const vector<input_output_pair> &samples, const size_t num_buffers, vector< vector<double> > &gradients)
+{
+    // the tasks must not throw, so check everything ComputeGradients would
+    for(size_t i = 0; i < samples.size(); i++)
+        if(samples[i].input.size() != NNet.GetNumInputLayerNeurons() || samples[i].output.size() != NNet.GetNumOutputLayerNeurons())
+            throw out_of_range("Invalid sample size.");
+    
+    // FeedForward keeps the neuron values, so each thread feeds its own copy
+    if(NNets.size() != pool.get_num_threads())
+        NNets.assign(pool.get_num_threads(), NNet);
+    else
+        for(size_t i = 0; i < NNets.size(); i++)
+            NNets[i] = NNet;
+    
+    // ComputeGradients' layout: each neuron's weights then its bias weight
+    const size_t num_layers = NNet.GetNumHiddenLayers() + 1;
+    
+    gradients.resize(num_layers);
+    
+    size_t num_inputs = NNet.GetNumInputLayerNeurons();
+    
+    for(size_t i = 0; i < num_layers; i++)
+    {
+        const size_t num_neurons = (i < num_layers - 1) ? NNet.GetNumHiddenLayerNeurons(i) : NNet.GetNumOutputLayerNeurons();
+        
+        gradients[i].resize(num_neurons*(num_inputs + 1));
+        
+        num_inputs = num_neurons;
+    }
+    
+    if(block_sums.size() < num_buffers)
+    {
+        block_sums.resize(num_buffers);
+        block_compensations.resize(num_buffers);
+        block_errors.resize(num_buffers);
+    }
+    
+    for(size_t i = 0; i < num_buffers; i++)
+    {
+        block_sums[i].resize(num_layers);
+        
+        if(GRADIENT_SUMMATION_KAHAN == summation)
+            block_compensations[i].resize(num_layers);
+        
+        for(size_t j = 0; j < num_layers; j++)
+        {
+            block_sums[i][j].resize(gradients[j].size());
+            
+            if(GRADIENT_SUMMATION_KAHAN == summation)
+                block_compensations[i][j].resize(gradients[j].size());
+        }
+    }
+}
+
+double gradient_reducer::compute(const FFBPNeuralNet &NNet, const vector<input_output_pair> &samples, vector< vector<double> > &gradients)
+{
+    const size_t num_blocks = (samples.size() + block_size - 1) / block_size;
+    
+    prepare(NNet, samples, num_blocks, gradients);
+    
+    if(0 == num_blocks)
+    {
+        for(size_t i = 0; i < gradients.size(); i++)
+            gradients[i].assign(gradients[i].size(), 0.0);
+        
+        return 0;
+    }
+    
+    // the leaves
+    for(size_t i = 0; i < pool.get_num_threads(); i++)
+        pool.add_task([this, &samples, i]() { sum_blocks(i, samples); });
+    
+    pool.wait();
+    
+    // the tree, a slice of each layer per thread
+    for(size_t i = 0; i < pool.get_num_threads(); i++)
+        pool.add_task([this, num_blocks, &gradients, i]() { reduce_blocks(i, num_blocks, gradients); });
+    
+    pool.wait();
+    
+    // in block order too
+    double error_sum = 0;
+    
+    for(size_t i = 0; i < num_blocks; i++)
+        error_sum += block_errors[i];
+    
+    return error_sum;
+}
+
+double gradient_reducer::compute_atomic(const FFBPNeuralNet &NNet, const vector<input_output_pair> &samples, vector< vector<double> > &gradients)
+{
+    // a buffer per thread this time
+    prepare(NNet, samples, pool.get_num_threads(), gradients);
+    
+    size_t num_weights = 0;
+    
+    for(size_t i = 0; i < gradients.size(); i++)
+        num_weights += gradients[i].size();
+    
+    // atomics can't be moved, so a new vector is swapped in rather than resized
+    if(atomic_sums.size() != num_weights)
+        vector< atomic<double> >(num_weights).swap(atomic_sums);
+    
+    for(size_t i = 0; i < atomic_sums.size(); i++)
+        atomic_sums[i].store(0.0, memory_order_relaxed);
+    
+    atomic_error.store(0.0, memory_order_relaxed);
+    
+    for(size_t i = 0; i < pool.get_num_threads(); i++)
+        pool.add_task([this, &samples, i]() { sum_atomic(i, samples); });
+    
+    pool.wait();
+    
+    size_t offset = 0;
+    
+    for(size_t i = 0; i < gradients.size(); i++)
+    {
+        for(size_t j = 0; j < gradients[i].size(); j++)
+            gradients[i][j] = atomic_sums[offset + j].load(memory_order_relaxed);
+        
+        offset += gradients[i].size();
+    }
+    
+    return atomic_error.load(memory_order_relaxed);
+}
+
+double gradient_reducer::train(FFBPNeuralNet &NNet, const vector<input_output_pair> &samples)
+{
+    if(0 == samples.size())
+        return 0;
+    
+    const double error_sum = compute(NNet, samples, mean_gradients);
+    
+    // ApplyGradients takes one sample's worth
+    const double scale = 1.0 / static_cast<double>(samples.size());
+    
+    for(size_t i = 0; i < mean_gradients.size(); i++)
+        for(size_t j = 0; j < mean_gradients[i].size(); j++)
+            mean_gradients[i][j] *= scale;
+    
+    NNet.ApplyGradients(mean_gradients);
+    
+    return error_sum * scale;
+}
+
+size_t gradient_reducer::get_num_threads(void) const
+{
+    return pool.get_num_threads();
+}
+
+size_t gradient_reducer::get_block_size(void) const
+{
+    return block_size;
+}
+
+size_t gradient_reducer::get_summation(void) const
+{
+    return summation;
+}
+
+void gradient_reducer::sum_blocks(const size_t thread_index, const vector<input_output_pair> &samples)
+{
+    const size_t num_blocks = (samples.size() + block_size - 1) / block_size;
+    
+    FFBPNeuralNet &NNet = NNets[thread_index];
+    vector< vector<double> > &g = sample_gradients[thread_index];
+    
+    // which thread takes a block doesn't change its sum
+    for(size_t i = thread_index; i < num_blocks; i += pool.get_num_threads())
+    {
+        vector< vector<double> > &sums = block_sums[i];
+        
+        for(size_t j = 0; j < sums.size(); j++)
+        {
+            sums[j].assign(sums[j].size(), 0.0);
+            
+            if(GRADIENT_SUMMATION_KAHAN == summation)
+                block_compensations[i][j].assign(sums[j].size(), 0.0);
+        }
+        
+        block_errors[i] = 0;
+        
+        const size_t last_sample = (samples.size() < (i + 1)*block_size) ? samples.size() : (i + 1)*block_size;
+        
+        for(size_t j = i*block_size; j < last_sample; j++)
+        {
+            NNet.FeedForward(samples[j].input);
+            block_errors[i] += NNet.ComputeGradients(samples[j].output, g);
+            
+            for(size_t k = 0; k < sums.size(); k++)
+            {
+                double *const s = &sums[k][0];
+                const double *const x = &g[k][0];
+                const size_t n = sums[k].size();
+                
+                if(GRADIENT_SUMMATION_KAHAN == summation)
+                {
+                    double *const c = &block_compensations[i][k][0];
+                    
+                    for(size_t l = 0; l < n; l++)
+                        add_compensated(s[l], c[l], x[l]);
+                }
+                else
+                {
+                    for(size_t l = 0; l < n; l++)
+                        s[l] += x[l];
+                }
+            }
+        }
+    }
+}
+
+void gradient_reducer::reduce_blocks(const size_t thread_index, const size_t num_blocks, vector< vector<double> > &gradients)
+{
+    const size_t num_threads = pool.get_num_threads();
+    
+    for(size_t i = 0; i < gradients.size(); i++)
+    {
+        const size_t first = gradients[i].size()*thread_index / num_threads;
+        const size_t last = gradients[i].size()*(thread_index + 1) / num_threads;
+        
+        for(size_t stride = 1; stride < num_blocks; stride *= 2)
+        {
+            for(size_t j = 0; j + stride < num_blocks; j += 2*stride)
+            {
+                double *const s = &block_sums[j][i][0];
+                const double *const t = &block_sums[j + stride][i][0];
+                
+                if(GRADIENT_SUMMATION_KAHAN == summation)
+                {
+                    double *const c = &block_compensations[j][i][0];
+                    const double *const d = &block_compensations[j + stride][i][0];
+                    
+                    // the other leaf's sum, less what it lost
+                    for(size_t k = first; k < last; k++)
+                    {
+                        add_compensated(s[k], c[k], t[k]);
+                        add_compensated(s[k], c[k], -d[k]);
+                    }
+                }
+                else
+                {
+                    for(size_t k = first; k < last; k++)
+                        s[k] += t[k];
+                }
+            }
+        }
+        
+        for(size_t k = first; k < last; k++)
+        {
+            if(GRADIENT_SUMMATION_KAHAN == summation)
+                gradients[i][k] = block_sums[0][i][k] - block_compensations[0][i][k];
+            else
+                gradients[i][k] = block_sums[0][i][k];
+        }
+    }
+}
+
+void gradient_reducer::sum_atomic(const size_t thread_index, const vector<input_output_pair> &samples)
+{
+    const size_t num_threads = pool.get_num_threads();
+    const size_t first_sample = samples.size()*thread_index / num_threads;
+    const size_t last_sample = samples.size()*(thread_index + 1) / num_threads;
+    
+    FFBPNeuralNet &NNet = NNets[thread_index];
+    vector< vector<double> > &g = sample_gradients[thread_index];
+    vector< vector<double> > &sums = block_sums[thread_index];
+    
+    for(size_t i = 0; i < sums.size(); i++)
+        sums[i].assign(sums[i].size(), 0.0);
+    
+    double error_sum = 0;
+    
+    for(size_t i = first_sample; i < last_sample; i++)
+    {
+        NNet.FeedForward(samples[i].input);
+        error_sum += NNet.ComputeGradients(samples[i].output, g);
+        
+        for(size_t j = 0; j < sums.size(); j++)
+            for(size_t k = 0; k < sums[j].size(); k++)
+                sums[j][k] += g[j][k];
+    }
+    
+    size_t offset = 0;
+    
+    for(size_t i = 0; i < sums.size(); i++)
+    {
+        for(size_t j = 0; j < sums[i].size(); j++)
+            add_atomic(atomic_sums[offset + j], sums[i][j]);
+        
+        offset += sums[i].size();
+    }
+    
+    add_atomic(atomic_error, error_sum);
+}
@@ -0,0 +1,89 @@
+#ifndef GRADIENT_REDUCER_H
+#define GRADIENT_REDUCER_H
+
+
+#include "cards.h"
+#include "thread_pool.h"
+
+#include <atomic>
+using std::atomic;
+
+
+#define GRADIENT_SUMMATION_PLAIN 0
+#define GRADIENT_SUMMATION_KAHAN 1
+
+// samples per leaf of the reduction tree
+#define GRADIENT_REDUCER_DEFAULT_BLOCK_SIZE 8
+
+
+// The gradient of a batch of samples for an FFBPNeuralNet, computed on
+// several threads and summed in an order that depends only on the batch.
+//
+// The batch is cut into blocks of block_size consecutive samples, and each
+// block is summed in sample order into its own buffer, a leaf of the tree, by
+// whichever thread takes it. Each thread feeds its samples through its own
+// copy of the network, since FeedForward keeps the neuron values. The leaves
+// are then added pairwise, leaf i taking leaf i + 1, then i + 2, i + 4 and so
+// on, each thread reducing its own slice of every layer. Every weight's sum
+// is made of the same additions in the same order for any number of threads,
+// so the result is bit-identical.
+//
+// With GRADIENT_SUMMATION_KAHAN each leaf also keeps the low bits lost from
+// its sum (Kahan summation), and they're carried up the tree.
+class gradient_reducer
+{
+public:
+    
+    // num_threads == 0 means one per hardware thread
+    gradient_reducer(const size_t src_num_threads = 0, const size_t src_block_size = GRADIENT_REDUCER_DEFAULT_BLOCK_SIZE, const size_t src_summation = GRADIENT_SUMMATION_PLAIN);
+    
+    // the sum of the samples' gradients at the network's current weights, in
+    // ComputeGradients' layout; returns the sum of their errors
+    double compute(const FFBPNeuralNet &NNet, const vector<input_output_pair> &samples, vector< vector<double> > &gradients);
+    
+    // compute, the naive way for comparison: each thread sums a share of the
+    // samples, then adds its sums into the result with atomic adds, in
+    // whatever order the threads get there
+    double compute_atomic(const FFBPNeuralNet &NNet, const vector<input_output_pair> &samples, vector< vector<double> > &gradients);
+    
+    // one optimiser step along the mean of the samples' gradients; returns their mean error
+    double train(FFBPNeuralNet &NNet, const vector<input_output_pair> &samples);
+    
+    size_t get_num_threads(void) const;
+    size_t get_block_size(void) const;
+    size_t get_summation(void) const;
+    
+protected:
+    
+    // checks the samples, copies the network to each thread, and sizes
+    // num_buffers leaves and the gradients to the network's layers
+    void prepare(const FFBPNeuralNet &NNet, const vector<input_output_pair> &samples, const size_t num_buffers, vector< vector<double> > &gradients);
+    
+    void sum_blocks(const size_t thread_index, const vector<input_output_pair> &samples);
+    void reduce_blocks(const size_t thread_index, const size_t num_blocks, vector< vector<double> > &gradients);
+    void sum_atomic(const size_t thread_index, const vector<input_output_pair> &samples);
+    
+    size_t block_size;
+    size_t summation;
+    
+    thread_pool pool;
+    
+    // one per thread
+    vector<FFBPNeuralNet> NNets;
+    vector< vector< vector<double> > > sample_gradients;
+    
+    // per block: the leaves, [block][layer], their compensations and error sums
+    vector< vector< vector<double> > > block_sums;
+    vector< vector< vector<double> > > block_compensations;
+    vector<double> block_errors;
+    
+    // train's
+    vector< vector<double> > mean_gradients;
+    
+    // compute_atomic's result, the layers back to back
+    vector< atomic<double> > atomic_sums;
+    atomic<double> atomic_error;
+};
+
+
+#endif
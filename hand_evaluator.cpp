@@ -0,0 +1,92 @@
+#include "hand_evaluator.h"
+#include "cards.h"
+
+
+// compare-exchange, larger value first
+#define HAND_EVALUATOR_SORT2(a, b) { const unsigned int lo = (a < b) ? a : b; const unsigned int hi = (a < b) ? b : a; a = hi; b = lo; }
+
+static inline unsigned int hand_strength_kernel(unsigned int f0, unsigned int f1, unsigned int f2, unsigned int f3, unsigned int f4,
+                                                const unsigned int s0, const unsigned int s1, const unsigned int s2, const unsigned int s3, const unsigned int s4)
+{
+    // multiplicity of each card's face within the hand (1 to 4)
+    const unsigned int c0 = 1 + (f0 == f1) + (f0 == f2) + (f0 == f3) + (f0 == f4);
+    const unsigned int c1 = 1 + (f1 == f0) + (f1 == f2) + (f1 == f3) + (f1 == f4);
+    const unsigned int c2 = 1 + (f2 == f0) + (f2 == f1) + (f2 == f3) + (f2 == f4);
+    const unsigned int c3 = 1 + (f3 == f0) + (f3 == f1) + (f3 == f2) + (f3 == f4);
+    const unsigned int c4 = 1 + (f4 == f0) + (f4 == f1) + (f4 == f2) + (f4 == f3);
+
+    // sort by (multiplicity, face), descending
+    unsigned int v0 = (c0 << 4) | f0;
+    unsigned int v1 = (c1 << 4) | f1;
+    unsigned int v2 = (c2 << 4) | f2;
+    unsigned int v3 = (c3 << 4) | f3;
+    unsigned int v4 = (c4 << 4) | f4;
+
+    HAND_EVALUATOR_SORT2(v0, v1);
+    HAND_EVALUATOR_SORT2(v3, v4);
+    HAND_EVALUATOR_SORT2(v2, v4);
+    HAND_EVALUATOR_SORT2(v2, v3);
+    HAND_EVALUATOR_SORT2(v0, v3);
+    HAND_EVALUATOR_SORT2(v0, v2);
+    HAND_EVALUATOR_SORT2(v1, v4);
+    HAND_EVALUATOR_SORT2(v1, v3);
+    HAND_EVALUATOR_SORT2(v1, v2);
+
+    f0 = v0 & 15;
+    f1 = v1 & 15;
+    f2 = v2 & 15;
+    f3 = v3 & 15;
+    f4 = v4 & 15;
+
+    const unsigned int top_count = v0 >> 4;
+    const unsigned int third_count = v2 >> 4;
+    const unsigned int fourth_count = v3 >> 4;
+
+    const unsigned int flush = (s0 == s1) & (s0 == s2) & (s0 == s3) & (s0 == s4);
+    const unsigned int wheel = (1 == top_count) & (FACE_A == f0) & (FACE_5 == f1) & (FACE_2 == f4);
+    const unsigned int straight = ((1 == top_count) & (f0 - f4 == 4)) | wheel;
+
+    // a 5-high straight plays the ace low
+    f0 = wheel ? FACE_5 : f0;
+    f1 = wheel ? FACE_4 : f1;
+    f2 = wheel ? FACE_3 : f2;
+    f3 = wheel ? FACE_2 : f3;
+    f4 = wheel ? FACE_A_LOW : f4;
+
+    unsigned int category = HIGH_CARD;
+    category = (2 == top_count) ? ONE_PAIR : category;
+    category = (2 == top_count && 2 == third_count) ? TWO_PAIR : category;
+    category = (3 == top_count) ? THREE_OF_A_KIND : category;
+    category = straight ? STRAIGHT : category;
+    category = flush ? FLUSH : category;
+    category = (3 == top_count && 2 == fourth_count) ? FULL_HOUSE : category;
+    category = (4 == top_count) ? FOUR_OF_A_KIND : category;
+    category = (straight & flush) ? STRAIGHT_FLUSH : category;
+    category = (straight & flush & (FACE_A == f0)) ? ROYAL_FLUSH : category;
+
+    return (category << HAND_STRENGTH_CATEGORY_SHIFT) | (f0 << 16) | (f1 << 12) | (f2 << 8) | (f3 << 4) | f4;
+}
+
+unsigned int get_hand_strength(const size_t *const faces, const size_t *const suits)
+{
+    return hand_strength_kernel(static_cast<unsigned int>(faces[0]), static_cast<unsigned int>(faces[1]), static_cast<unsigned int>(faces[2]), static_cast<unsigned int>(faces[3]), static_cast<unsigned int>(faces[4]),
+                                static_cast<unsigned int>(suits[0]), static_cast<unsigned int>(suits[1]), static_cast<unsigned int>(suits[2]), static_cast<unsigned int>(suits[3]), static_cast<unsigned int>(suits[4]));
+}
+
+void batch_get_hand_strength(const size_t num_hands, const unsigned char *const faces, const unsigned char *const suits, unsigned int *const keys)
+{
+    const unsigned char *const f0 = faces;
+    const unsigned char *const f1 = faces + num_hands;
+    const unsigned char *const f2 = faces + 2*num_hands;
+    const unsigned char *const f3 = faces + 3*num_hands;
+    const unsigned char *const f4 = faces + 4*num_hands;
+
+    const unsigned char *const s0 = suits;
+    const unsigned char *const s1 = suits + num_hands;
+    const unsigned char *const s2 = suits + 2*num_hands;
+    const unsigned char *const s3 = suits + 3*num_hands;
+    const unsigned char *const s4 = suits + 4*num_hands;
+
+    for(size_t i = 0; i < num_hands; i++)
+        keys[i] = hand_strength_kernel(f0[i], f1[i], f2[i], f3[i], f4[i], s0[i], s1[i], s2[i], s3[i], s4[i]);
+}
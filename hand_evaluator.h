@@ -0,0 +1,39 @@
+#ifndef HAND_EVALUATOR_H
+#define HAND_EVALUATOR_H
+
+
+#include <cstddef>
+using std::size_t;
+
+
+// A hand strength key is a total order over finished five card hands:
+//
+//   bits 20..23  hand category (HIGH_CARD .. ROYAL_FLUSH)
+//   bits 16..19  first tie-break face
+//   ...
+//   bits  0.. 3  fifth tie-break face
+//
+// Faces are ordered by (multiplicity, face), both descending, so comparing
+// two keys with < is the same as comparing the two hands at a showdown.
+// An ace in a 5-high straight is scored as FACE_A_LOW.
+
+#define HAND_STRENGTH_CATEGORY_SHIFT 20
+
+
+// one hand, cards given as face / suit arrays of NUM_CARDS_PER_HAND entries
+unsigned int get_hand_strength(const size_t *const faces, const size_t *const suits);
+
+// category part of a hand strength key
+inline size_t get_hand_strength_category(const unsigned int strength)
+{
+    return strength >> HAND_STRENGTH_CATEGORY_SHIFT;
+}
+
+// many hands at once, in structure-of-arrays layout:
+// faces[card*num_hands + hand], suits[card*num_hands + hand], keys[hand]
+//
+// the kernel is branch-free, so the compiler can run the hand loop in SIMD lanes
+void batch_get_hand_strength(const size_t num_hands, const unsigned char *const faces, const unsigned char *const suits, unsigned int *const keys);
+
+
+#endif
@@ -0,0 +1,420 @@
+#include "hand_outcome_table.h"
+
+#include <fstream>
+using std::ifstream;
+using std::ofstream;
+
+#include <ios>
+using std::ios;
+
+#include <stdexcept>
+using std::runtime_error;
+using std::out_of_range;
+
+#include <thread>
+using std::thread;
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+static const unsigned char hand_outcome_table_header[8] = { 'B', 'P', 'H', 'O', HAND_OUTCOME_TABLE_VERSION, NUM_CARDS_PER_HAND, NUM_HAND_CATEGORIES, 0 };
+
+
+// binomials[n][k] == n choose k, and set_offsets[k] is where the sets of k cards start in the index
+class hand_outcome_table_ranks
+{
+public:
+    
+    hand_outcome_table_ranks(void)
+    {
+        for(size_t i = 0; i <= NUM_CARDS_PER_DECK; i++)
+        {
+            binomials[i][0] = 1;
+            
+            for(size_t j = 1; j <= NUM_CARDS_PER_HAND; j++)
+                binomials[i][j] = (0 == i) ? 0 : binomials[i - 1][j - 1] + binomials[i - 1][j];
+        }
+        
+        set_offsets[0] = 0;
+        
+        for(size_t i = 1; i <= NUM_CARDS_PER_HAND + 1; i++)
+            set_offsets[i] = set_offsets[i - 1] + binomials[NUM_CARDS_PER_DECK][i - 1];
+    }
+    
+    size_t binomials[NUM_CARDS_PER_DECK + 1][NUM_CARDS_PER_HAND + 1];
+    size_t set_offsets[NUM_CARDS_PER_HAND + 2];
+};
+
+static const hand_outcome_table_ranks ranks;
+
+
+hand_outcome_table::hand_outcome_table(const char *const filename)
+{
+    mapped_data = 0;
+    mapped_size = 0;
+    
+    const unsigned char *data = 0;
+    size_t data_size = 0;
+    
+#ifndef _WIN32
+    
+    int fd = open(filename, O_RDONLY);
+    
+    if(-1 == fd)
+        throw runtime_error("Error opening file.");
+    
+    struct stat file_stat;
+    
+    if(0 == fstat(fd, &file_stat) && S_ISREG(file_stat.st_mode) && file_stat.st_size >= HAND_OUTCOME_TABLE_HEADER_SIZE)
+    {
+        void *temp_data = mmap(0, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        
+        if(MAP_FAILED != temp_data)
+        {
+            // lookups are scattered
+            madvise(temp_data, static_cast<size_t>(file_stat.st_size), MADV_RANDOM);
+            
+            mapped_data = static_cast<const unsigned char *>(temp_data);
+            mapped_size = static_cast<size_t>(file_stat.st_size);
+        }
+    }
+    
+    close(fd);
+    
+    data = mapped_data;
+    data_size = mapped_size;
+    
+#endif
+    
+    // fall back to reading the whole file
+    if(0 == data)
+    {
+        ifstream in(filename, ios::binary);
+        
+        if(in.fail())
+            throw runtime_error("Error opening file.");
+        
+        in.seekg(0, ios::end);
+        file_data.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0, ios::beg);
+        
+        if(file_data.size() < HAND_OUTCOME_TABLE_HEADER_SIZE)
+            throw runtime_error("Error reading from file.");
+        
+        in.read((char *)&file_data[0], file_data.size());
+        
+        if(in.fail())
+            throw runtime_error("Error reading from file.");
+        
+        data = &file_data[0];
+        data_size = file_data.size();
+    }
+    
+    try
+    {
+        check_header(data);
+        
+        unsigned int temp_num_sets = 0, temp_num_rows = 0;
+        memcpy(&temp_num_sets, data + 8, sizeof(unsigned int));
+        memcpy(&temp_num_rows, data + 12, sizeof(unsigned int));
+        
+        num_sets = temp_num_sets;
+        num_rows = temp_num_rows;
+        
+        if(num_sets != ranks.set_offsets[NUM_CARDS_PER_HAND + 1] ||
+           data_size != HAND_OUTCOME_TABLE_HEADER_SIZE + num_sets*sizeof(unsigned int) + num_rows*NUM_HAND_CATEGORIES*sizeof(float))
+            throw runtime_error("Error reading from file.");
+        
+        set_rows = reinterpret_cast<const unsigned int *>(data + HAND_OUTCOME_TABLE_HEADER_SIZE);
+        rows = reinterpret_cast<const float *>(data + HAND_OUTCOME_TABLE_HEADER_SIZE + num_sets*sizeof(unsigned int));
+        
+        for(size_t i = 0; i < num_sets; i++)
+            if(set_rows[i] >= num_rows)
+                throw runtime_error("Error reading from file.");
+    }
+    catch(...)
+    {
+#ifndef _WIN32
+        
+        if(0 != mapped_data)
+            munmap(const_cast<unsigned char *>(mapped_data), mapped_size);
+        
+#endif
+        
+        throw;
+    }
+}
+
+hand_outcome_table::~hand_outcome_table(void)
+{
+#ifndef _WIN32
+    
+    if(0 != mapped_data)
+        munmap(const_cast<unsigned char *>(mapped_data), mapped_size);
+    
+#endif
+}
+
+const float *hand_outcome_table::lookup(const unsigned char *const card_ids, const size_t num_cards) const
+{
+    unsigned char sorted_card_ids[NUM_CARDS_PER_HAND];
+    sort_card_ids(card_ids, num_cards, sorted_card_ids);
+    
+    return rows + set_rows[get_set_index(sorted_card_ids, num_cards)]*NUM_HAND_CATEGORIES;
+}
+
+const float *hand_outcome_table::lookup_player(const unsigned char *const positions, const size_t player_index) const
+{
+    if(player_index >= NUM_PLAYERS)
+        throw out_of_range("Invalid player index.");
+    
+    // in card id order, so already sorted
+    unsigned char card_ids[NUM_CARDS_PER_HAND];
+    size_t num_cards = 0;
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK && num_cards < NUM_CARDS_PER_HAND; i++)
+        if(POSITION_HAND0 + player_index == positions[i])
+            card_ids[num_cards++] = static_cast<unsigned char>(i);
+    
+    return rows + set_rows[get_set_index(card_ids, num_cards)]*NUM_HAND_CATEGORIES;
+}
+
+size_t hand_outcome_table::get_num_sets(void) const
+{
+    return num_sets;
+}
+
+size_t hand_outcome_table::get_num_rows(void) const
+{
+    return num_rows;
+}
+
+size_t hand_outcome_table::get_set_index(const unsigned char *const sorted_card_ids, const size_t num_cards)
+{
+    size_t index = ranks.set_offsets[num_cards];
+    
+    for(size_t i = 0; i < num_cards; i++)
+        index += ranks.binomials[sorted_card_ids[i]][i + 1];
+    
+    return index;
+}
+
+void hand_outcome_table::sort_card_ids(const unsigned char *const card_ids, const size_t num_cards, unsigned char *const sorted_card_ids)
+{
+    if(num_cards > NUM_CARDS_PER_HAND)
+        throw out_of_range("Invalid number of cards.");
+    
+    // insertion sort, at most five cards
+    for(size_t i = 0; i < num_cards; i++)
+    {
+        if(card_ids[i] >= NUM_CARDS_PER_DECK)
+            throw out_of_range("Invalid card id.");
+        
+        size_t j = i;
+        
+        for(; j > 0 && sorted_card_ids[j - 1] > card_ids[i]; j--)
+            sorted_card_ids[j] = sorted_card_ids[j - 1];
+        
+        if(j > 0 && sorted_card_ids[j - 1] == card_ids[i])
+            throw out_of_range("Repeated card id.");
+        
+        sorted_card_ids[j] = card_ids[i];
+    }
+}
+
+void hand_outcome_table::check_header(const unsigned char *const header)
+{
+    if(0 != memcmp(header, hand_outcome_table_header, 4))
+        throw runtime_error("Not a hand outcome table file.");
+    
+    if(0 != memcmp(header, hand_outcome_table_header, sizeof(hand_outcome_table_header)))
+        throw runtime_error("Hand outcome table file is for a different version or game size.");
+}
+
+// steps through the k-subsets of 0 .. n - 1 in ascending order, false after the last
+static bool next_combination(unsigned char *const indices, const size_t k, const size_t n)
+{
+    size_t i = k;
+    
+    while(i > 0 && indices[i - 1] == n - k + i - 1)
+        i--;
+    
+    if(0 == i)
+        return false;
+    
+    indices[i - 1]++;
+    
+    for(size_t j = i; j < k; j++)
+        indices[j] = static_cast<unsigned char>(indices[j - 1] + 1);
+    
+    return true;
+}
+
+// the finished categories over every completion of the shown cards
+static void count_hand_outcomes(const unsigned char *const card_ids, const size_t num_cards, float *const probabilities)
+{
+    unsigned char remaining[NUM_CARDS_PER_DECK];
+    size_t num_remaining = 0;
+    
+    for(size_t i = 0, j = 0; i < NUM_CARDS_PER_DECK; i++)
+    {
+        if(j < num_cards && card_ids[j] == i)
+            j++;
+        else
+            remaining[num_remaining++] = static_cast<unsigned char>(i);
+    }
+    
+    const size_t num_unshown = NUM_CARDS_PER_HAND - num_cards;
+    
+    size_t faces[NUM_CARDS_PER_HAND];
+    size_t suits[NUM_CARDS_PER_HAND];
+    
+    for(size_t i = 0; i < num_cards; i++)
+    {
+        faces[i] = card_ids[i]/4 + FACE_2;
+        suits[i] = card_ids[i]%4;
+    }
+    
+    unsigned char indices[NUM_CARDS_PER_HAND];
+    
+    for(size_t i = 0; i < num_unshown; i++)
+        indices[i] = static_cast<unsigned char>(i);
+    
+    size_t counts[NUM_HAND_CATEGORIES] = { 0 };
+    size_t num_completions = 0;
+    
+    do
+    {
+        for(size_t i = 0; i < num_unshown; i++)
+        {
+            faces[num_cards + i] = remaining[indices[i]]/4 + FACE_2;
+            suits[num_cards + i] = remaining[indices[i]]%4;
+        }
+        
+        counts[get_hand_strength_category(get_hand_strength(faces, suits))]++;
+        num_completions++;
+    }
+    while(next_combination(indices, num_unshown, num_remaining));
+    
+    for(size_t i = 0; i < NUM_HAND_CATEGORIES; i++)
+        probabilities[i] = static_cast<float>(static_cast<double>(counts[i]) / num_completions);
+}
+
+void hand_outcome_table::count_outcomes(const unsigned char *const card_ids, const size_t num_cards, float *const probabilities)
+{
+    unsigned char sorted_card_ids[NUM_CARDS_PER_HAND];
+    sort_card_ids(card_ids, num_cards, sorted_card_ids);
+    
+    count_hand_outcomes(sorted_card_ids, num_cards, probabilities);
+}
+
+void hand_outcome_table::generate(const char *const filename, const size_t num_threads)
+{
+    const size_t temp_num_sets = ranks.set_offsets[NUM_CARDS_PER_HAND + 1];
+    
+    // every set's row, a new row for each set that is its own canonical set
+    vector<unsigned int> temp_set_rows(temp_num_sets);
+    vector<unsigned int> canonical_sets(temp_num_sets);
+    vector<unsigned char> row_cards;
+    vector<unsigned char> row_num_cards;
+    
+    for(size_t i = 0; i <= NUM_CARDS_PER_HAND; i++)
+    {
+        // the cards past the set's own are padding in the rows, so zero
+        unsigned char card_ids[NUM_CARDS_PER_HAND];
+        memset(card_ids, 0, sizeof(card_ids));
+        
+        for(size_t j = 0; j < i; j++)
+            card_ids[j] = static_cast<unsigned char>(j);
+        
+        do
+        {
+            unsigned char positions[NUM_CARDS_PER_DECK];
+            memset(positions, POSITION_NOT_SHOWN, sizeof(positions));
+            
+            for(size_t j = 0; j < i; j++)
+                positions[card_ids[j]] = POSITION_HAND0;
+            
+            size_t suit_map[SUIT_CLUBS + 1];
+            get_canonical_suit_map(positions, suit_map);
+            
+            unsigned char canonical_card_ids[NUM_CARDS_PER_HAND];
+            
+            for(size_t j = 0; j < i; j++)
+            {
+                const unsigned char temp_card_id = static_cast<unsigned char>((card_ids[j]/4)*4 + suit_map[card_ids[j]%4]);
+                
+                size_t k = j;
+                
+                for(; k > 0 && canonical_card_ids[k - 1] > temp_card_id; k--)
+                    canonical_card_ids[k] = canonical_card_ids[k - 1];
+                
+                canonical_card_ids[k] = temp_card_id;
+            }
+            
+            const size_t index = get_set_index(card_ids, i);
+            const size_t canonical_index = get_set_index(canonical_card_ids, i);
+            
+            canonical_sets[index] = static_cast<unsigned int>(canonical_index);
+            
+            if(canonical_index == index)
+            {
+                temp_set_rows[index] = static_cast<unsigned int>(row_num_cards.size());
+                row_cards.insert(row_cards.end(), card_ids, card_ids + NUM_CARDS_PER_HAND);
+                row_num_cards.push_back(static_cast<unsigned char>(i));
+            }
+        }
+        while(next_combination(card_ids, i, NUM_CARDS_PER_DECK));
+    }
+    
+    for(size_t i = 0; i < temp_num_sets; i++)
+        temp_set_rows[i] = temp_set_rows[canonical_sets[i]];
+    
+    // the rows, interleaved over the threads
+    const size_t temp_num_rows = row_num_cards.size();
+    vector<float> temp_rows(temp_num_rows*NUM_HAND_CATEGORIES);
+    
+    size_t temp_num_threads = num_threads;
+    
+    if(0 == temp_num_threads)
+        temp_num_threads = thread::hardware_concurrency();
+    
+    if(0 == temp_num_threads)
+        temp_num_threads = 1;
+    
+    vector<thread> threads;
+    
+    for(size_t i = 0; i < temp_num_threads; i++)
+    {
+        threads.push_back(thread([i, temp_num_threads, temp_num_rows, &row_cards, &row_num_cards, &temp_rows]()
+        {
+            for(size_t j = i; j < temp_num_rows; j += temp_num_threads)
+                count_hand_outcomes(&row_cards[j*NUM_CARDS_PER_HAND], row_num_cards[j], &temp_rows[j*NUM_HAND_CATEGORIES]);
+        }));
+    }
+    
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    
+    ofstream out(filename, ios::binary);
+    
+    if(out.fail())
+        throw runtime_error("Error opening file.");
+    
+    const unsigned int counts[2] = { static_cast<unsigned int>(temp_num_sets), static_cast<unsigned int>(temp_num_rows) };
+    
+    out.write((const char *)hand_outcome_table_header, sizeof(hand_outcome_table_header));
+    out.write((const char *)counts, sizeof(counts));
+    out.write((const char *)&temp_set_rows[0], temp_set_rows.size()*sizeof(unsigned int));
+    out.write((const char *)&temp_rows[0], temp_rows.size()*sizeof(float));
+    
+    if(out.fail())
+        throw runtime_error("Error writing to file.");
+}
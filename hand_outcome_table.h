@@ -0,0 +1,77 @@
+#ifndef HAND_OUTCOME_TABLE_H
+#define HAND_OUTCOME_TABLE_H
+
+
+#include "cards.h"
+
+
+#define NUM_HAND_CATEGORIES (ROYAL_FLUSH + 1)
+
+#define HAND_OUTCOME_TABLE_HEADER_SIZE 16
+#define HAND_OUTCOME_TABLE_VERSION 1
+
+
+// For every set of 0 .. NUM_CARDS_PER_HAND cards shown in one hand, the
+// chance of the hand finishing as each of HIGH_CARD .. ROYAL_FLUSH, the
+// unshown cards being any of the cards not in the set, all equally likely.
+//
+// Sets that differ only by a relabelling of the suits have the same odds, so
+// only one row is kept per suit-canonical set (see suit_isomorphism.h). Every
+// set has a slot in a combinatorial number system index, which holds the
+// number of its row, so a lookup is a rank and two loads.
+//
+// File layout, all native endian and 4 byte aligned, made to be mapped:
+//
+//   header   'B' 'P' 'H' 'O', version, NUM_CARDS_PER_HAND, NUM_HAND_CATEGORIES, 0,
+//            number of sets, number of rows (unsigned int)
+//   index    one unsigned int row number per set
+//   rows     NUM_HAND_CATEGORIES floats per row
+class hand_outcome_table
+{
+public:
+    
+    hand_outcome_table(const char *const filename);
+    ~hand_outcome_table(void);
+    
+    // NUM_HAND_CATEGORIES probabilities for the shown cards, card ids in any
+    // order; out_of_range for an id past the deck or one given twice
+    const float *lookup(const unsigned char *const card_ids, const size_t num_cards) const;
+    
+    // the same, for a player's shown cards in a position array from get_card_positions
+    const float *lookup_player(const unsigned char *const positions, const size_t player_index) const;
+    
+    size_t get_num_sets(void) const;
+    size_t get_num_rows(void) const;
+    
+    // what lookup gives, counted over every completion of the shown cards
+    // instead, as generate does; slow with few cards shown
+    static void count_outcomes(const unsigned char *const card_ids, const size_t num_cards, float *const probabilities);
+    
+    // enumerates every canonical set's completions on num_threads threads
+    // (0 means one per hardware thread) and writes the table
+    static void generate(const char *const filename, const size_t num_threads = 0);
+    
+protected:
+    
+    static void check_header(const unsigned char *const header);
+    
+    // card ids ascending, checked
+    static void sort_card_ids(const unsigned char *const card_ids, const size_t num_cards, unsigned char *const sorted_card_ids);
+    
+    // the set's slot in the index, card ids ascending
+    static size_t get_set_index(const unsigned char *const sorted_card_ids, const size_t num_cards);
+    
+    // mapped file, or 0 when read into file_data
+    const unsigned char *mapped_data;
+    size_t mapped_size;
+    
+    vector<unsigned char> file_data;
+    
+    const unsigned int *set_rows;
+    const float *rows;
+    size_t num_sets;
+    size_t num_rows;
+};
+
+
+#endif
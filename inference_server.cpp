@@ -0,0 +1,443 @@
+#include "inference_server.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include <stdexcept>
+using std::runtime_error;
+using std::out_of_range;
+using std::exception;
+
+#include <algorithm>
+using std::sort;
+
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+inference_server_settings::inference_server_settings(void)
+{
+    socket_path = "/tmp/blind_poker_ai.sock";
+    max_batch_size = 64;
+    max_batch_delay_microseconds = 200;
+    latency_window = 100000;
+}
+
+// false if the peer closed the connection or the read failed
+static bool read_fully(const int fd, unsigned char *const buffer, const size_t size)
+{
+    size_t num_read = 0;
+    
+    while(num_read < size)
+    {
+        ssize_t n = read(fd, buffer + num_read, size - num_read);
+        
+        if(n > 0)
+            num_read += static_cast<size_t>(n);
+        else if(-1 == n && EINTR == errno)
+            continue;
+        else
+            return false;
+    }
+    
+    return true;
+}
+
+static bool write_fully(const int fd, const unsigned char *const buffer, const size_t size)
+{
+    size_t num_written = 0;
+    
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    
+    while(num_written < size)
+    {
+        ssize_t n = send(fd, buffer + num_written, size - num_written, flags);
+        
+        if(n > 0)
+            num_written += static_cast<size_t>(n);
+        else if(-1 == n && EINTR == errno)
+            continue;
+        else
+            return false;
+    }
+    
+    return true;
+}
+
+inference_server::inference_server(const vector<string> &src_model_filenames, const inference_server_settings &src_settings)
+{
+    if(src_model_filenames.size() != NUM_PLAYERS - 1)
+        throw out_of_range("Invalid number of models.");
+    
+    if(0 == src_settings.max_batch_size || 0 == src_settings.latency_window)
+        throw out_of_range("Invalid server settings.");
+    
+    model_filenames = src_model_filenames;
+    settings = src_settings;
+    
+    listen_fd = -1;
+    stopping = false;
+    num_connections = 0;
+    num_requests = 0;
+    num_batches = 0;
+    num_reloads = 0;
+    
+    load_models(NNets);
+}
+
+inference_server::~inference_server(void)
+{
+    stop();
+}
+
+void inference_server::start(void)
+{
+    if(-1 != listen_fd)
+        throw runtime_error("Server already started.");
+    
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    
+    if(settings.socket_path.size() >= sizeof(address.sun_path))
+        throw out_of_range("Socket path too long.");
+    
+    strcpy(address.sun_path, settings.socket_path.c_str());
+    
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    
+    if(-1 == listen_fd)
+        throw runtime_error("Error creating socket.");
+    
+    // a socket file left over from an earlier run
+    unlink(settings.socket_path.c_str());
+    
+    if(0 != bind(listen_fd, (const sockaddr *)&address, sizeof(address)) || 0 != listen(listen_fd, 64))
+    {
+        close(listen_fd);
+        listen_fd = -1;
+        throw runtime_error("Error binding socket.");
+    }
+    
+    stopping = false;
+    
+    batcher = thread(&inference_server::batch_thread, this);
+    accepter = thread(&inference_server::accept_thread, this);
+}
+
+void inference_server::stop(void)
+{
+    if(-1 == listen_fd)
+        return;
+    
+    {
+        std::lock_guard<mutex> lock(requests_mutex);
+        stopping = true;
+    }
+    
+    request_added.notify_all();
+    request_done.notify_all();
+    
+    // wakes the blocked accept
+    shutdown(listen_fd, SHUT_RDWR);
+    accepter.join();
+    
+    // wakes the blocked reads
+    {
+        std::unique_lock<mutex> lock(connections_mutex);
+        
+        for(size_t i = 0; i < connection_fds.size(); i++)
+            shutdown(connection_fds[i], SHUT_RDWR);
+        
+        while(0 != num_connections)
+            connection_closed.wait(lock);
+    }
+    
+    batcher.join();
+    
+    close(listen_fd);
+    unlink(settings.socket_path.c_str());
+    listen_fd = -1;
+}
+
+bool inference_server::reload_models(void)
+{
+    std::lock_guard<mutex> lock(reload_mutex);
+    
+    vector< shared_ptr<const FFBPNeuralNet> > temp_NNets;
+    
+    try
+    {
+        load_models(temp_NNets);
+    }
+    catch(const exception &e)
+    {
+        cout << "Model reload failed, keeping the old models: " << e.what() << endl;
+        return false;
+    }
+    
+    for(size_t i = 0; i < NNets.size(); i++)
+        std::atomic_store(&NNets[i], temp_NNets[i]);
+    
+    std::lock_guard<mutex> metrics_lock(metrics_mutex);
+    num_reloads++;
+    
+    return true;
+}
+
+void inference_server::get_metrics(inference_server_metrics &metrics) const
+{
+    std::lock_guard<mutex> lock(metrics_mutex);
+    
+    metrics.num_requests = num_requests;
+    metrics.num_batches = num_batches;
+    metrics.num_reloads = num_reloads;
+    metrics.mean_batch_size = (0 == num_batches) ? 0 : static_cast<double>(num_requests) / static_cast<double>(num_batches);
+    metrics.p50_latency_microseconds = 0;
+    metrics.p99_latency_microseconds = 0;
+    
+    if(0 == latencies.size())
+        return;
+    
+    vector<double> sorted_latencies(latencies);
+    sort(sorted_latencies.begin(), sorted_latencies.end());
+    
+    metrics.p50_latency_microseconds = sorted_latencies[static_cast<size_t>(0.50 * (sorted_latencies.size() - 1))];
+    metrics.p99_latency_microseconds = sorted_latencies[static_cast<size_t>(0.99 * (sorted_latencies.size() - 1))];
+}
+
+void inference_server::print_metrics(void) const
+{
+    inference_server_metrics metrics;
+    get_metrics(metrics);
+    
+    cout << "requests: " << metrics.num_requests << endl;
+    cout << "batches: " << metrics.num_batches << " (mean size " << metrics.mean_batch_size << ")" << endl;
+    cout << "reloads: " << metrics.num_reloads << endl;
+    cout << "latency p50: " << metrics.p50_latency_microseconds << " us" << endl;
+    cout << "latency p99: " << metrics.p99_latency_microseconds << " us" << endl;
+}
+
+void inference_server::accept_thread(void)
+{
+    while(true)
+    {
+        int fd = accept(listen_fd, 0, 0);
+        
+        if(-1 == fd)
+        {
+            if(EINTR == errno || ECONNABORTED == errno)
+                continue;
+            
+            // shut down by stop()
+            return;
+        }
+        
+        std::lock_guard<mutex> lock(connections_mutex);
+        
+        if(true == stopping)
+        {
+            close(fd);
+            return;
+        }
+        
+        connection_fds.push_back(fd);
+        num_connections++;
+        
+        thread(&inference_server::connection_thread, this, fd).detach();
+    }
+}
+
+void inference_server::connection_thread(const int fd)
+{
+    unsigned char request_data[INFERENCE_REQUEST_SIZE];
+    unsigned char response_data[INFERENCE_RESPONSE_SIZE];
+    
+    pending_request request;
+    
+    while(true == read_fully(fd, request_data, INFERENCE_REQUEST_SIZE))
+    {
+        request.start_time = std::chrono::steady_clock::now();
+        request.done = false;
+        request.seat = request_data[0];
+        
+        if(0 == request.seat || request.seat >= NUM_PLAYERS)
+            break;
+        
+        bool valid_positions = true;
+        
+        for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+            if(request_data[1 + i] > POSITION_NOT_SHOWN)
+                valid_positions = false;
+        
+        if(false == valid_positions)
+            break;
+        
+        memcpy(request.positions, request_data + 1, NUM_CARDS_PER_DECK);
+        
+        {
+            std::unique_lock<mutex> lock(requests_mutex);
+            
+            if(true == stopping)
+                break;
+            
+            requests.push_back(&request);
+            request_added.notify_one();
+            
+            while(false == request.done)
+                request_done.wait(lock);
+        }
+        
+        float output = static_cast<float>(request.output);
+        
+        response_data[0] = (0 == floor(request.output + 0.5)) ? 0 : 1;
+        memcpy(response_data + 1, &output, sizeof(float));
+        
+        if(false == write_fully(fd, response_data, INFERENCE_RESPONSE_SIZE))
+            break;
+    }
+    
+    std::lock_guard<mutex> lock(connections_mutex);
+    
+    for(size_t i = 0; i < connection_fds.size(); i++)
+    {
+        if(fd == connection_fds[i])
+        {
+            connection_fds.erase(connection_fds.begin() + i);
+            break;
+        }
+    }
+    
+    close(fd);
+    
+    num_connections--;
+    connection_closed.notify_all();
+}
+
+void inference_server::batch_thread(void)
+{
+    vector<pending_request *> batch;
+    vector<double> input, inputs, outputs;
+    
+    std::unique_lock<mutex> lock(requests_mutex);
+    
+    while(true)
+    {
+        while(false == stopping && 0 == requests.size())
+            request_added.wait(lock);
+        
+        // answer everything queued before stopping
+        if(0 == requests.size())
+            return;
+        
+        // wait for the other connections' requests to join the batch,
+        // a lone client never waits
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(settings.max_batch_delay_microseconds);
+        
+        while(false == stopping && requests.size() < settings.max_batch_size && requests.size() < num_connections)
+            if(std::cv_status::timeout == request_added.wait_until(lock, deadline))
+                break;
+        
+        batch.clear();
+        
+        while(0 != requests.size() && batch.size() < settings.max_batch_size)
+        {
+            batch.push_back(requests.front());
+            requests.pop_front();
+        }
+        
+        lock.unlock();
+        
+        // one batched pass per seat
+        for(size_t seat = 1; seat < NUM_PLAYERS; seat++)
+        {
+            shared_ptr<const FFBPNeuralNet> NNet = std::atomic_load(&NNets[seat - 1]);
+            
+            inputs.clear();
+            
+            for(size_t i = 0; i < batch.size(); i++)
+            {
+                if(seat == batch[i]->seat)
+                {
+                    blind_poker_table::encode_ANN_input(batch[i]->positions, input, *NNet);
+                    inputs.insert(inputs.end(), input.begin(), input.end());
+                }
+            }
+            
+            if(0 == inputs.size())
+                continue;
+            
+            const size_t num_rows = inputs.size() / NNet->GetNumInputLayerNeurons();
+            const size_t num_outputs = NNet->GetNumOutputLayerNeurons();
+            
+            NNet->FeedForwardBatch(inputs, num_rows, outputs);
+            
+            for(size_t i = 0, row = 0; i < batch.size(); i++)
+                if(seat == batch[i]->seat)
+                    batch[i]->output = outputs[num_outputs*row++];
+        }
+        
+        std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+        
+        {
+            std::lock_guard<mutex> metrics_lock(metrics_mutex);
+            
+            for(size_t i = 0; i < batch.size(); i++)
+                record_latency(std::chrono::duration<double, std::micro>(end_time - batch[i]->start_time).count());
+            
+            num_batches++;
+        }
+        
+        lock.lock();
+        
+        for(size_t i = 0; i < batch.size(); i++)
+            batch[i]->done = true;
+        
+        request_done.notify_all();
+    }
+}
+
+void inference_server::load_models(vector< shared_ptr<const FFBPNeuralNet> > &temp_NNets) const
+{
+    temp_NNets.clear();
+    
+    for(size_t i = 0; i < model_filenames.size(); i++)
+    {
+        shared_ptr<const FFBPNeuralNet> NNet(new FFBPNeuralNet(model_filenames[i].c_str()));
+        
+        // any input encoding, with or without the engineered features, but one of them
+        bool engineered_features = false;
+        
+        try
+        {
+            blind_poker_table::get_input_encoding_for_size(NNet->GetNumInputLayerNeurons(), engineered_features);
+        }
+        catch(const out_of_range &)
+        {
+            throw runtime_error("Model input size doesn't match any input encoding.");
+        }
+        
+        temp_NNets.push_back(NNet);
+    }
+}
+
+void inference_server::record_latency(const double microseconds)
+{
+    // a ring over the last latency_window requests
+    if(latencies.size() < settings.latency_window)
+        latencies.push_back(microseconds);
+    else
+        latencies[num_requests % settings.latency_window] = microseconds;
+    
+    num_requests++;
+}
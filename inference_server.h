@@ -0,0 +1,158 @@
+#ifndef INFERENCE_SERVER_H
+#define INFERENCE_SERVER_H
+
+
+#include "cards.h"
+
+#include <string>
+using std::string;
+
+#include <memory>
+using std::shared_ptr;
+
+#include <thread>
+using std::thread;
+
+#include <mutex>
+using std::mutex;
+
+#include <condition_variable>
+using std::condition_variable;
+
+#include <chrono>
+
+#include <deque>
+using std::deque;
+
+
+// Seat network decisions over a Unix domain socket (POSIX only).
+//
+// request, INFERENCE_REQUEST_SIZE bytes:
+//   seat (1 .. NUM_PLAYERS - 1), then NUM_CARDS_PER_DECK positions as from
+//   blind_poker_table::get_card_positions, seen from any seat's point of view
+// response, INFERENCE_RESPONSE_SIZE bytes:
+//   decision (0 or 1), then the network's output as a native float
+//
+// The decision means what it does in play_ANN: before the top of the pickup
+// pile is flipped, 0 takes the top of the discard pile and 1 flips; after, 0
+// discards the flipped card and 1 keeps it. A malformed request closes the
+// connection.
+
+#define INFERENCE_REQUEST_SIZE (1 + NUM_CARDS_PER_DECK)
+#define INFERENCE_RESPONSE_SIZE (1 + 4)
+
+
+class inference_server_settings
+{
+public:
+    
+    inference_server_settings(void);
+    
+    string socket_path;
+    
+    // requests per batched FeedForward
+    size_t max_batch_size;
+    
+    // how long the first request of a batch waits for others to join it
+    size_t max_batch_delay_microseconds;
+    
+    // latencies kept for the percentiles
+    size_t latency_window;
+};
+
+class inference_server_metrics
+{
+public:
+    
+    size_t num_requests;
+    size_t num_batches;
+    size_t num_reloads;
+    double mean_batch_size;
+    
+    // from a request being read to its answer being ready, over the latency window
+    double p50_latency_microseconds;
+    double p99_latency_microseconds;
+};
+
+// Each connection has a thread that reads requests and queues them; one
+// batching thread gathers queued requests, encodes them as each seat network
+// was built (see blind_poker_table::encode_ANN_input), runs them through the
+// networks with FeedForwardBatch and hands back the answers. The networks
+// are read-only snapshots, so reload_models swaps in new ones between
+// batches and requests already queued are answered by whichever snapshot
+// their batch picked up.
+class inference_server
+{
+public:
+    
+    // model_filenames[i] is the SaveToFile output for seat i + 1
+    inference_server(const vector<string> &src_model_filenames, const inference_server_settings &src_settings);
+    ~inference_server(void);
+    
+    void start(void);
+    void stop(void);
+    
+    // loads every model again, keeping the old ones if any file fails to load
+    bool reload_models(void);
+    
+    void get_metrics(inference_server_metrics &metrics) const;
+    void print_metrics(void) const;
+    
+protected:
+    
+    class pending_request
+    {
+    public:
+        
+        pending_request(void) : seat(0), output(0), done(false) {}
+        
+        // encoded by the batching thread, for whichever network answers
+        size_t seat;
+        unsigned char positions[NUM_CARDS_PER_DECK];
+        double output;
+        bool done;
+        std::chrono::steady_clock::time_point start_time;
+    };
+    
+    // not copyable
+    inference_server(const inference_server &);
+    inference_server &operator=(const inference_server &);
+    
+    void accept_thread(void);
+    void connection_thread(const int fd);
+    void batch_thread(void);
+    
+    void load_models(vector< shared_ptr<const FFBPNeuralNet> > &NNets) const;
+    void record_latency(const double microseconds);
+    
+    inference_server_settings settings;
+    vector<string> model_filenames;
+    
+    vector< shared_ptr<const FFBPNeuralNet> > NNets;
+    mutex reload_mutex;
+    
+    int listen_fd;
+    thread accepter;
+    thread batcher;
+    
+    // connection threads are detached, stop() waits for the count to reach 0
+    mutex connections_mutex;
+    condition_variable connection_closed;
+    vector<int> connection_fds;
+    atomic<size_t> num_connections;
+    
+    mutex requests_mutex;
+    condition_variable request_added;
+    condition_variable request_done;
+    deque<pending_request *> requests;
+    bool stopping;
+    
+    mutable mutex metrics_mutex;
+    vector<double> latencies;
+    size_t num_requests;
+    size_t num_batches;
+    size_t num_reloads;
+};
+
+
+#endif
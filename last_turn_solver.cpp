@@ -0,0 +1,264 @@
+#include "last_turn_solver.h"
+
+#include <thread>
+using std::thread;
+
+#include <mutex>
+using std::lock_guard;
+
+
+last_turn_solver::last_turn_solver(const size_t src_num_threads)
+{
+    num_threads = src_num_threads;
+    
+    if(0 == num_threads)
+        num_threads = thread::hardware_concurrency();
+    
+    if(0 == num_threads)
+        num_threads = 1;
+    
+    num_cache_hits = 0;
+}
+
+bool last_turn_solver::is_last_turn(const blind_poker_table &table)
+{
+    unsigned char positions[NUM_CARDS_PER_DECK];
+    table.get_card_positions(positions);
+    
+    size_t num_shown[NUM_PLAYERS] = { 0 };
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        if(positions[i] < POSITION_HAND0 + NUM_PLAYERS)
+            num_shown[positions[i] - POSITION_HAND0]++;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        if(table.get_current_player() == i)
+        {
+            if(NUM_CARDS_PER_HAND - 1 != num_shown[i])
+                return false;
+        }
+        else if(NUM_CARDS_PER_HAND != num_shown[i])
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool last_turn_solver::solve(const blind_poker_table &table, last_turn_result &result)
+{
+    if(false == is_last_turn(table))
+        return false;
+    
+    unsigned long long hash = table.get_canonical_state_hash();
+    
+    {
+        lock_guard<mutex> lock(cache_mutex);
+        
+        map<unsigned long long, last_turn_result>::const_iterator ci = cache.find(hash);
+        
+        if(ci != cache.end())
+        {
+            num_cache_hits++;
+            result = ci->second;
+            return true;
+        }
+    }
+    
+    unsigned char positions[NUM_CARDS_PER_DECK];
+    table.get_card_positions(positions);
+    
+    solve_positions(positions, table.get_current_player(), result);
+    
+    lock_guard<mutex> lock(cache_mutex);
+    cache[hash] = result;
+    
+    return true;
+}
+
+void last_turn_solver::solve_batch(const vector<blind_poker_table> &tables, vector<last_turn_result> &results, vector<bool> &solved)
+{
+    results.resize(tables.size());
+    
+    // vector<bool> packs bits, so threads write to a vector<char> instead
+    vector<char> temp_solved(tables.size(), 0);
+    
+    size_t temp_num_threads = num_threads < tables.size() ? num_threads : tables.size();
+    
+    vector<thread> threads;
+    
+    for(size_t i = 1; i < temp_num_threads; i++)
+        threads.push_back(thread(&last_turn_solver::solve_batch_thread, this, std::cref(tables), std::ref(results), std::ref(temp_solved), i, temp_num_threads));
+    
+    if(0 != temp_num_threads)
+        solve_batch_thread(tables, results, temp_solved, 0, temp_num_threads);
+    
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    
+    solved.assign(temp_solved.begin(), temp_solved.end());
+}
+
+size_t last_turn_solver::get_cache_size(void)
+{
+    lock_guard<mutex> lock(cache_mutex);
+    return cache.size();
+}
+
+size_t last_turn_solver::get_num_cache_hits(void)
+{
+    lock_guard<mutex> lock(cache_mutex);
+    return num_cache_hits;
+}
+
+void last_turn_solver::clear_cache(void)
+{
+    lock_guard<mutex> lock(cache_mutex);
+    cache.clear();
+    num_cache_hits = 0;
+}
+
+void last_turn_solver::solve_positions(const unsigned char *const positions, const size_t player_index, last_turn_result &result)
+{
+    // card_id == (face - FACE_2)*4 + suit
+    size_t hand_faces[NUM_PLAYERS][NUM_CARDS_PER_HAND];
+    size_t hand_suits[NUM_PLAYERS][NUM_CARDS_PER_HAND];
+    size_t hand_size[NUM_PLAYERS] = { 0 };
+    
+    size_t discard_card_id = 0;
+    vector<size_t> unseen_card_ids;
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+    {
+        if(positions[i] < POSITION_HAND0 + NUM_PLAYERS)
+        {
+            size_t owner = positions[i] - POSITION_HAND0;
+            
+            hand_faces[owner][hand_size[owner]] = i/4 + FACE_2;
+            hand_suits[owner][hand_size[owner]] = i%4;
+            hand_size[owner]++;
+        }
+        else if(POSITION_TOP_OF_DISCARD_PILE == positions[i])
+        {
+            discard_card_id = i;
+        }
+        else if(POSITION_NOT_SHOWN == positions[i])
+        {
+            unseen_card_ids.push_back(i);
+        }
+    }
+    
+    // the other hands are finished
+    unsigned int best_other_strength = 0;
+    size_t num_best_others = 0;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        if(player_index == i)
+            continue;
+        
+        unsigned int strength = get_hand_strength(hand_faces[i], hand_suits[i]);
+        
+        if(0 == num_best_others || strength > best_other_strength)
+        {
+            best_other_strength = strength;
+            num_best_others = 1;
+        }
+        else if(strength == best_other_strength)
+        {
+            num_best_others++;
+        }
+    }
+    
+    size_t *const faces = hand_faces[player_index];
+    size_t *const suits = hand_suits[player_index];
+    
+    // take discard: the unshown card goes to the discard pile, whatever it is
+    faces[NUM_CARDS_PER_HAND - 1] = discard_card_id/4 + FACE_2;
+    suits[NUM_CARDS_PER_HAND - 1] = discard_card_id%4;
+    
+    result.action_win_probabilities[ACTION_TAKE_DISCARD] = get_pot_share(get_hand_strength(faces, suits), best_other_strength, num_best_others);
+    
+    // pot share with each unseen card in the open slot, each scored once
+    vector<double> shares(unseen_card_ids.size());
+    double sum_of_shares = 0;
+    
+    for(size_t i = 0; i < unseen_card_ids.size(); i++)
+    {
+        faces[NUM_CARDS_PER_HAND - 1] = unseen_card_ids[i]/4 + FACE_2;
+        suits[NUM_CARDS_PER_HAND - 1] = unseen_card_ids[i]%4;
+        
+        shares[i] = get_pot_share(get_hand_strength(faces, suits), best_other_strength, num_best_others);
+        sum_of_shares += shares[i];
+    }
+    
+    // every ordered pair (x = unshown hand card, y = top of pickup pile), x != y, is equally likely
+    double flip_and_discard = 0;
+    double flip_and_keep = 0;
+    double flip_then_choose = 0;
+    
+    size_t n = unseen_card_ids.size();
+    
+    for(size_t y = 0; y < n; y++)
+    {
+        double discard_given_y = 0;
+        
+        for(size_t x = 0; x < n; x++)
+        {
+            if(x == y)
+                continue;
+            
+            // discarding the flipped card leaves x, keeping it gives y
+            discard_given_y += shares[x];
+            flip_and_keep += shares[y];
+        }
+        
+        flip_and_discard += discard_given_y;
+        
+        // once y shows, the player keeps or discards it, whichever wins more often
+        double keep_given_y = shares[y]*(n - 1);
+        flip_then_choose += keep_given_y > discard_given_y ? keep_given_y : discard_given_y;
+    }
+    
+    size_t num_pairs = n*(n - 1);
+    
+    result.num_assignments = num_pairs;
+    
+    if(0 != num_pairs)
+    {
+        result.action_win_probabilities[ACTION_FLIP_AND_DISCARD] = flip_and_discard / num_pairs;
+        result.action_win_probabilities[ACTION_FLIP_AND_KEEP] = flip_and_keep / num_pairs;
+        result.flip_then_choose_win_probability = flip_then_choose / num_pairs;
+    }
+    else
+    {
+        result.action_win_probabilities[ACTION_FLIP_AND_DISCARD] = 0;
+        result.action_win_probabilities[ACTION_FLIP_AND_KEEP] = 0;
+        result.flip_then_choose_win_probability = 0;
+    }
+    
+    result.best_action = ACTION_TAKE_DISCARD;
+    
+    for(size_t i = 1; i < NUM_ACTIONS; i++)
+        if(result.action_win_probabilities[i] > result.action_win_probabilities[result.best_action])
+            result.best_action = i;
+}
+
+double last_turn_solver::get_pot_share(const unsigned int strength, const unsigned int best_other_strength, const size_t num_best_others)
+{
+    if(strength > best_other_strength)
+        return 1.0;
+    
+    if(strength == best_other_strength)
+        return 1.0 / (num_best_others + 1);
+    
+    return 0.0;
+}
+
+void last_turn_solver::solve_batch_thread(const vector<blind_poker_table> &tables, vector<last_turn_result> &results, vector<char> &solved, const size_t first_index, const size_t index_step)
+{
+    for(size_t i = first_index; i < tables.size(); i += index_step)
+        solved[i] = solve(tables[i], results[i]) ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+#ifndef LAST_TURN_SOLVER_H
+#define LAST_TURN_SOLVER_H
+
+
+#include "cards.h"
+
+#include <mutex>
+using std::mutex;
+
+
+class last_turn_result
+{
+public:
+    
+    // exact probability of winning (a tie counts as the player's share of the pot), per ACTION_*
+    double action_win_probabilities[NUM_ACTIONS];
+    
+    // flip first, then keep or discard, whichever is better for the card that shows
+    double flip_then_choose_win_probability;
+    
+    size_t best_action;
+    size_t num_assignments;
+};
+
+// Exact solver for the last turn of the game: every other hand is fully shown
+// and the player to move has a single unshown card. The only unknowns are that
+// card and the top of the pickup pile, so the solver enumerates every ordered
+// pair of unseen cards and scores each finished hand with get_hand_strength.
+//
+// Results are suit invariant, so they are cached under the canonical state hash.
+class last_turn_solver
+{
+public:
+    
+    // num_threads == 0 means one per hardware thread
+    last_turn_solver(const size_t src_num_threads = 0);
+    
+    static bool is_last_turn(const blind_poker_table &table);
+    
+    // returns false if the table isn't on the last turn
+    bool solve(const blind_poker_table &table, last_turn_result &result);
+    
+    // many states at once, e.g. to label a batch of endgame samples;
+    // solved[i] is false where tables[i] isn't on the last turn
+    void solve_batch(const vector<blind_poker_table> &tables, vector<last_turn_result> &results, vector<bool> &solved);
+    
+    size_t get_cache_size(void);
+    size_t get_num_cache_hits(void);
+    void clear_cache(void);
+    
+protected:
+    
+    static void solve_positions(const unsigned char *const positions, const size_t player_index, last_turn_result &result);
+    static double get_pot_share(const unsigned int strength, const unsigned int best_other_strength, const size_t num_best_others);
+    
+    void solve_batch_thread(const vector<blind_poker_table> &tables, vector<last_turn_result> &results, vector<char> &solved, const size_t first_index, const size_t index_step);
+    
+    size_t num_threads;
+    
+    mutex cache_mutex;
+    map<unsigned long long, last_turn_result> cache;
+    size_t num_cache_hits;
+};
+
+
+#endif
@@ -1,5 +1,19 @@
 #include "ffbpneuralnet.h"
 #include "cards.h"
+#include "training_pipeline.h"
+#include "thread_pool.h"
+#include "replay_buffer.h"
+#include "game_record.h"
+#include "inference_server.h"
+#include "shared_trunk_neuralnet.h"
+#include "evaluation.h"
+#include "td_lambda.h"
+#include "random_play_simulator.h"
+#include "hand_outcome_table.h"
+#include "feature_encoder.h"
+#include "cfr_solver.h"
+#include "convergence_monitor.h"
+#include "gradient_reducer.h"
 
 #include <iostream>
 using std::cout;
@@ -8,137 +22,1172 @@ using std::endl;
 #include <sstream>
 using std::ostringstream;
 
+#include <fstream>
+using std::ifstream;
+
 #include <ctime>
 
+#include <cstring>
 
+#include <cmath>
 
+#include <memory>
+using std::unique_ptr;
 
-int main(void)
-{
-	srand(static_cast<unsigned int>(time(0)));
-	//srand(123);
+#include <csignal>
 
+#include <thread>
+#include <chrono>
 
-    double max_error_rate = 0.00001;
-    double error_rate = 0;
-    
-    size_t max_training_sessions = 100000;
-	size_t num_training_sessions = 0;
+
+
+
+// experience replay, used with the "replay" argument
+const size_t replay_capacity = 100000;
+const size_t replay_batch_size = 32;
+
+// games played side by side, used with the "shared" argument
+const size_t shared_trunk_num_tables = 16;
+
+// the fixed evaluation set, used with the "prune" argument
+const size_t evaluation_num_games = 10000;
+const unsigned long long evaluation_seed = 12345;
+
+// used with the "optimisers" argument
+const double optimiser_benchmark_target_win_rate = 0.21;
+const size_t optimiser_benchmark_interval = 1000;
+const size_t optimiser_benchmark_max_games = 100000;
+const size_t optimiser_benchmark_num_evaluation_games = 2000;
+const unsigned int optimiser_benchmark_seed = 123;
+
+// used with the "td" argument
+const double td_lambda = 0.7;
+const double td_learning_rate = 0.1;
+const size_t td_evaluation_interval = 10000;
+
+// used with the "random" argument
+const size_t random_play_num_games = 100000000;
+const size_t random_play_num_table_games = 20000;
+const unsigned long long random_play_seed = 12345;
+
+// used with the "outcomes" argument
+const char *const hand_outcome_table_filename = "hand_outcomes.bin";
+const size_t hand_outcome_table_check_interval = 20; // every 20th state's lookups are counted out
+
+// used with the "cfr" argument
+const size_t cfr_num_iterations = 1000000;
+const size_t cfr_report_interval = 100000;
+const size_t cfr_exploitability_num_games = 20000;
+const unsigned long long cfr_seed = 12345;
+const char *const cfr_checkpoint_filename = "cfr_checkpoint.bin";
+
+// used with the "reduction" argument
+const size_t gradient_reduction_num_samples = 4096;
+const size_t gradient_reduction_num_repeats = 10;
+const size_t gradient_reduction_max_num_threads = 8;
+const unsigned int gradient_reduction_seed = 123;
+
+// trains one seat's network on its game, the seats are independent of each other
+static void train_seat(FFBPNeuralNet &NNet, vector<input_output_pair> &io, double &error_sum, replay_buffer *const replay)
+{
+    error_sum = 0;
     
-    vector<FFBPNeuralNet> NNets;
+    // if loser, switch ~0 for 1 and ~1 for 0
+    for(size_t j = 0; j < io.size(); j++)
+    {
+        if(0 == floor(io[j].output[0] + 0.5))
+            io[j].output[0] = 1;
+        else
+            io[j].output[0] = 0;
+    }
     
-#ifdef USE_ONE_HOT_INPUT_ENCODING
+    if(0 != replay)
+    {
+        // keep the game, then train on a prioritised batch of everything kept so far
+        replay->add(io);
+        
+        vector<size_t> indices;
+        replay->sample_prioritised(replay_batch_size, io, indices);
+        
+        for(size_t j = 0; j < io.size(); j++)
+        {
+            NNet.FeedForward(io[j].input);
+            double error = NNet.BackPropagate(io[j].output);
+            
+            replay->update_priority(indices[j], error);
+            error_sum += error;
+        }
+        
+        return;
+    }
     
-    cout << "Using one hot input encoding" << endl;
+    // train network using io
+    for(size_t j = 0; j < io.size(); j++)
+    {
+        NNet.FeedForward(io[j].input);
+        error_sum += NNet.BackPropagate(io[j].output);
+    }
+}
+
+// the hidden layer size for an input encoding, about the square root of the number of inputs
+static size_t get_num_hidden_neurons(const size_t encoding)
+{
+    if(INPUT_ENCODING_ONE_HOT == encoding)
+        return 22; // sqrt(468) == 22
     
-#endif
+    return 14; // sqrt(208) == 14
+}
+
+// one untrained network per ANN seat, optionally with inputs for the engineered features
+static void create_seat_networks(vector<FFBPNeuralNet> &NNets, const bool engineered_features = false, const size_t encoding = DEFAULT_INPUT_ENCODING)
+{
+    const size_t num_extra_inputs = engineered_features ? NUM_ENGINEERED_FEATURES : 0;
     
+    NNets.clear();
     
     for(size_t i = 0; i < NUM_PLAYERS - 1; i++)
     {
-        // create a network of 208 input neurons, one hidden layer of 14 neurons, and 1 output neuron
+        // create a network of 468 (or 208) input neurons, one hidden layer of 22 (or 14) neurons, and 1 output neuron
         vector<size_t> HiddenLayers;
         
-#ifdef USE_ONE_HOT_INPUT_ENCODING
-        
-        HiddenLayers.push_back(22); // sqrt(468) == 22
-        FFBPNeuralNet NNet(468, HiddenLayers, 1); // 52*9 == 468
-       
-#else
-
-        HiddenLayers.push_back(14); // sqrt(208) == 14
-        FFBPNeuralNet NNet(208, HiddenLayers, 1); // 52*4 = 208
-        
-#endif
+        HiddenLayers.push_back(get_num_hidden_neurons(encoding));
+        FFBPNeuralNet NNet(blind_poker_table::get_input_encoding_size(encoding) + num_extra_inputs, HiddenLayers, 1);
         
         NNet.SetLearningRate(1.0);
         NNet.SetMomentum(1.0);
         
         NNets.push_back(NNet);
     }
+}
+
+// plays and trains num_games as the serial loop does, without the printing
+static void train_serial_games(vector<FFBPNeuralNet> &NNets, const size_t num_games)
+{
+    for(size_t i = 0; i < num_games; i++)
+    {
+        blind_poker_table bpt;
+        
+        vector< vector<input_output_pair> > nnet_io(NUM_PLAYERS - 1);
+        
+        for(size_t j = 0; j < NUM_CARDS_PER_HAND; j++)
+        {
+            bpt.play_rand();
+            
+            for(size_t k = 1; k < NUM_PLAYERS; k++)
+                bpt.play_ANN(nnet_io[k - 1], NNets[k - 1]);
+        }
+        
+        vector< vector<size_t> > ranking;
+        bpt.get_showdown_ranking(ranking);
+        
+        vector<bool> is_winner(NUM_PLAYERS, false);
+        
+        for(size_t j = 0; j < ranking[0].size(); j++)
+            is_winner[ranking[0][j]] = true;
+        
+        for(size_t j = 1; j < NUM_PLAYERS; j++)
+        {
+            if(true == is_winner[j])
+                continue;
+            
+            double error_sum = 0;
+            train_seat(NNets[j - 1], nnet_io[j - 1], error_sum, 0);
+        }
+    }
+}
+
+static volatile sig_atomic_t server_reload_requested = 0;
+static volatile sig_atomic_t server_stop_requested = 0;
+
+static void handle_server_signal(int signal_number)
+{
+    if(SIGHUP == signal_number)
+        server_reload_requested = 1;
+    else
+        server_stop_requested = 1;
+}
+
+// answers decisions from the saved seat networks until SIGINT / SIGTERM, SIGHUP reloads them
+static int serve_models(const char *const socket_path)
+{
+    vector<string> filenames;
     
-    do
+    for(size_t i = 0; i < NUM_PLAYERS - 1; i++)
     {
-        // keep track of card states / binary choices
+        ostringstream oss;
+        oss << NUM_PLAYERS << "_players_" << "player_" << (i + 2) << ".bin";
+        filenames.push_back(oss.str());
+    }
+    
+    inference_server_settings settings;
+    
+    if(0 != socket_path)
+        settings.socket_path = socket_path;
+    
+    inference_server server(filenames, settings);
+    
+    signal(SIGHUP, handle_server_signal);
+    signal(SIGINT, handle_server_signal);
+    signal(SIGTERM, handle_server_signal);
+    
+    server.start();
+    cout << "Serving on " << settings.socket_path << endl;
+    
+    for(size_t seconds = 1; 0 == server_stop_requested; seconds++)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
         
-        // have a different copy of the AI for 2 players, 3 players, 4 players, 5 players
+        if(0 != server_reload_requested)
+        {
+            server_reload_requested = 0;
+            
+            if(true == server.reload_models())
+                cout << "Models reloaded" << endl;
+        }
         
-        // have a different copy of the AI for 1st player, 2nd, 3rd, etc.
+        if(0 == seconds % 10)
+            server.print_metrics();
+    }
+    
+    server.stop();
+    server.print_metrics();
+    
+    return 0;
+}
+
+// one shared trunk network for every seat; the tables are played in lockstep,
+// so each decision point is one batched forward pass over all of them
+static int train_shared_trunk(const size_t num_sessions)
+{
+    SharedTrunkNeuralNet NNet(blind_poker_table::get_input_encoding_size(DEFAULT_INPUT_ENCODING), get_num_hidden_neurons(DEFAULT_INPUT_ENCODING), NUM_PLAYERS - 1);
+    
+    NNet.SetLearningRate(1.0);
+    NNet.SetMomentum(1.0);
+    
+    vector<double> inputs, outputs, input;
+    vector<size_t> heads, pending_tables, next_pending_tables;
+    
+    for(size_t num_training_sessions = 0; num_training_sessions < num_sessions; num_training_sessions += shared_trunk_num_tables)
+    {
+        cout << num_training_sessions << endl;
         
-        // 2 players: HUMAN (rand) vs ANN1
-        // 3 players: HUMAN (rand) vs ANN1 ANN2
-        // 4 players: HUMAN (rand) vs ANN1 ANN2 ANN3
-        // 5 players: HUMAN (rand) vs ANN1 ANN2 ANN3 ANN4
-        //
-        // total 1 + 2 + 3 + 4 = 10 ANNs
+        vector<blind_poker_table> tables(shared_trunk_num_tables);
+        vector< vector< vector<input_output_pair> > > nnet_io(shared_trunk_num_tables, vector< vector<input_output_pair> >(NUM_PLAYERS));
         
-        if(num_training_sessions % 10 == 0)
-            cout << num_training_sessions << endl;
+        // every table is on the same turn
+        while(false == tables[0].is_game_over())
+        {
+            const size_t seat = tables[0].get_current_player();
+            
+            if(0 == seat)
+            {
+                for(size_t i = 0; i < tables.size(); i++)
+                    tables[i].play_rand();
+                
+                continue;
+            }
+            
+            pending_tables.clear();
+            
+            for(size_t i = 0; i < tables.size(); i++)
+                pending_tables.push_back(i);
+            
+            // up to two decisions per turn
+            while(0 != pending_tables.size())
+            {
+                inputs.clear();
+                heads.assign(pending_tables.size(), seat - 1);
+                
+                for(size_t i = 0; i < pending_tables.size(); i++)
+                {
+                    tables[pending_tables[i]].get_ANN_input(input);
+                    inputs.insert(inputs.end(), input.begin(), input.end());
+                }
+                
+                NNet.FeedForwardBatch(inputs, heads, outputs);
+                
+                next_pending_tables.clear();
+                
+                for(size_t i = 0; i < pending_tables.size(); i++)
+                {
+                    const size_t table_index = pending_tables[i];
+                    
+                    input_output_pair iop;
+                    iop.input.assign(inputs.begin() + i*NNet.GetNumInputLayerNeurons(), inputs.begin() + (i + 1)*NNet.GetNumInputLayerNeurons());
+                    iop.output.assign(1, outputs[i]);
+                    nnet_io[table_index][seat].push_back(iop);
+                    
+                    if(true == tables[table_index].play_ANN_decision(outputs[i]))
+                        next_pending_tables.push_back(table_index);
+                }
+                
+                pending_tables.swap(next_pending_tables);
+            }
+        }
         
-        // play game
-        blind_poker_table bpt;
+        for(size_t i = 0; i < tables.size(); i++)
+        {
+            vector< vector<size_t> > ranking;
+            tables[i].get_showdown_ranking(ranking);
+            
+            vector<bool> is_winner(NUM_PLAYERS, false);
+            
+            for(size_t j = 0; j < ranking[0].size(); j++)
+                is_winner[ranking[0][j]] = true;
+            
+            for(size_t j = 1; j < NUM_PLAYERS; j++)
+            {
+                // if winner, do nothing
+                if(true == is_winner[j])
+                    continue;
+                
+                // if loser, switch ~0 for 1 and ~1 for 0
+                for(size_t k = 0; k < nnet_io[i][j].size(); k++)
+                {
+                    NNet.FeedForward(nnet_io[i][j][k].input, j - 1);
+                    NNet.BackPropagate(0 == floor(nnet_io[i][j][k].output[0] + 0.5) ? 1 : 0);
+                }
+            }
+        }
+    }
+    
+    ostringstream oss;
+    oss << NUM_PLAYERS << "_players_shared.bin";
+    
+    NNet.SaveToFile(oss.str().c_str());
+    cout << oss.str() << endl;
+    
+    return 0;
+}
+
+// prunes the saved seat networks, "threshold <t>" or "topk <k>", and compares them with the originals
+static int prune_models(const char *const method, const char *const amount)
+{
+    vector<FFBPNeuralNet> dense_NNets, pruned_NNets;
+    
+    for(size_t i = 0; i < NUM_PLAYERS - 1; i++)
+    {
+        ostringstream oss;
+        oss << NUM_PLAYERS << "_players_" << "player_" << (i + 2) << ".bin";
+        
+        FFBPNeuralNet NNet(oss.str().c_str());
+        
+        dense_NNets.push_back(NNet);
+        
+        if(0 == strcmp(method, "topk"))
+            NNet.PruneWeightsTopK(static_cast<size_t>(atoi(amount)));
+        else
+            NNet.PruneWeights(atof(amount));
         
-        vector< vector<input_output_pair> > nnet_io;
-        nnet_io.resize(NUM_PLAYERS - 1); 
+        pruned_NNets.push_back(NNet);
+        
+        cout << oss.str() << ": kept " << NNet.GetNumNonzeroWeights() << " of " << NNet.GetNumWeights() << " weights" << endl;
+    }
+    
+    // inference speed, over the states of some random games
+    vector< vector<double> > inputs;
+    blind_poker_table bpt;
+    
+    for(size_t i = 0; i < 100; i++)
+    {
+        bpt.reset_table();
         
-        for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
+        while(false == bpt.is_game_over())
         {
+            vector<double> input;
+            bpt.get_ANN_input(input, dense_NNets[0]);
+            inputs.push_back(input);
+            
             bpt.play_rand();
+        }
+    }
+    
+    double seconds[2] = { 0, 0 };
+    vector<FFBPNeuralNet> *NNets[2] = { &dense_NNets, &pruned_NNets };
+    
+    for(size_t i = 0; i < 2; i++)
+    {
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        
+        for(size_t j = 0; j < NNets[i]->size(); j++)
+            for(size_t k = 0; k < inputs.size(); k++)
+                (*NNets[i])[j].FeedForward(inputs[k]);
+        
+        seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    }
+    
+    cout << "dense FeedForward: " << 1e9 * seconds[0] / (inputs.size() * dense_NNets.size()) << " ns" << endl;
+    cout << "sparse FeedForward: " << 1e9 * seconds[1] / (inputs.size() * pruned_NNets.size()) << " ns" << endl;
+    cout << "speedup: " << seconds[0] / seconds[1] << endl;
+    
+    // win rate, on the same deals
+    evaluation_result dense_result, pruned_result;
+    
+    evaluate_networks(dense_NNets, evaluation_num_games, evaluation_seed, dense_result);
+    evaluate_networks(pruned_NNets, evaluation_num_games, evaluation_seed, pruned_result);
+    
+    cout << "dense win rate: " << dense_result.ANN_win_rate << endl;
+    cout << "pruned win rate: " << pruned_result.ANN_win_rate << endl;
+    cout << "change: " << pruned_result.ANN_win_rate - dense_result.ANN_win_rate << endl;
+    
+    for(size_t i = 0; i < pruned_NNets.size(); i++)
+    {
+        ostringstream oss;
+        oss << NUM_PLAYERS << "_players_" << "player_" << (i + 2) << "_pruned.bin";
+        
+        pruned_NNets[i].SaveToFile(oss.str().c_str());
+        cout << oss.str() << endl;
+    }
+    
+    return 0;
+}
+
+// trains fresh seat networks with each optimiser until they reach the target
+// win rate on a small fixed evaluation set, timing the training alone
+static int benchmark_optimisers(const double target_win_rate)
+{
+    const char *const names[] = { "classic", "momentum", "nesterov", "rmsprop", "adam" };
+    
+    // learning rate, momentum / first moment decay, second moment decay
+    const double settings[][3] = { { 1.0, 1.0, 0 }, { 0.1, 0.9, 0 }, { 0.1, 0.9, 0 }, { 0.001, 0, 0.9 }, { 0.001, 0.9, 0.999 } };
+    
+    for(size_t optimiser = OPTIMISER_CLASSIC; optimiser <= OPTIMISER_ADAM; optimiser++)
+    {
+        // the same initial weights and games for every optimiser
+        srand(optimiser_benchmark_seed);
+        
+        vector<FFBPNeuralNet> NNets;
+        create_seat_networks(NNets);
+        
+        // the decays first, SetOptimiser keeps them and checks they suit it
+        for(size_t i = 0; i < NNets.size(); i++)
+        {
+            NNets[i].SetLearningRate(settings[optimiser][0]);
+            NNets[i].SetMomentum(settings[optimiser][1]);
             
-            for(size_t j = 1; j < NUM_PLAYERS; j++)
-                bpt.play_ANN(nnet_io[j - 1], NNets[j - 1]);
+            if(0 != settings[optimiser][2])
+                NNets[i].SetSecondMomentDecay(settings[optimiser][2]);
+            
+            NNets[i].SetOptimiser(optimiser);
+        }
+        
+        evaluation_result result;
+        result.ANN_win_rate = 0;
+        
+        double training_seconds = 0, best_win_rate = 0;
+        size_t num_games = 0;
+        
+        while(num_games < optimiser_benchmark_max_games && result.ANN_win_rate < target_win_rate)
+        {
+            std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+            
+            train_serial_games(NNets, optimiser_benchmark_interval);
+            num_games += optimiser_benchmark_interval;
+            
+            training_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            
+            evaluate_networks(NNets, optimiser_benchmark_num_evaluation_games, evaluation_seed, result);
+            
+            if(result.ANN_win_rate > best_win_rate)
+                best_win_rate = result.ANN_win_rate;
+        }
+        
+        cout << names[optimiser] << ": win rate " << result.ANN_win_rate << " after " << num_games << " games, " << training_seconds << " s";
+        
+        if(result.ANN_win_rate < target_win_rate)
+            cout << " (target not reached, best " << best_win_rate << ")";
+        
+        cout << endl;
+    }
+    
+    return 0;
+}
+
+// writes the table, then times its lookups over the states of some random games
+// and checks a sample of them against counting out the same shown cards
+static int build_hand_outcome_table(const char *const filename)
+{
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    
+    hand_outcome_table::generate(filename);
+    
+    cout << "Generated " << filename << " in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() << " s" << endl;
+    
+    hand_outcome_table table(filename);
+    
+    cout << table.get_num_sets() << " sets, " << table.get_num_rows() << " canonical rows" << endl;
+    
+    vector<unsigned char> positions;
+    blind_poker_table bpt;
+    
+    for(size_t i = 0; i < 1000; i++)
+    {
+        bpt.reset_table();
+        
+        while(false == bpt.is_game_over())
+        {
+            positions.resize(positions.size() + NUM_CARDS_PER_DECK);
+            bpt.get_card_positions(&positions[positions.size() - NUM_CARDS_PER_DECK]);
+            
+            bpt.play_rand();
+        }
+    }
+    
+    const size_t num_states = positions.size() / NUM_CARDS_PER_DECK;
+    double sum = 0;
+    
+    start_time = std::chrono::steady_clock::now();
+    
+    for(size_t i = 0; i < num_states; i++)
+        for(size_t j = 0; j < NUM_PLAYERS; j++)
+            sum += table.lookup_player(&positions[i*NUM_CARDS_PER_DECK], j)[HIGH_CARD];
+    
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    
+    cout << "lookup: " << 1e9 * seconds / (num_states * NUM_PLAYERS) << " ns" << " (mean high card odds " << sum / (num_states * NUM_PLAYERS) << ")" << endl;
+    
+    // counting out a hand with few cards shown is slow, and those hands come
+    // up in every game, so each set of shown cards is counted once
+    map<unsigned long long, vector<float> > counted_sets;
+    size_t num_checked = 0;
+    
+    for(size_t i = 0; i < num_states; i += hand_outcome_table_check_interval)
+    {
+        const unsigned char *const state = &positions[i*NUM_CARDS_PER_DECK];
+        
+        for(size_t j = 0; j < NUM_PLAYERS; j++)
+        {
+            unsigned char card_ids[NUM_CARDS_PER_HAND];
+            size_t num_cards = 0;
+            unsigned long long set = 0;
+            
+            for(size_t k = 0; k < NUM_CARDS_PER_DECK; k++)
+            {
+                if(POSITION_HAND0 + j == state[k])
+                {
+                    card_ids[num_cards++] = static_cast<unsigned char>(k);
+                    set |= 1ULL << k;
+                }
+            }
+            
+            vector<float> &counted = counted_sets[set];
+            
+            if(counted.empty())
+            {
+                counted.resize(NUM_HAND_CATEGORIES);
+                hand_outcome_table::count_outcomes(card_ids, num_cards, &counted[0]);
+            }
+            
+            const float *const looked_up = table.lookup_player(state, j);
+            
+            for(size_t k = 0; k < NUM_HAND_CATEGORIES; k++)
+            {
+                if(looked_up[k] != counted[k])
+                {
+                    cout << "lookup mismatch at state " << i << ", player " << j + 1 << ": " << looked_up[k] << " != " << counted[k] << endl;
+                    return 1;
+                }
+            }
+            
+            num_checked++;
         }
+    }
+    
+    cout << num_checked << " lookups match the counted outcomes" << endl;
+    
+    const float *const odds = table.lookup(0, 0);
+    
+    cout << "odds with nothing shown:";
+    
+    for(size_t i = 0; i < NUM_HAND_CATEGORIES; i++)
+        cout << " " << odds[i];
+    
+    cout << endl;
+    
+    return 0;
+}
 
-        // Determine the winner
-        size_t index = bpt.get_best_rank_finished();
+// trains seat networks with and without the engineered features on the same
+// games, and compares their win rates on the fixed evaluation set as they go
+static int benchmark_engineered_features(const size_t num_games)
+{
+    // the encoder's own cost, over the states of some random games
+    vector<unsigned char> positions;
+    blind_poker_table bpt;
+    
+    for(size_t i = 0; i < 1000; i++)
+    {
+        bpt.reset_table();
+        
+        while(false == bpt.is_game_over())
+        {
+            positions.resize(positions.size() + NUM_CARDS_PER_DECK);
+            bpt.get_card_positions(&positions[positions.size() - NUM_CARDS_PER_DECK]);
+            
+            bpt.play_rand();
+        }
+    }
+    
+    const size_t num_states = positions.size() / NUM_CARDS_PER_DECK;
+    vector<double> features;
+    features.reserve(NUM_ENGINEERED_FEATURES);
+    
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    
+    for(size_t i = 0; i < num_states; i++)
+    {
+        features.clear();
+        append_engineered_features(&positions[i*NUM_CARDS_PER_DECK], features);
+    }
+    
+    cout << "append_engineered_features, from positions: " << 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() / num_states << " ns" << endl;
+    
+    // from a table's face masks, over the states of the same number of games,
+    // a few times per state so the play itself isn't timed
+    const size_t num_repeats = 16;
+    double seconds = 0;
+    
+    for(size_t i = 0; i < 1000; i++)
+    {
+        bpt.reset_table();
+        
+        while(false == bpt.is_game_over())
+        {
+            start_time = std::chrono::steady_clock::now();
+            
+            for(size_t j = 0; j < num_repeats; j++)
+            {
+                features.clear();
+                append_engineered_features(bpt, features);
+            }
+            
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            
+            bpt.play_rand();
+        }
+    }
+    
+    cout << "append_engineered_features, from a table: " << 1e9 * seconds / (num_states * num_repeats) << " ns" << endl;
+    
+    vector<FFBPNeuralNet> NNets[2];
+    
+    for(size_t i = 0; i < 2; i++)
+    {
+        // the same games for both
+        srand(optimiser_benchmark_seed);
+        create_seat_networks(NNets[i], 1 == i);
+    }
+    
+    for(size_t i = 0; i < num_games; i += optimiser_benchmark_interval)
+    {
+        cout << i + optimiser_benchmark_interval << " games, win rate";
+        
+        for(size_t j = 0; j < 2; j++)
+        {
+            srand(optimiser_benchmark_seed + static_cast<unsigned int>(i));
+            train_serial_games(NNets[j], optimiser_benchmark_interval);
+            
+            evaluation_result result;
+            evaluate_networks(NNets[j], optimiser_benchmark_num_evaluation_games, evaluation_seed, result);
+            
+            cout << (0 == j ? " without features " : ", with features ") << result.ANN_win_rate;
+        }
+        
+        cout << endl;
+    }
+    
+    return 0;
+}
 
-        cout << "winner : " << index + 1 << endl;
+// trains seat networks for each input encoding on the same deals, and compares
+// the cost of encoding, of a forward pass and of a training game, and the win rate
+static int benchmark_input_encodings(const size_t num_games)
+{
+    const char *const names[] = { "binary", "one hot" };
+    
+    // the states of some random games
+    vector<unsigned char> positions;
+    blind_poker_table bpt;
+    
+    for(size_t i = 0; i < 1000; i++)
+    {
+        bpt.reset_table();
         
-        for(size_t i = 0; i < NUM_PLAYERS; i++)
+        while(false == bpt.is_game_over())
         {
-            cout << "player " << i + 1 << ": ";
-            bpt.print_sorted_hand(i);
-            bpt.print_finished_rank(i);
-            cout << " " << bpt.numeric_rank_finished_hand(i);
-            cout << endl;
+            positions.resize(positions.size() + NUM_CARDS_PER_DECK);
+            bpt.get_card_positions(&positions[positions.size() - NUM_CARDS_PER_DECK]);
+            
+            bpt.play_rand();
         }
+    }
+    
+    const size_t num_states = positions.size() / NUM_CARDS_PER_DECK;
+    
+    for(size_t encoding = INPUT_ENCODING_BINARY; encoding <= INPUT_ENCODING_ONE_HOT; encoding++)
+    {
+        vector< vector<double> > inputs(num_states);
         
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
         
+        for(size_t i = 0; i < num_states; i++)
+            blind_poker_table::encode_ANN_input(&positions[i*NUM_CARDS_PER_DECK], inputs[i], encoding);
         
-        error_rate = 0;
+        const double encoding_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        
+        vector<FFBPNeuralNet> NNets;
+        create_seat_networks(NNets, false, encoding);
+        
+        // the shapes differ, and so does the rand() their weights used up, so
+        // the seed comes after them for each encoding to play the same deals
+        srand(optimiser_benchmark_seed);
+        
+        start_time = std::chrono::steady_clock::now();
+        
+        for(size_t i = 0; i < num_states; i++)
+            NNets[0].FeedForward(inputs[i]);
+        
+        const double inference_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        
+        start_time = std::chrono::steady_clock::now();
+        
+        train_serial_games(NNets, num_games);
+        
+        const double training_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        
+        evaluation_result result;
+        evaluate_networks(NNets, evaluation_num_games, evaluation_seed, result);
+        
+        cout << names[encoding] << " (" << blind_poker_table::get_input_encoding_size(encoding) << " inputs): ";
+        cout << "encoding " << 1e9 * encoding_seconds / num_states << " ns, ";
+        cout << "inference " << 1e9 * inference_seconds / num_states << " ns, ";
+        cout << num_games / training_seconds << " games per second, ";
+        cout << "win rate " << result.ANN_win_rate << " after " << num_games << " games" << endl;
+    }
+    
+    return 0;
+}
+
+// runs the CFR solver, checkpointing and reporting its speed and exploitability as it goes
+static int solve_cfr(const size_t num_iterations, const char *const filename)
+{
+    cfr_solver solver;
+    
+    // carry on from the last checkpoint, if there is one
+    if(true == ifstream(filename).good())
+    {
+        solver.load_checkpoint(filename);
+        
+        cout << "Resuming from " << filename << " after " << solver.get_num_iterations() << " iterations" << endl;
+    }
+    
+    for(size_t i = 0; i < num_iterations; i += cfr_report_interval)
+    {
+        const size_t temp_num_iterations = (num_iterations - i < cfr_report_interval) ? num_iterations - i : cfr_report_interval;
+        
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        
+        solver.run(temp_num_iterations, cfr_seed);
+        
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        
+        solver.save_checkpoint(filename);
+        
+        cout << solver.get_num_iterations() << " iterations, ";
+        cout << temp_num_iterations / seconds << " iterations/sec, ";
+        cout << solver.get_num_info_sets() << " info sets, ";
+        cout << "exploitability " << solver.estimate_exploitability(cfr_exploitability_num_games, evaluation_seed) << endl;
+    }
+    
+    return 0;
+}
 
-        // for each ANN
-        for(size_t i = 1; i < NUM_PLAYERS; i++)
+// sums one batch's gradients with each reduction and number of threads, and
+// compares their speed, their distance from the exact sum, and whether they
+// match the single threaded result bit for bit
+static int benchmark_gradient_reduction(const size_t num_samples)
+{
+    srand(gradient_reduction_seed);
+    
+    vector<FFBPNeuralNet> NNets;
+    create_seat_networks(NNets);
+    
+    // states of random games, each with a random decision to learn
+    vector<input_output_pair> samples;
+    blind_poker_table bpt;
+    unsigned char positions[NUM_CARDS_PER_DECK];
+    
+    while(samples.size() < num_samples)
+    {
+        if(true == bpt.is_game_over())
+            bpt.reset_table();
+        
+        bpt.get_card_positions(positions);
+        
+        input_output_pair io;
+        blind_poker_table::encode_ANN_input(positions, io.input);
+        io.output.push_back(static_cast<double>(rand() % 2));
+        samples.push_back(io);
+        
+        bpt.play_rand();
+    }
+    
+    // the exact sum, near enough
+    vector< vector<long double> > exact_sums;
+    vector< vector<double> > gradients;
+    
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        NNets[0].FeedForward(samples[i].input);
+        NNets[0].ComputeGradients(samples[i].output, gradients);
+        
+        exact_sums.resize(gradients.size());
+        
+        for(size_t j = 0; j < gradients.size(); j++)
         {
-            // if winner, do nothing
-            if(index == i)
-                continue;
+            exact_sums[j].resize(gradients[j].size(), 0.0L);
+            
+            for(size_t k = 0; k < gradients[j].size(); k++)
+                exact_sums[j][k] += gradients[j][k];
+        }
+    }
+    
+    const char *const names[] = { "tree", "tree with Kahan", "atomic" };
+    
+    for(size_t method = 0; method < 3; method++)
+    {
+        vector< vector<double> > single_threaded_gradients;
+        
+        for(size_t num_threads = 1; num_threads <= gradient_reduction_max_num_threads; num_threads *= 2)
+        {
+            gradient_reducer reducer(num_threads, GRADIENT_REDUCER_DEFAULT_BLOCK_SIZE, 1 == method ? GRADIENT_SUMMATION_KAHAN : GRADIENT_SUMMATION_PLAIN);
             
-            // if loser, switch ~0 for 1 and ~1 for 0
-            for(size_t j = 0; j < nnet_io[i - 1].size(); j++)
+            std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+            
+            for(size_t i = 0; i < gradient_reduction_num_repeats; i++)
             {
-                if(0 == floor(nnet_io[i - 1][j].output[0] + 0.5))
-                    nnet_io[i - 1][j].output[0] = 1;
+                if(2 == method)
+                    reducer.compute_atomic(NNets[0], samples, gradients);
                 else
-                    nnet_io[i - 1][j].output[0] = 0;
+                    reducer.compute(NNets[0], samples, gradients);
             }
             
-            // train network using nnet_io
-            for(size_t j = 0; j < nnet_io[i - 1].size(); j++)
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            
+            if(1 == num_threads)
+                single_threaded_gradients = gradients;
+            
+            // largest error relative to the largest gradient
+            long double max_error = 0, max_gradient = 0;
+            
+            for(size_t j = 0; j < gradients.size(); j++)
             {
-                NNets[i - 1].FeedForward(nnet_io[i - 1][j].input);
-                error_rate += NNets[i - 1].BackPropagate(nnet_io[i - 1][j].output);
+                for(size_t k = 0; k < gradients[j].size(); k++)
+                {
+                    const long double error = fabsl(gradients[j][k] - exact_sums[j][k]);
+                    
+                    if(error > max_error)
+                        max_error = error;
+                    
+                    if(fabsl(exact_sums[j][k]) > max_gradient)
+                        max_gradient = fabsl(exact_sums[j][k]);
+                }
             }
+            
+            // == would count -0 and 0 as the same
+            bool identical = true;
+            
+            for(size_t j = 0; j < gradients.size(); j++)
+                if(0 != memcmp(&gradients[j][0], &single_threaded_gradients[j][0], gradients[j].size()*sizeof(double)))
+                    identical = false;
+            
+            cout << names[method] << ", " << num_threads << " threads: ";
+            cout << 1000.0 * seconds / gradient_reduction_num_repeats << " ms per batch, ";
+            cout << "relative error " << static_cast<double>(0 == max_gradient ? 0 : max_error / max_gradient) << ", ";
+            cout << (identical ? "identical to" : "differs from") << " 1 thread" << endl;
+        }
+    }
+    
+    return 0;
+}
 
-            if(0 != nnet_io[i - 1].size())
-                error_rate /= nnet_io[i - 1].size();
+int main(int argc, char **argv)
+{
+	srand(static_cast<unsigned int>(time(0)));
+	//srand(123);
+    
+    // "serve [socket path]": no training, answer decisions for other processes
+    if(argc > 1 && 0 == strcmp(argv[1], "serve"))
+        return serve_models(argc > 2 ? argv[2] : 0);
+    
+    // "prune threshold <t>" / "prune topk <k>": prune the saved seat networks
+    if(argc > 3 && 0 == strcmp(argv[1], "prune"))
+        return prune_models(argv[2], argv[3]);
+    
+    // "optimisers [target win rate]": time each optimiser to the target
+    if(argc > 1 && 0 == strcmp(argv[1], "optimisers"))
+        return benchmark_optimisers(argc > 2 ? atof(argv[2]) : optimiser_benchmark_target_win_rate);
+    
+    // "random [number of games]": baseline statistics of all-random play
+    if(argc > 1 && 0 == strcmp(argv[1], "random"))
+    {
+        random_play_result simulator_result, table_result;
+        
+        simulate_random_play(argc > 2 ? static_cast<size_t>(atof(argv[2])) : random_play_num_games, random_play_seed, 0, simulator_result);
+        play_random_tables(random_play_num_table_games, table_result);
+        
+        cout << "simulator: ";
+        print_random_play_result(simulator_result);
+        cout << "blind_poker_table: ";
+        print_random_play_result(table_result);
+        
+        return 0;
+    }
+    
+    // "features [number of games]": convergence with and without the engineered features
+    if(argc > 1 && 0 == strcmp(argv[1], "features"))
+        return benchmark_engineered_features(argc > 2 ? static_cast<size_t>(atof(argv[2])) : optimiser_benchmark_max_games);
+    
+    // "encodings [number of games]": the binary and one hot input encodings side by side
+    if(argc > 1 && 0 == strcmp(argv[1], "encodings"))
+        return benchmark_input_encodings(argc > 2 ? static_cast<size_t>(atof(argv[2])) : optimiser_benchmark_max_games);
+    
+    // "outcomes [file]": build the partial hand outcome table
+    if(argc > 1 && 0 == strcmp(argv[1], "outcomes"))
+        return build_hand_outcome_table(argc > 2 ? argv[2] : hand_outcome_table_filename);
+    
+    // "cfr [number of iterations] [checkpoint file]": solve the abstracted game with CFR+
+    if(argc > 1 && 0 == strcmp(argv[1], "cfr"))
+        return solve_cfr(argc > 2 ? static_cast<size_t>(atof(argv[2])) : cfr_num_iterations, argc > 3 ? argv[3] : cfr_checkpoint_filename);
+    
+    // "reduction [number of samples]": compare the ways of summing a batch's gradients over threads
+    if(argc > 1 && 0 == strcmp(argv[1], "reduction"))
+        return benchmark_gradient_reduction(argc > 2 ? static_cast<size_t>(atof(argv[2])) : gradient_reduction_num_samples);
+    
+    size_t max_training_sessions = 100000;
+    
+    // "shared": train one shared trunk network instead of a network per seat
+    if(argc > 1 && 0 == strcmp(argv[1], "shared"))
+        return train_shared_trunk(max_training_sessions);
+    
+    size_t num_training_sessions = 0;
+    
+    vector<FFBPNeuralNet> NNets;
+    
+#ifdef USE_ONE_HOT_INPUT_ENCODING
+    
+    cout << "Using one hot input encoding" << endl;
+    
+#endif
+    
+    
+    create_seat_networks(NNets);
+    
+    // "pipeline": overlap simulation and training on separate threads
+    if(argc > 1 && 0 == strcmp(argv[1], "pipeline"))
+    {
+        training_pipeline_settings settings;
+        training_pipeline pipeline(settings);
+        
+        pipeline.run(NNets, max_training_sessions);
+        pipeline.print_metrics();
+    }
+    // "td": online TD(lambda), the seats learn during the game instead of after it
+    else if(argc > 1 && 0 == strcmp(argv[1], "td"))
+    {
+        vector< unique_ptr<td_lambda_learner> > learners;
+        
+        for(size_t i = 0; i < NNets.size(); i++)
+        {
+            NNets[i].SetLearningRate(td_learning_rate);
+            NNets[i].SetMomentum(0);
+            
+            learners.push_back(unique_ptr<td_lambda_learner>(new td_lambda_learner(NNets[i], td_lambda)));
+        }
+        
+        for(num_training_sessions = 0; num_training_sessions < max_training_sessions; num_training_sessions++)
+        {
+            blind_poker_table bpt;
+            
+            for(size_t i = 0; i < learners.size(); i++)
+                learners[i]->begin_game();
+            
+            for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
+            {
+                bpt.play_rand();
+                
+                for(size_t j = 1; j < NUM_PLAYERS; j++)
+                    learners[j - 1]->play(bpt);
+            }
+            
+            vector< vector<size_t> > ranking;
+            bpt.get_showdown_ranking(ranking);
             
-           //  cout << "Error rate = " << error_rate << endl;
+            vector<bool> is_winner(NUM_PLAYERS, false);
+            
+            for(size_t i = 0; i < ranking[0].size(); i++)
+                is_winner[ranking[0][i]] = true;
+            
+            for(size_t i = 1; i < NUM_PLAYERS; i++)
+                learners[i - 1]->end_game(is_winner[i] ? 1.0 : 0.0);
+            
+            if(0 == (num_training_sessions + 1) % td_evaluation_interval)
+            {
+                evaluation_result result;
+                evaluate_networks(NNets, optimiser_benchmark_num_evaluation_games, evaluation_seed, result);
+                
+                cout << num_training_sessions + 1 << " games, win rate " << result.ANN_win_rate << endl;
+            }
         }
+    }
+    // "offline <file>": train from a game log instead of playing
+    else if(argc > 2 && 0 == strcmp(argv[1], "offline"))
+    {
+        size_t num_games = train_from_game_records(argv[2], NNets);
+        
+        cout << "Trained on " << num_games << " recorded games" << endl;
+    }
+    else
+    {
+        // one task per seat network
+        thread_pool seat_pool(NUM_PLAYERS - 1);
+        
+        // "replay": keep every seat's samples and train on prioritised batches of them
+        vector< unique_ptr<replay_buffer> > replay_buffers(NUM_PLAYERS - 1);
+        
+        if(argc > 1 && 0 == strcmp(argv[1], "replay"))
+            for(size_t i = 0; i < NUM_PLAYERS - 1; i++)
+                replay_buffers[i].reset(new replay_buffer(replay_capacity));
+        
+        // "record <file>": also append every game to a log
+        unique_ptr<game_record_writer> recorder;
+        
+        if(argc > 2 && 0 == strcmp(argv[1], "record"))
+            recorder.reset(new game_record_writer(argv[2]));
+        
+        // stops training, or decays the learning rates, once every seat's loss has plateaued
+        convergence_monitor_settings monitor_settings;
+        convergence_monitor monitor(NNets.size(), monitor_settings);
+        size_t convergence_action = CONVERGENCE_CONTINUE;
+        
+        do
+        {
+            // keep track of card states / binary choices
+        
+            // have a different copy of the AI for 2 players, 3 players, 4 players, 5 players
+        
+            // have a different copy of the AI for 1st player, 2nd, 3rd, etc.
+        
+            // 2 players: HUMAN (rand) vs ANN1
+            // 3 players: HUMAN (rand) vs ANN1 ANN2
+            // 4 players: HUMAN (rand) vs ANN1 ANN2 ANN3
+            // 5 players: HUMAN (rand) vs ANN1 ANN2 ANN3 ANN4
+            //
+            // total 1 + 2 + 3 + 4 = 10 ANNs
+        
+            if(num_training_sessions % 10 == 0)
+                cout << num_training_sessions << endl;
+        
+            // play game
+            blind_poker_table bpt;
+        
+            vector< vector<input_output_pair> > nnet_io;
+            nnet_io.resize(NUM_PLAYERS - 1); 
+        
+            for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
+            {
+                bpt.play_rand();
+            
+                for(size_t j = 1; j < NUM_PLAYERS; j++)
+                    bpt.play_ANN(nnet_io[j - 1], NNets[j - 1]);
+            }
+
+            // Determine the winner(s), tied players split the pot
+            vector< vector<size_t> > ranking;
+            bpt.get_showdown_ranking(ranking);
+            
+            if(0 != recorder.get())
+                recorder->write(bpt);
+        
+            vector<bool> is_winner(NUM_PLAYERS, false);
+        
+            cout << "winner :";
+        
+            for(size_t i = 0; i < ranking[0].size(); i++)
+            {
+                is_winner[ranking[0][i]] = true;
+                cout << " " << ranking[0][i] + 1;
+            }
+        
+            cout << endl;
+        
+            for(size_t i = 0; i < NUM_PLAYERS; i++)
+            {
+                cout << "player " << i + 1 << ": ";
+                bpt.print_sorted_hand(i);
+                bpt.print_finished_rank(i);
+                cout << " " << bpt.numeric_rank_finished_hand(i);
+                cout << endl;
+            }
+            
+            // each seat's win and mean decision entropy, before training changes the outputs
+            for(size_t i = 1; i < NUM_PLAYERS; i++)
+            {
+                double entropy = 0;
+                
+                for(size_t j = 0; j < nnet_io[i - 1].size(); j++)
+                    entropy += convergence_monitor::get_decision_entropy(nnet_io[i - 1][j].output[0]);
+                
+                if(0 != nnet_io[i - 1].size())
+                    monitor.add(i - 1, CONVERGENCE_METRIC_ENTROPY, entropy / nnet_io[i - 1].size());
+                
+                monitor.add(i - 1, CONVERGENCE_METRIC_WIN_RATE, is_winner[i] ? 1.0 : 0.0);
+            }
+            
+            // train the losing seats in parallel, each into its own error slot
+            vector<double> seat_error_sums(NUM_PLAYERS, 0.0);
+            
+            for(size_t i = 1; i < NUM_PLAYERS; i++)
+            {
+                // if winner, do nothing
+                if(true == is_winner[i])
+                    continue;
+                
+                seat_pool.add_task([&NNets, &nnet_io, &seat_error_sums, &replay_buffers, i]() { train_seat(NNets[i - 1], nnet_io[i - 1], seat_error_sums[i], replay_buffers[i - 1].get()); });
+            }
+            
+            seat_pool.wait();
+            
+            // each trained seat's mean error over the samples it trained on
+            for(size_t i = 1; i < NUM_PLAYERS; i++)
+            {
+                if(true == is_winner[i] || 0 == nnet_io[i - 1].size())
+                    continue;
+                
+                monitor.add(i - 1, CONVERGENCE_METRIC_LOSS, seat_error_sums[i] / nnet_io[i - 1].size());
+            }
+            
+            convergence_action = monitor.end_game();
+            
+            if(0 == monitor.get_num_games() % monitor_settings.window_size)
+                monitor.print(1);
+            
+            if(CONVERGENCE_DECAY_LEARNING_RATE == convergence_action)
+            {
+                for(size_t i = 0; i < NNets.size(); i++)
+                    NNets[i].SetLearningRate(NNets[i].GetLearningRate()*monitor_settings.learning_rate_decay);
+                
+                cout << "Plateau, learning rate now " << NNets[0].GetLearningRate() << endl;
+            }
+            else if(CONVERGENCE_STOP == convergence_action)
+            {
+                cout << "Plateau, stopping after " << num_training_sessions + 1 << " games" << endl;
+            }
                     
-        num_training_sessions++;
+            num_training_sessions++;
+        }
+        while(CONVERGENCE_STOP != convergence_action && num_training_sessions < max_training_sessions);
     }
-    while(/*error_rate >= max_error_rate &&*/ num_training_sessions < max_training_sessions);
     
 
     
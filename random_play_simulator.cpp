@@ -0,0 +1,358 @@
+#include "random_play_simulator.h"
+
+#include <chrono>
+
+#include <thread>
+using std::thread;
+
+#include <iomanip>
+
+
+// the lane's card names, card_id == (face - FACE_2)*4 + suit
+#define RANDOM_PLAY_FACE(card_id) (((card_id) >> 2) + FACE_2)
+#define RANDOM_PLAY_SUIT(card_id) ((card_id) & 3)
+
+
+random_play_result::random_play_result(void)
+{
+    num_games = 0;
+    seconds = 0;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        seat_wins[i] = 0;
+        
+        for(size_t j = 0; j <= ROYAL_FLUSH; j++)
+            category_counts[i][j] = 0;
+    }
+}
+
+void random_play_result::add(const random_play_result &rhs)
+{
+    num_games += rhs.num_games;
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        seat_wins[i] += rhs.seat_wins[i];
+        
+        for(size_t j = 0; j <= ROYAL_FLUSH; j++)
+            category_counts[i][j] += rhs.category_counts[i][j];
+    }
+}
+
+// splitmix64, for seeding the lanes
+static unsigned long long get_seed_rand(unsigned long long &state)
+{
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// a value in [0, n) from 32 random bits
+static inline unsigned int get_rand_below(const unsigned int bits, const unsigned int n)
+{
+    return static_cast<unsigned int>((static_cast<unsigned long long>(bits) * n) >> 32);
+}
+
+random_play_simulator::random_play_simulator(const unsigned long long seed)
+{
+    unsigned long long state = seed;
+    
+    for(size_t i = 0; i < RANDOM_PLAY_NUM_LANES; i++)
+    {
+        // xorshift must not start at 0
+        rand_states[i] = get_seed_rand(state);
+        
+        if(0 == rand_states[i])
+            rand_states[i] = 0x9E3779B97F4A7C15ULL;
+    }
+}
+
+void random_play_simulator::play(const size_t num_games, random_play_result &result)
+{
+    for(size_t i = 0; i < num_games; i += RANDOM_PLAY_NUM_LANES)
+    {
+        deal();
+        
+        // every lane is on the same turn, as in blind_poker_table
+        for(size_t j = 0; j < NUM_CARDS_PER_HAND; j++)
+            for(size_t k = 0; k < NUM_PLAYERS; k++)
+                play_turn(k);
+        
+        showdown(result);
+    }
+}
+
+void random_play_simulator::next_rand(void)
+{
+    for(size_t i = 0; i < RANDOM_PLAY_NUM_LANES; i++)
+    {
+        unsigned long long x = rand_states[i];
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        rand_states[i] = x;
+        
+        rand_bits[i] = static_cast<unsigned int>((x * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+}
+
+void random_play_simulator::deal(void)
+{
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        for(size_t j = 0; j < RANDOM_PLAY_NUM_LANES; j++)
+            deck[i][j] = static_cast<unsigned char>(i);
+    
+    // Fisher-Yates, each lane swapping with its own index
+    for(size_t i = NUM_CARDS_PER_DECK - 1; i > 0; i--)
+    {
+        next_rand();
+        
+        for(size_t j = 0; j < RANDOM_PLAY_NUM_LANES; j++)
+        {
+            const unsigned int k = get_rand_below(rand_bits[j], static_cast<unsigned int>(i + 1));
+            
+            const unsigned char temp = deck[i][j];
+            deck[i][j] = deck[k][j];
+            deck[k][j] = temp;
+        }
+    }
+    
+    // as blind_poker_table::deal_cards, from the top of the pickup pile round the table
+    for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
+        for(size_t j = 0; j < NUM_PLAYERS; j++)
+            for(size_t k = 0; k < RANDOM_PLAY_NUM_LANES; k++)
+                hands[j*NUM_CARDS_PER_HAND + i][k] = deck[NUM_CARDS_PER_DECK - 1 - (i*NUM_PLAYERS + j)][k];
+    
+    for(size_t i = 0; i < RANDOM_PLAY_NUM_LANES; i++)
+    {
+        discard_tops[i] = deck[NUM_CARDS_PER_DECK - 1 - NUM_PLAYERS*NUM_CARDS_PER_HAND][i];
+        pickup_sizes[i] = static_cast<unsigned char>(NUM_CARDS_PER_DECK - 1 - NUM_PLAYERS*NUM_CARDS_PER_HAND);
+    }
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        for(size_t j = 0; j < RANDOM_PLAY_NUM_LANES; j++)
+            shown_masks[i][j] = 0;
+}
+
+void random_play_simulator::play_turn(const size_t player)
+{
+    unsigned int choices[RANDOM_PLAY_NUM_LANES];
+    unsigned int slot_bits[RANDOM_PLAY_NUM_LANES];
+    
+    // flip or take, and discard or keep; the second choice is ignored when taking
+    next_rand();
+    
+    for(size_t i = 0; i < RANDOM_PLAY_NUM_LANES; i++)
+        choices[i] = rand_bits[i] >> 30;
+    
+    next_rand();
+    
+    for(size_t i = 0; i < RANDOM_PLAY_NUM_LANES; i++)
+        slot_bits[i] = rand_bits[i];
+    
+    unsigned char *const shown = shown_masks[player];
+    unsigned char (*const hand)[RANDOM_PLAY_NUM_LANES] = &hands[player*NUM_CARDS_PER_HAND];
+    
+    for(size_t i = 0; i < RANDOM_PLAY_NUM_LANES; i++)
+    {
+        // a random one of the hand's cards not shown yet, as get_rand_not_shown_index
+        const unsigned int not_shown = ~static_cast<unsigned int>(shown[i]) & ((1u << NUM_CARDS_PER_HAND) - 1);
+        const unsigned int num_not_shown = (not_shown & 1) + ((not_shown >> 1) & 1) + ((not_shown >> 2) & 1) + ((not_shown >> 3) & 1) + ((not_shown >> 4) & 1);
+        const unsigned int target = get_rand_below(slot_bits[i], num_not_shown);
+        
+        unsigned int slot = 0, num_seen = 0;
+        
+        for(unsigned int j = 0; j < NUM_CARDS_PER_HAND; j++)
+        {
+            const unsigned int is_candidate = (not_shown >> j) & 1;
+            slot = (is_candidate && num_seen == target) ? j : slot;
+            num_seen += is_candidate;
+        }
+        
+        unsigned int hand_card = hand[0][i];
+        
+        for(unsigned int j = 1; j < NUM_CARDS_PER_HAND; j++)
+            hand_card = (slot == j) ? hand[j][i] : hand_card;
+        
+        const unsigned int take = (0 == (choices[i] & 1));
+        const unsigned int keep = (0 != (choices[i] & 2));
+        const unsigned int pickup_top = deck[pickup_sizes[i] - 1][i];
+        
+        // take: hand <-> discard top; flip and discard: pickup top -> discard top;
+        // flip and keep: hand -> discard top, pickup top -> hand
+        const unsigned int new_hand_card = take ? discard_tops[i] : (keep ? pickup_top : hand_card);
+        const unsigned int new_discard_top = (take | keep) ? hand_card : pickup_top;
+        
+        for(unsigned int j = 0; j < NUM_CARDS_PER_HAND; j++)
+            hand[j][i] = static_cast<unsigned char>((slot == j) ? new_hand_card : hand[j][i]);
+        
+        discard_tops[i] = static_cast<unsigned char>(new_discard_top);
+        pickup_sizes[i] = static_cast<unsigned char>(pickup_sizes[i] - (1 - take));
+        shown[i] = static_cast<unsigned char>(shown[i] | (1u << slot));
+    }
+}
+
+void random_play_simulator::showdown(random_play_result &result)
+{
+    const size_t num_hands = NUM_PLAYERS*RANDOM_PLAY_NUM_LANES;
+    
+    // hand (player, lane) is hand player*RANDOM_PLAY_NUM_LANES + lane
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        for(size_t j = 0; j < NUM_CARDS_PER_HAND; j++)
+        {
+            const unsigned char *const cards = hands[i*NUM_CARDS_PER_HAND + j];
+            unsigned char *const hand_faces = &faces[j*num_hands + i*RANDOM_PLAY_NUM_LANES];
+            unsigned char *const hand_suits = &suits[j*num_hands + i*RANDOM_PLAY_NUM_LANES];
+            
+            for(size_t k = 0; k < RANDOM_PLAY_NUM_LANES; k++)
+            {
+                hand_faces[k] = static_cast<unsigned char>(RANDOM_PLAY_FACE(cards[k]));
+                hand_suits[k] = static_cast<unsigned char>(RANDOM_PLAY_SUIT(cards[k]));
+            }
+        }
+    }
+    
+    batch_get_hand_strength(num_hands, faces, suits, strengths);
+    
+    unsigned int best[RANDOM_PLAY_NUM_LANES];
+    unsigned int num_winners[RANDOM_PLAY_NUM_LANES];
+    
+    for(size_t i = 0; i < RANDOM_PLAY_NUM_LANES; i++)
+    {
+        best[i] = strengths[i];
+        num_winners[i] = 0;
+    }
+    
+    for(size_t i = 1; i < NUM_PLAYERS; i++)
+        for(size_t j = 0; j < RANDOM_PLAY_NUM_LANES; j++)
+            best[j] = (strengths[i*RANDOM_PLAY_NUM_LANES + j] > best[j]) ? strengths[i*RANDOM_PLAY_NUM_LANES + j] : best[j];
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        for(size_t j = 0; j < RANDOM_PLAY_NUM_LANES; j++)
+            num_winners[j] += (strengths[i*RANDOM_PLAY_NUM_LANES + j] == best[j]);
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+    {
+        for(size_t j = 0; j < RANDOM_PLAY_NUM_LANES; j++)
+        {
+            const unsigned int strength = strengths[i*RANDOM_PLAY_NUM_LANES + j];
+            
+            if(strength == best[j])
+                result.seat_wins[i] += 1.0 / num_winners[j];
+            
+            result.category_counts[i][get_hand_strength_category(strength)]++;
+        }
+    }
+    
+    result.num_games += RANDOM_PLAY_NUM_LANES;
+}
+
+void simulate_random_play(const size_t num_games, const unsigned long long seed, const size_t num_threads, random_play_result &result)
+{
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    
+    size_t temp_num_threads = num_threads;
+    
+    if(0 == temp_num_threads)
+        temp_num_threads = thread::hardware_concurrency();
+    
+    if(0 == temp_num_threads)
+        temp_num_threads = 1;
+    
+    // whole lane blocks per thread
+    const size_t num_blocks = (num_games + RANDOM_PLAY_NUM_LANES - 1) / RANDOM_PLAY_NUM_LANES;
+    
+    vector<random_play_result> results(temp_num_threads);
+    vector<thread> threads;
+    
+    unsigned long long state = seed;
+    
+    for(size_t i = 0; i < temp_num_threads; i++)
+    {
+        const size_t thread_num_blocks = num_blocks / temp_num_threads + (i < num_blocks % temp_num_threads ? 1 : 0);
+        const unsigned long long thread_seed = get_seed_rand(state);
+        random_play_result *const thread_result = &results[i];
+        
+        threads.push_back(thread([thread_num_blocks, thread_seed, thread_result]()
+        {
+            random_play_simulator simulator(thread_seed);
+            simulator.play(thread_num_blocks * RANDOM_PLAY_NUM_LANES, *thread_result);
+        }));
+    }
+    
+    // summed in thread order, so the result doesn't depend on scheduling
+    for(size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+        result.add(results[i]);
+    }
+    
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void play_random_tables(const size_t num_games, random_play_result &result)
+{
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    
+    blind_poker_table bpt;
+    
+    for(size_t i = 0; i < num_games; i++)
+    {
+        bpt.reset_table();
+        
+        while(false == bpt.is_game_over())
+            bpt.play_rand();
+        
+        vector< vector<size_t> > ranking;
+        bpt.get_showdown_ranking(ranking);
+        
+        for(size_t j = 0; j < ranking[0].size(); j++)
+            result.seat_wins[ranking[0][j]] += 1.0 / ranking[0].size();
+        
+        for(size_t j = 0; j < NUM_PLAYERS; j++)
+            result.category_counts[j][get_hand_strength_category(bpt.get_hand_strength(j))]++;
+    }
+    
+    result.num_games += num_games;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void print_random_play_result(const random_play_result &result)
+{
+    static const char *const category_names[ROYAL_FLUSH + 1] = { "high card", "one pair", "two pair", "three of a kind", "straight", "flush", "full house", "four of a kind", "straight flush", "royal flush" };
+    
+    cout << result.num_games << " games";
+    
+    if(0 != result.seconds)
+        cout << ", " << result.num_games / result.seconds << " games per second";
+    
+    cout << endl;
+    
+    if(0 == result.num_games)
+        return;
+    
+    cout << std::setw(16) << "";
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        cout << std::setw(12) << "player " << i + 1;
+    
+    cout << endl << std::setw(16) << "win rate";
+    
+    for(size_t i = 0; i < NUM_PLAYERS; i++)
+        cout << std::setw(13) << result.seat_wins[i] / result.num_games;
+    
+    cout << endl;
+    
+    for(size_t i = 0; i <= ROYAL_FLUSH; i++)
+    {
+        cout << std::setw(16) << category_names[i];
+        
+        for(size_t j = 0; j < NUM_PLAYERS; j++)
+            cout << std::setw(13) << static_cast<double>(result.category_counts[j][i]) / result.num_games;
+        
+        cout << endl;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef RANDOM_PLAY_SIMULATOR_H
+#define RANDOM_PLAY_SIMULATOR_H
+
+
+#include "cards.h"
+
+
+// games advanced side by side, one per SIMD lane; 16 byte lanes fill an
+// SSE register, and the 64 bit generator state fills two AVX-512 registers
+#define RANDOM_PLAY_NUM_LANES 16
+
+
+class random_play_result
+{
+public:
+    
+    random_play_result(void);
+    void add(const random_play_result &rhs);
+    
+    size_t num_games;
+    
+    // pot shares per seat, tied winners split the pot
+    double seat_wins[NUM_PLAYERS];
+    
+    // finished hand categories per seat, HIGH_CARD .. ROYAL_FLUSH
+    size_t category_counts[NUM_PLAYERS][ROYAL_FLUSH + 1];
+    
+    double seconds;
+};
+
+// Plays RANDOM_PLAY_NUM_LANES independent games of blind poker at a time, every
+// seat playing as blind_poker_table::play_rand does. Every game is on the same
+// turn, so the state is kept as structure of arrays, [card or slot][lane], and
+// each step is a branch-free loop over the lanes: a xorshift64* generator per
+// lane, moves made with selects rather than branches, and the showdown through
+// batch_get_hand_strength.
+//
+// The games follow the same rules with the same probabilities as
+// blind_poker_table, but with a different random stream, so the statistics
+// agree, not the games.
+class random_play_simulator
+{
+public:
+    
+    random_play_simulator(const unsigned long long seed);
+    
+    // plays num_games games, rounded up to a whole number of lane blocks, and adds them to result
+    void play(const size_t num_games, random_play_result &result);
+    
+protected:
+    
+    void deal(void);
+    void play_turn(const size_t player);
+    void showdown(random_play_result &result);
+    
+    // 32 random bits per lane
+    void next_rand(void);
+    
+    unsigned long long rand_states[RANDOM_PLAY_NUM_LANES];
+    unsigned int rand_bits[RANDOM_PLAY_NUM_LANES];
+    
+    unsigned char deck[NUM_CARDS_PER_DECK][RANDOM_PLAY_NUM_LANES];
+    unsigned char pickup_sizes[RANDOM_PLAY_NUM_LANES];
+    unsigned char discard_tops[RANDOM_PLAY_NUM_LANES];
+    
+    unsigned char hands[NUM_PLAYERS*NUM_CARDS_PER_HAND][RANDOM_PLAY_NUM_LANES];
+    unsigned char shown_masks[NUM_PLAYERS][RANDOM_PLAY_NUM_LANES];
+    
+    unsigned char faces[NUM_CARDS_PER_HAND*NUM_PLAYERS*RANDOM_PLAY_NUM_LANES];
+    unsigned char suits[NUM_CARDS_PER_HAND*NUM_PLAYERS*RANDOM_PLAY_NUM_LANES];
+    unsigned int strengths[NUM_PLAYERS*RANDOM_PLAY_NUM_LANES];
+};
+
+// num_games split over num_threads simulators (0 means one per hardware thread),
+// with results that depend only on the seed and the number of threads
+void simulate_random_play(const size_t num_games, const unsigned long long seed, const size_t num_threads, random_play_result &result);
+
+// the same statistics from blind_poker_table::play_rand, one table at a time, for comparison
+void play_random_tables(const size_t num_games, random_play_result &result);
+
+void print_random_play_result(const random_play_result &result);
+
+
+#endif
@@ -0,0 +1,212 @@
+#include "replay_buffer.h"
+#include "feature_encoder.h"
+
+#include <cmath>
+
+#include <mutex>
+using std::lock_guard;
+
+#include <stdexcept>
+using std::out_of_range;
+
+
+replay_buffer::replay_buffer(const size_t src_capacity, const double src_alpha, const double src_epsilon)
+{
+    if(src_capacity == 0)
+        throw out_of_range("Invalid replay buffer capacity.");
+    
+    capacity = src_capacity;
+    alpha = src_alpha;
+    epsilon = src_epsilon;
+    
+    num_leaves = 1;
+    
+    while(num_leaves < capacity)
+        num_leaves *= 2;
+    
+    positions.resize(capacity*NUM_CARDS_PER_DECK, POSITION_NOT_SHOWN);
+    targets.resize(capacity, 0.0f);
+    sum_tree.resize(2*num_leaves, 0.0);
+    
+    num_inputs = 0;
+    input_encoding = DEFAULT_INPUT_ENCODING;
+    engineered_features = false;
+    
+    max_priority = 1.0;
+    next_index = 0;
+    num_stored = 0;
+    
+    rand_state = static_cast<unsigned long long>(rand()) << 32 ^ static_cast<unsigned long long>(rand());
+    
+    if(0 == rand_state)
+        rand_state = 0x9E3779B97F4A7C15ULL;
+}
+
+void replay_buffer::add(const input_output_pair &sample)
+{
+    bool features = false;
+    const size_t encoding = blind_poker_table::get_input_encoding_for_size(sample.input.size(), features);
+    
+    unsigned char temp_positions[NUM_CARDS_PER_DECK];
+    blind_poker_table::decode_card_states(sample.input, temp_positions);
+    
+    lock_guard<mutex> lock(buffer_mutex);
+    
+    if(0 == num_inputs)
+    {
+        num_inputs = sample.input.size();
+        input_encoding = encoding;
+        engineered_features = features;
+    }
+    else if(num_inputs != sample.input.size())
+    {
+        throw out_of_range("Sample input size doesn't match the replay buffer's.");
+    }
+    
+    for(size_t i = 0; i < NUM_CARDS_PER_DECK; i++)
+        positions[next_index*NUM_CARDS_PER_DECK + i] = temp_positions[i];
+    
+    targets[next_index] = static_cast<float>(sample.output[0]);
+    
+    // new samples are replayed at least once, soon
+    set_priority(next_index, max_priority);
+    
+    next_index = (next_index + 1) % capacity;
+    
+    if(num_stored < capacity)
+        num_stored++;
+}
+
+void replay_buffer::add(const vector<input_output_pair> &samples)
+{
+    for(size_t i = 0; i < samples.size(); i++)
+        add(samples[i]);
+}
+
+void replay_buffer::sample_uniform(const size_t num_samples, vector<input_output_pair> &samples, vector<size_t> &indices)
+{
+    samples.clear();
+    indices.clear();
+    
+    lock_guard<mutex> lock(buffer_mutex);
+    
+    if(0 == num_stored)
+        return;
+    
+    samples.resize(num_samples);
+    indices.resize(num_samples);
+    
+    for(size_t i = 0; i < num_samples; i++)
+    {
+        indices[i] = static_cast<size_t>(get_rand_unit()*num_stored);
+        
+        if(indices[i] >= num_stored)
+            indices[i] = num_stored - 1;
+        
+        get_sample(indices[i], samples[i]);
+    }
+}
+
+void replay_buffer::sample_prioritised(const size_t num_samples, vector<input_output_pair> &samples, vector<size_t> &indices)
+{
+    samples.clear();
+    indices.clear();
+    
+    lock_guard<mutex> lock(buffer_mutex);
+    
+    if(0 == num_stored)
+        return;
+    
+    samples.resize(num_samples);
+    indices.resize(num_samples);
+    
+    // stratified: one draw from each of num_samples equal slices of the total
+    double slice = sum_tree[1] / num_samples;
+    
+    for(size_t i = 0; i < num_samples; i++)
+    {
+        indices[i] = find_prefix_sum((i + get_rand_unit())*slice);
+        get_sample(indices[i], samples[i]);
+    }
+}
+
+void replay_buffer::update_priority(const size_t index, const double error)
+{
+    double priority = pow(fabs(error) + epsilon, alpha);
+    
+    lock_guard<mutex> lock(buffer_mutex);
+    
+    if(index >= num_stored)
+        throw out_of_range("Invalid replay buffer index.");
+    
+    set_priority(index, priority);
+    
+    if(priority > max_priority)
+        max_priority = priority;
+}
+
+size_t replay_buffer::size(void)
+{
+    lock_guard<mutex> lock(buffer_mutex);
+    return num_stored;
+}
+
+size_t replay_buffer::get_capacity(void) const
+{
+    return capacity;
+}
+
+void replay_buffer::set_priority(const size_t index, const double priority)
+{
+    size_t node = num_leaves + index;
+    double change = priority - sum_tree[node];
+    
+    for(; node >= 1; node /= 2)
+        sum_tree[node] += change;
+}
+
+size_t replay_buffer::find_prefix_sum(double prefix_sum) const
+{
+    size_t node = 1;
+    
+    while(node < num_leaves)
+    {
+        if(prefix_sum < sum_tree[2*node] || 0 == sum_tree[2*node + 1])
+        {
+            node = 2*node;
+        }
+        else
+        {
+            prefix_sum -= sum_tree[2*node];
+            node = 2*node + 1;
+        }
+    }
+    
+    size_t index = node - num_leaves;
+    
+    // rounding can walk off the end of the stored samples
+    if(index >= num_stored)
+        index = num_stored - 1;
+    
+    return index;
+}
+
+void replay_buffer::get_sample(const size_t index, input_output_pair &sample) const
+{
+    blind_poker_table::encode_card_positions(&positions[index*NUM_CARDS_PER_DECK], sample.input, input_encoding);
+    
+    // they don't depend on how the suits are labelled, so the same from canonical positions
+    if(true == engineered_features)
+        append_engineered_features(&positions[index*NUM_CARDS_PER_DECK], sample.input);
+    sample.output.assign(1, targets[index]);
+}
+
+double replay_buffer::get_rand_unit(void)
+{
+    // xorshift64*, [0, 1)
+    rand_state ^= rand_state >> 12;
+    rand_state ^= rand_state << 25;
+    rand_state ^= rand_state >> 27;
+    
+    return static_cast<double>((rand_state * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+}
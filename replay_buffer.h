@@ -0,0 +1,76 @@
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+
+#include "cards.h"
+
+#include <mutex>
+using std::mutex;
+
+
+// Fixed capacity experience replay for one seat network. Samples are stored
+// compactly, as the 52 encoded card positions and the target output, and the
+// network inputs are rebuilt with blind_poker_table::encode_card_positions,
+// in the encoding of the first sample's input, and the engineered features
+// are computed again from the positions if the inputs had them. When full,
+// the oldest sample is overwritten.
+//
+// Priorities live in a sum-tree, so prioritised sampling and priority
+// updates are O(log n). A sample's priority is (|error| + epsilon)^alpha, new
+// samples get the largest priority seen so far. All member functions lock, so
+// several producer and trainer threads can share a buffer.
+class replay_buffer
+{
+public:
+    
+    replay_buffer(const size_t src_capacity, const double src_alpha = 0.6, const double src_epsilon = 0.01);
+    
+    // single output networks only, every sample's input the same size
+    void add(const input_output_pair &sample);
+    void add(const vector<input_output_pair> &samples);
+    
+    // indices are for update_priority
+    void sample_uniform(const size_t num_samples, vector<input_output_pair> &samples, vector<size_t> &indices);
+    void sample_prioritised(const size_t num_samples, vector<input_output_pair> &samples, vector<size_t> &indices);
+    
+    // error is the error rate BackPropagate returned for the sample
+    void update_priority(const size_t index, const double error);
+    
+    size_t size(void);
+    size_t get_capacity(void) const;
+    
+protected:
+    
+    void set_priority(const size_t index, const double priority);
+    size_t find_prefix_sum(double prefix_sum) const;
+    void get_sample(const size_t index, input_output_pair &sample) const;
+    double get_rand_unit(void);
+    
+    size_t capacity;
+    size_t num_leaves;
+    double alpha;
+    double epsilon;
+    
+    // NUM_CARDS_PER_DECK positions per sample
+    vector<unsigned char> positions;
+    vector<float> targets;
+    
+    // of the inputs, 0 until the first sample
+    size_t num_inputs;
+    size_t input_encoding;
+    bool engineered_features;
+    
+    // sum_tree[1] is the root, leaves start at sum_tree[num_leaves]
+    vector<double> sum_tree;
+    double max_priority;
+    
+    size_t next_index;
+    size_t num_stored;
+    
+    unsigned long long rand_state;
+    
+    mutex buffer_mutex;
+};
+
+
+#endif
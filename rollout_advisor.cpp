@@ -0,0 +1,145 @@
+#include "rollout_advisor.h"
+
+#include <thread>
+using std::thread;
+
+#include <chrono>
+
+#include <cmath>
+
+#include <stdexcept>
+using std::out_of_range;
+
+
+rollout_advisor::rollout_advisor(const size_t src_num_rollouts, const size_t src_num_threads)
+{
+    if(src_num_rollouts < 2)
+        throw out_of_range("Invalid number of rollouts.");
+    
+    num_rollouts = src_num_rollouts;
+    num_threads = src_num_threads;
+    
+    if(0 == num_threads)
+        num_threads = thread::hardware_concurrency();
+    
+    if(0 == num_threads)
+        num_threads = 1;
+}
+
+void rollout_advisor::evaluate(const blind_poker_table &table, rollout_result &result) const
+{
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    
+    size_t temp_num_threads = num_threads < num_rollouts ? num_threads : num_rollouts;
+    
+    // per thread running sums, reduced in thread order below
+    vector<double> sums(temp_num_threads*NUM_ACTIONS, 0.0);
+    vector<double> sums_of_squares(temp_num_threads*NUM_ACTIONS, 0.0);
+    
+    unsigned long long base_seed = static_cast<unsigned long long>(rand()) << 32 ^ static_cast<unsigned long long>(rand());
+    
+    vector<thread> threads;
+    
+    for(size_t i = 1; i < temp_num_threads; i++)
+        threads.push_back(thread(&rollout_advisor::rollout_thread, this, std::cref(table), base_seed, i, temp_num_threads, &sums[i*NUM_ACTIONS], &sums_of_squares[i*NUM_ACTIONS]));
+    
+    rollout_thread(table, base_seed, 0, temp_num_threads, &sums[0], &sums_of_squares[0]);
+    
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    
+    result.num_rollouts = num_rollouts;
+    result.best_action = ACTION_TAKE_DISCARD;
+    
+    for(size_t i = 0; i < NUM_ACTIONS; i++)
+    {
+        double sum = 0;
+        double sum_of_squares = 0;
+        
+        for(size_t j = 0; j < temp_num_threads; j++)
+        {
+            sum += sums[j*NUM_ACTIONS + i];
+            sum_of_squares += sums_of_squares[j*NUM_ACTIONS + i];
+        }
+        
+        double mean = sum / num_rollouts;
+        double variance = (sum_of_squares - num_rollouts*mean*mean) / (num_rollouts - 1);
+        
+        if(variance < 0)
+            variance = 0;
+        
+        result.action_values[i] = mean;
+        result.standard_errors[i] = sqrt(variance / num_rollouts);
+        
+        if(result.action_values[i] > result.action_values[result.best_action])
+            result.best_action = i;
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    
+    if(seconds > 0)
+        result.rollouts_per_second = (num_rollouts*NUM_ACTIONS) / seconds;
+    else
+        result.rollouts_per_second = 0;
+}
+
+void rollout_advisor::play(blind_poker_table &table) const
+{
+    rollout_result result;
+    evaluate(table, result);
+    
+    table.play_action(result.best_action);
+}
+
+void rollout_advisor::print_result(const rollout_result &result) const
+{
+    cout << "take discard: " << result.action_values[ACTION_TAKE_DISCARD] << " +/- " << result.standard_errors[ACTION_TAKE_DISCARD] << endl;
+    cout << "flip and discard: " << result.action_values[ACTION_FLIP_AND_DISCARD] << " +/- " << result.standard_errors[ACTION_FLIP_AND_DISCARD] << endl;
+    cout << "flip and keep: " << result.action_values[ACTION_FLIP_AND_KEEP] << " +/- " << result.standard_errors[ACTION_FLIP_AND_KEEP] << endl;
+    cout << result.num_rollouts*NUM_ACTIONS << " rollouts, " << result.rollouts_per_second << " rollouts/sec" << endl;
+}
+
+void rollout_advisor::rollout_thread(const blind_poker_table &table, const unsigned long long base_seed, const size_t first_rollout, const size_t rollout_step, double *const sums, double *const sums_of_squares) const
+{
+    const size_t player_index = table.get_current_player();
+    
+    // one working table per thread, every rollout branches from snapshots of it
+    blind_poker_table playout = table;
+    table_snapshot start, deal;
+    playout.save_snapshot(start);
+    
+    for(size_t i = first_rollout; i < num_rollouts; i += rollout_step)
+    {
+        // the seed depends only on the rollout, not on the thread that runs it
+        playout.restore_snapshot(start);
+        playout.set_rand_seed(base_seed + 0x9E3779B97F4A7C15ULL*(i + 1));
+        playout.randomise_unseen_cards();
+        playout.save_snapshot(deal);
+        
+        for(size_t j = 0; j < NUM_ACTIONS; j++)
+        {
+            playout.restore_snapshot(deal);
+            playout.play_action(j);
+            
+            while(false == playout.is_game_over())
+                playout.play_rand();
+            
+            double value = get_pot_share(playout, player_index);
+            
+            sums[j] += value;
+            sums_of_squares[j] += value*value;
+        }
+    }
+}
+
+double rollout_advisor::get_pot_share(const blind_poker_table &table, const size_t player_index)
+{
+    vector< vector<size_t> > ranking;
+    table.get_showdown_ranking(ranking);
+    
+    for(size_t i = 0; i < ranking[0].size(); i++)
+        if(player_index == ranking[0][i])
+            return 1.0 / ranking[0].size();
+    
+    return 0.0;
+}
@@ -0,0 +1,50 @@
+#ifndef ROLLOUT_ADVISOR_H
+#define ROLLOUT_ADVISOR_H
+
+
+#include "cards.h"
+
+
+class rollout_result
+{
+public:
+    
+    // expected share of the pot for the player to move, per ACTION_*
+    double action_values[NUM_ACTIONS];
+    double standard_errors[NUM_ACTIONS];
+    size_t num_rollouts;
+    
+    size_t best_action;
+    double rollouts_per_second;
+};
+
+// Monte Carlo advisor: estimates the value of each action for the player to
+// move by dealing the unseen cards at random (consistently with what is shown)
+// and playing the rest of the game out with play_rand. Every sampled deal is
+// used for all three actions, so the action values are directly comparable.
+class rollout_advisor
+{
+public:
+    
+    // num_threads == 0 means one per hardware thread
+    rollout_advisor(const size_t src_num_rollouts = 1000, const size_t src_num_threads = 0);
+    
+    void evaluate(const blind_poker_table &table, rollout_result &result) const;
+    
+    // as a baseline opponent, plays the best action for the player to move
+    void play(blind_poker_table &table) const;
+    
+    void print_result(const rollout_result &result) const;
+    
+protected:
+    
+    void rollout_thread(const blind_poker_table &table, const unsigned long long base_seed, const size_t first_rollout, const size_t rollout_step, double *const sums, double *const sums_of_squares) const;
+    
+    static double get_pot_share(const blind_poker_table &table, const size_t player_index);
+    
+    size_t num_rollouts;
+    size_t num_threads;
+};
+
+
+#endif
@@ -0,0 +1,291 @@
+#include "shared_trunk_neuralnet.h"
+
+#include <fstream>
+using std::ofstream;
+using std::ifstream;
+
+#include <ios>
+using std::ios;
+
+#include <stdexcept>
+using std::out_of_range;
+using std::runtime_error;
+
+#include <cstdlib>
+
+
+// the same as WeightedNeuron's, from -1.0 to 1.0
+static double get_rand_weight(void)
+{
+	return (static_cast<double>(rand()%2001) / 1000.0) - 1.0;
+}
+
+SharedTrunkNeuralNet::SharedTrunkNeuralNet(const size_t &src_num_input_neurons, const size_t &src_num_trunk_neurons, const size_t &src_num_heads)
+{
+	Resize(src_num_input_neurons, src_num_trunk_neurons, src_num_heads);
+
+	for(size_t i = 0; i < TrunkWeights.size(); i++)
+		TrunkWeights[i] = get_rand_weight();
+
+	for(size_t i = 0; i < TrunkBiasWeights.size(); i++)
+		TrunkBiasWeights[i] = get_rand_weight();
+
+	for(size_t i = 0; i < HeadWeights.size(); i++)
+		HeadWeights[i] = get_rand_weight();
+
+	for(size_t i = 0; i < HeadBiasWeights.size(); i++)
+		HeadBiasWeights[i] = get_rand_weight();
+
+	learning_rate = 1.0;
+	momentum = 1.0;
+}
+
+SharedTrunkNeuralNet::SharedTrunkNeuralNet(const char *const src_filename)
+{
+	LoadFromFile(src_filename);
+}
+
+void SharedTrunkNeuralNet::Resize(const size_t &src_num_input_neurons, const size_t &src_num_trunk_neurons, const size_t &src_num_heads)
+{
+	if(src_num_input_neurons == 0)
+		throw out_of_range("Invalid number of input neurons.");
+
+	if(src_num_trunk_neurons == 0)
+		throw out_of_range("Invalid number of trunk neurons.");
+
+	if(src_num_heads == 0)
+		throw out_of_range("Invalid number of heads.");
+
+	num_inputs = src_num_input_neurons;
+	num_trunk_neurons = src_num_trunk_neurons;
+	num_heads = src_num_heads;
+
+	TrunkWeights.assign(num_trunk_neurons*num_inputs, 0.0);
+	TrunkPreviousWeightAdjustments.assign(num_trunk_neurons*num_inputs, 0.0);
+	TrunkBiasWeights.assign(num_trunk_neurons, 0.0);
+
+	HeadWeights.assign(num_heads*num_trunk_neurons, 0.0);
+	HeadPreviousWeightAdjustments.assign(num_heads*num_trunk_neurons, 0.0);
+	HeadBiasWeights.assign(num_heads, 0.0);
+
+	InputLayer.assign(num_inputs, 0.0);
+	TrunkValues.assign(num_trunk_neurons, 0.0);
+	head = 0;
+	output_value = 0;
+}
+
+void SharedTrunkNeuralNet::FeedForward(const vector<double> &src_inputs, const size_t &head_index)
+{
+	// sanity checks
+	if(src_inputs.size() != num_inputs)
+		throw out_of_range("Invalid input vector size.");
+
+	if(head_index >= num_heads)
+		throw out_of_range("Invalid head index.");
+
+	InputLayer = src_inputs;
+	head = head_index;
+
+	for(size_t i = 0; i < num_trunk_neurons; i++)
+	{
+		const double *const weights = &TrunkWeights[i*num_inputs];
+		double value = TrunkBiasWeights[i];
+
+		for(size_t j = 0; j < num_inputs; j++)
+			value += InputLayer[j] * weights[j];
+
+		TrunkValues[i] = WeightedNeuron::ActivationFunction(value);
+	}
+
+	const double *const weights = &HeadWeights[head*num_trunk_neurons];
+	double value = HeadBiasWeights[head];
+
+	for(size_t i = 0; i < num_trunk_neurons; i++)
+		value += TrunkValues[i] * weights[i];
+
+	output_value = WeightedNeuron::ActivationFunction(value);
+}
+
+double SharedTrunkNeuralNet::GetOutputValue(void) const
+{
+	return output_value;
+}
+
+double SharedTrunkNeuralNet::BackPropagate(const double &src_desired_output)
+{
+	// derivative * (DesiredValue - OutputValue)
+	const double output_error = WeightedNeuron::DerivativeOfActivationFunction(output_value) * (src_desired_output - output_value);
+	const double error_rate = (output_value - src_desired_output) * (output_value - src_desired_output);
+
+	double *const head_weights = &HeadWeights[head*num_trunk_neurons];
+	double *const head_previous_adjustments = &HeadPreviousWeightAdjustments[head*num_trunk_neurons];
+
+	// trunk errors, through the head that was used
+	vector<double> TrunkErrors(num_trunk_neurons);
+
+	for(size_t i = 0; i < num_trunk_neurons; i++)
+		TrunkErrors[i] = output_error * head_weights[i] * WeightedNeuron::DerivativeOfActivationFunction(TrunkValues[i]);
+
+	// adjust the head
+	for(size_t i = 0; i < num_trunk_neurons; i++)
+	{
+		const double delta_weight = learning_rate * output_error * TrunkValues[i];
+		head_weights[i] = head_weights[i] + delta_weight + momentum * head_previous_adjustments[i];
+		head_previous_adjustments[i] = delta_weight;
+	}
+
+	HeadBiasWeights[head] += learning_rate * output_error;
+
+	// adjust the trunk
+	for(size_t i = 0; i < num_trunk_neurons; i++)
+	{
+		double *const weights = &TrunkWeights[i*num_inputs];
+		double *const previous_adjustments = &TrunkPreviousWeightAdjustments[i*num_inputs];
+
+		for(size_t j = 0; j < num_inputs; j++)
+		{
+			const double delta_weight = learning_rate * TrunkErrors[i] * InputLayer[j];
+			weights[j] = weights[j] + delta_weight + momentum * previous_adjustments[j];
+			previous_adjustments[j] = delta_weight;
+		}
+
+		TrunkBiasWeights[i] += learning_rate * TrunkErrors[i];
+	}
+
+	return error_rate;
+}
+
+void SharedTrunkNeuralNet::FeedForwardBatch(const vector<double> &src_inputs, const vector<size_t> &head_indices, vector<double> &src_outputs) const
+{
+	const size_t num_rows = head_indices.size();
+
+	// sanity checks
+	if(src_inputs.size() != num_rows * num_inputs)
+		throw out_of_range("Invalid input vector size.");
+
+	for(size_t i = 0; i < num_rows; i++)
+		if(head_indices[i] >= num_heads)
+			throw out_of_range("Invalid head index.");
+
+	// trunk, each neuron over every row while its weights are in cache
+	vector<double> Values(num_rows * num_trunk_neurons);
+
+	for(size_t i = 0; i < num_trunk_neurons; i++)
+	{
+		const double *const weights = &TrunkWeights[i*num_inputs];
+
+		for(size_t j = 0; j < num_rows; j++)
+		{
+			const double *const inputs = &src_inputs[j*num_inputs];
+			double value = TrunkBiasWeights[i];
+
+			for(size_t k = 0; k < num_inputs; k++)
+				value += inputs[k] * weights[k];
+
+			Values[j*num_trunk_neurons + i] = WeightedNeuron::ActivationFunction(value);
+		}
+	}
+
+	// heads
+	src_outputs.resize(num_rows);
+
+	for(size_t i = 0; i < num_rows; i++)
+	{
+		const double *const weights = &HeadWeights[head_indices[i]*num_trunk_neurons];
+		double value = HeadBiasWeights[head_indices[i]];
+
+		for(size_t j = 0; j < num_trunk_neurons; j++)
+			value += Values[i*num_trunk_neurons + j] * weights[j];
+
+		src_outputs[i] = WeightedNeuron::ActivationFunction(value);
+	}
+}
+
+size_t SharedTrunkNeuralNet::GetNumInputLayerNeurons(void) const
+{
+	return num_inputs;
+}
+
+size_t SharedTrunkNeuralNet::GetNumTrunkNeurons(void) const
+{
+	return num_trunk_neurons;
+}
+
+size_t SharedTrunkNeuralNet::GetNumHeads(void) const
+{
+	return num_heads;
+}
+
+double SharedTrunkNeuralNet::GetLearningRate(void) const
+{
+	return learning_rate;
+}
+
+void SharedTrunkNeuralNet::SetLearningRate(const double &src_learning_rate)
+{
+	learning_rate = src_learning_rate;
+}
+
+double SharedTrunkNeuralNet::GetMomentum(void) const
+{
+	return momentum;
+}
+
+void SharedTrunkNeuralNet::SetMomentum(const double &src_momentum)
+{
+	momentum = src_momentum;
+}
+
+// sizes, learning rate and momentum, then each array in declaration order
+void SharedTrunkNeuralNet::SaveToFile(const char *const filename) const
+{
+	ofstream out(filename, ios::binary);
+
+	if(out.fail())
+		throw runtime_error("Error creating/opening file.");
+
+	out.write((const char *)&num_inputs, sizeof(size_t));
+	out.write((const char *)&num_trunk_neurons, sizeof(size_t));
+	out.write((const char *)&num_heads, sizeof(size_t));
+	out.write((const char *)&learning_rate, sizeof(double));
+	out.write((const char *)&momentum, sizeof(double));
+
+	const vector<double> *const arrays[6] = { &TrunkWeights, &TrunkPreviousWeightAdjustments, &TrunkBiasWeights, &HeadWeights, &HeadPreviousWeightAdjustments, &HeadBiasWeights };
+
+	for(size_t i = 0; i < 6; i++)
+		out.write((const char *)&(*arrays[i])[0], arrays[i]->size()*sizeof(double));
+
+	if(out.fail())
+		throw runtime_error("Error writing to file.");
+}
+
+void SharedTrunkNeuralNet::LoadFromFile(const char *const filename)
+{
+	ifstream in(filename, ios::binary);
+
+	if(in.fail() || in.eof())
+		throw runtime_error("Error opening file.");
+
+	size_t temp_sizes[3] = { 0, 0, 0 };
+
+	in.read((char *)temp_sizes, sizeof(temp_sizes));
+	if(in.fail() || in.eof())
+		throw runtime_error("Error reading from file.");
+
+	Resize(temp_sizes[0], temp_sizes[1], temp_sizes[2]);
+
+	in.read((char *)&learning_rate, sizeof(double));
+	in.read((char *)&momentum, sizeof(double));
+	if(in.fail() || in.eof())
+		throw runtime_error("Error reading from file.");
+
+	vector<double> *const arrays[6] = { &TrunkWeights, &TrunkPreviousWeightAdjustments, &TrunkBiasWeights, &HeadWeights, &HeadPreviousWeightAdjustments, &HeadBiasWeights };
+
+	for(size_t i = 0; i < 6; i++)
+	{
+		in.read((char *)&(*arrays[i])[0], arrays[i]->size()*sizeof(double));
+
+		if(in.fail())
+			throw runtime_error("Error reading from file.");
+	}
+}
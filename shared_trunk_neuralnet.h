@@ -0,0 +1,77 @@
+#ifndef SHARED_TRUNK_NEURALNET_H
+#define SHARED_TRUNK_NEURALNET_H
+
+
+#include "weighted_neuron.h"
+
+
+#include <vector>
+using std::vector;
+
+
+// One network for every seat: a shared hidden layer (the trunk) learns the
+// card-position features once, and each seat has its own output neuron (its
+// head) on top of it. Seat s uses head s - 1. Every seat's games train the
+// trunk, and the model is about a quarter the size of NUM_PLAYERS - 1
+// separate FFBPNeuralNets. Units, errors and weight updates are the same as
+// FFBPNeuralNet's.
+class SharedTrunkNeuralNet
+{
+public:
+	SharedTrunkNeuralNet(const size_t &src_num_input_neurons, const size_t &src_num_trunk_neurons, const size_t &src_num_heads);
+	SharedTrunkNeuralNet(const char *const src_filename);
+
+	// to feed data into the trunk and one head
+	void FeedForward(const vector<double> &src_inputs, const size_t &head_index);
+
+	// the output of the head last fed
+	double GetOutputValue(void) const;
+
+	// trains the trunk and the head last fed
+	double BackPropagate(const double &src_desired_output);
+
+	// many rows at once, row i through head head_indices[i], without changing
+	// the network's state; the trunk weights are read once for the whole batch
+	void FeedForwardBatch(const vector<double> &src_inputs, const vector<size_t> &head_indices, vector<double> &src_outputs) const;
+
+	size_t GetNumInputLayerNeurons(void) const;
+	size_t GetNumTrunkNeurons(void) const;
+	size_t GetNumHeads(void) const;
+
+	double GetLearningRate(void) const;
+	void SetLearningRate(const double &src_learning_rate);
+	double GetMomentum(void) const;
+	void SetMomentum(const double &src_momentum);
+
+	void SaveToFile(const char *const filename) const;
+	void LoadFromFile(const char *const filename);
+
+protected:
+	void Resize(const size_t &src_num_input_neurons, const size_t &src_num_trunk_neurons, const size_t &src_num_heads);
+
+	size_t num_inputs;
+	size_t num_trunk_neurons;
+	size_t num_heads;
+
+	// neuron-major: TrunkWeights[neuron*num_inputs + input]
+	vector<double> TrunkWeights;
+	vector<double> TrunkPreviousWeightAdjustments;
+	vector<double> TrunkBiasWeights;
+
+	// head-major: HeadWeights[head*num_trunk_neurons + trunk neuron]
+	vector<double> HeadWeights;
+	vector<double> HeadPreviousWeightAdjustments;
+	vector<double> HeadBiasWeights;
+
+	// what was last fed forward
+	vector<double> InputLayer;
+	vector<double> TrunkValues;
+	size_t head;
+	double output_value;
+
+	double learning_rate;
+	double momentum;
+};
+
+
+#endif
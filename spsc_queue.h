@@ -0,0 +1,97 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+
+#include <vector>
+using std::vector;
+
+#include <atomic>
+using std::atomic;
+
+#include <utility>
+
+#include <cstddef>
+using std::size_t;
+
+#include <stdexcept>
+using std::out_of_range;
+
+
+// Bounded lock-free ring buffer for exactly one producer thread and one
+// consumer thread. push and pop never block, they fail when the queue is
+// full / empty and the caller decides how to wait.
+template<class T>
+class spsc_queue
+{
+public:
+    
+    spsc_queue(const size_t src_capacity) : slots(src_capacity + 1), head(0), tail(0)
+    {
+        if(src_capacity == 0)
+            throw out_of_range("Invalid queue capacity.");
+    }
+    
+    // producer only; on success the item is swapped into the queue
+    bool push(T &item)
+    {
+        const size_t temp_tail = tail.load(std::memory_order_relaxed);
+        const size_t next_tail = increment(temp_tail);
+        
+        if(next_tail == head.load(std::memory_order_acquire))
+            return false;
+        
+        std::swap(slots[temp_tail], item);
+        tail.store(next_tail, std::memory_order_release);
+        
+        return true;
+    }
+    
+    // consumer only
+    bool pop(T &item)
+    {
+        const size_t temp_head = head.load(std::memory_order_relaxed);
+        
+        if(temp_head == tail.load(std::memory_order_acquire))
+            return false;
+        
+        std::swap(item, slots[temp_head]);
+        head.store(increment(temp_head), std::memory_order_release);
+        
+        return true;
+    }
+    
+    // exact from either end's own thread, a snapshot otherwise
+    size_t size(void) const
+    {
+        const size_t temp_head = head.load(std::memory_order_acquire);
+        const size_t temp_tail = tail.load(std::memory_order_acquire);
+        
+        if(temp_tail >= temp_head)
+            return temp_tail - temp_head;
+        
+        return slots.size() - temp_head + temp_tail;
+    }
+    
+    size_t capacity(void) const
+    {
+        return slots.size() - 1;
+    }
+    
+protected:
+    
+    size_t increment(const size_t index) const
+    {
+        return index + 1 == slots.size() ? 0 : index + 1;
+    }
+    
+    vector<T> slots;
+    
+    // keep the two ends on separate cache lines
+    char padding0[64];
+    atomic<size_t> head;
+    char padding1[64];
+    atomic<size_t> tail;
+};
+
+
+#endif
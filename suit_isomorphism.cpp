@@ -0,0 +1,67 @@
+#include "suit_isomorphism.h"
+#include "cards.h"
+
+
+// card_id == (face - FACE_2)*4 + suit, see blind_poker_table::reset_table
+#define NUM_SUITS (SUIT_CLUBS + 1)
+#define NUM_FACES (FACE_A - FACE_2 + 1)
+
+
+void get_suit_signatures(const unsigned char *const positions, unsigned long long *const signatures)
+{
+    for(size_t i = 0; i < NUM_SUITS; i++)
+        signatures[i] = 0;
+    
+    for(size_t i = 0; i < NUM_FACES; i++)
+    {
+        const unsigned char *const face_positions = positions + i*NUM_SUITS;
+        
+        for(size_t j = 0; j < NUM_SUITS; j++)
+            signatures[j] |= static_cast<unsigned long long>(face_positions[j]) << (4*i);
+    }
+}
+
+void get_canonical_suit_map(const unsigned char *const positions, size_t *const suit_map)
+{
+    unsigned long long signatures[NUM_SUITS];
+    get_suit_signatures(positions, signatures);
+    
+    // pack the suit into the low bits of its signature (signatures use 52 bits)
+    // and sort the four keys, largest first, with a five comparator network
+    unsigned long long keys[NUM_SUITS];
+    
+    for(size_t i = 0; i < NUM_SUITS; i++)
+        keys[i] = (signatures[i] << 2) | i;
+    
+    const size_t network[5][2] = { {0, 1}, {2, 3}, {0, 2}, {1, 3}, {1, 2} };
+    
+    for(size_t i = 0; i < 5; i++)
+    {
+        unsigned long long &a = keys[network[i][0]];
+        unsigned long long &b = keys[network[i][1]];
+        
+        const unsigned long long hi = a > b ? a : b;
+        const unsigned long long lo = a > b ? b : a;
+        
+        a = hi;
+        b = lo;
+    }
+    
+    for(size_t i = 0; i < NUM_SUITS; i++)
+        suit_map[keys[i] & 3] = i;
+}
+
+void canonicalise_card_positions(const unsigned char *const positions, unsigned char *const canonical_positions)
+{
+    size_t suit_map[NUM_SUITS];
+    get_canonical_suit_map(positions, suit_map);
+    
+    for(size_t i = 0; i < NUM_FACES; i++)
+    {
+        const unsigned char *const face_positions = positions + i*NUM_SUITS;
+        unsigned char *const canonical_face_positions = canonical_positions + i*NUM_SUITS;
+        
+        for(size_t j = 0; j < NUM_SUITS; j++)
+            canonical_face_positions[suit_map[j]] = face_positions[j];
+    }
+}
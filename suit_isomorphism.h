@@ -0,0 +1,28 @@
+#ifndef SUIT_ISOMORPHISM_H
+#define SUIT_ISOMORPHISM_H
+
+
+#include <cstddef>
+using std::size_t;
+
+
+// States that differ only by a relabelling of SUIT_HEARTS .. SUIT_CLUBS are
+// strategically the same. These functions pick one representative out of the
+// (up to) 24 suit permutations of a table state, as given by
+// blind_poker_table::get_card_positions.
+//
+// Each suit is packed into a 52 bit signature, 4 bits of encoded position per
+// face, and the representative is the state whose suit signatures are in
+// descending order. Sorting four integers replaces trying all 24 permutations.
+
+// signatures[suit], one per suit
+void get_suit_signatures(const unsigned char *const positions, unsigned long long *const signatures);
+
+// suit_map[suit] is the suit that suit becomes in the representative
+void get_canonical_suit_map(const unsigned char *const positions, size_t *const suit_map);
+
+// canonical_positions may not alias positions
+void canonicalise_card_positions(const unsigned char *const positions, unsigned char *const canonical_positions);
+
+
+#endif
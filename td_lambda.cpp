@@ -0,0 +1,100 @@
+#include "td_lambda.h"
+
+#include <cmath>
+
+
+td_lambda_learner::td_lambda_learner(FFBPNeuralNet &src_NNet, const double src_lambda) : NNet(src_NNet), lambda(src_lambda)
+{
+    begin_game();
+}
+
+void td_lambda_learner::begin_game(void)
+{
+    for(size_t i = 0; i < traces.size(); i++)
+        traces[i].assign(traces[i].size(), 0.0);
+    
+    previous_value = 0;
+    has_previous_value = false;
+}
+
+void td_lambda_learner::play(blind_poker_table &bpt)
+{
+    bool flipped = false;
+    
+    decide(bpt, flipped);
+    
+    // the state of the top of the pickup pile has changed to shown
+    if(true == flipped)
+        decide(bpt, flipped);
+}
+
+void td_lambda_learner::end_game(const double reward)
+{
+    if(true == has_previous_value)
+        update(reward - previous_value);
+    
+    has_previous_value = false;
+}
+
+double td_lambda_learner::get_lambda(void) const
+{
+    return lambda;
+}
+
+void td_lambda_learner::decide(blind_poker_table &bpt, bool &flipped)
+{
+    bpt.get_ANN_input(input, NNet);
+    NNet.FeedForward(input);
+    NNet.GetOutputValues(output);
+    
+    // the value of the move made, and its gradient, from this forward pass
+    const bool move = (0 != floor(output[0] + 0.5));
+    const double value = move ? output[0] : 1.0 - output[0];
+    
+    NNet.ComputeOutputGradients(gradients);
+    
+    if(traces.size() != gradients.size())
+        traces.resize(gradients.size());
+    
+    for(size_t i = 0; i < gradients.size(); i++)
+        if(traces[i].size() != gradients[i].size())
+            traces[i].assign(gradients[i].size(), 0.0);
+    
+    // the previous decision's TD error goes along the traces as they were
+    if(true == has_previous_value)
+        update(value - previous_value);
+    
+    const double sign = move ? 1.0 : -1.0;
+    
+    for(size_t i = 0; i < traces.size(); i++)
+    {
+        double *const e = &traces[i][0];
+        const double *const g = &gradients[i][0];
+        
+        for(size_t j = 0; j < traces[i].size(); j++)
+            e[j] = lambda * e[j] + sign * g[j];
+    }
+    
+    previous_value = value;
+    has_previous_value = true;
+    
+    flipped = bpt.play_ANN_decision(output[0]);
+}
+
+void td_lambda_learner::update(const double td_error)
+{
+    steps.resize(traces.size());
+    
+    for(size_t i = 0; i < traces.size(); i++)
+    {
+        steps[i].resize(traces[i].size());
+        
+        double *const s = &steps[i][0];
+        const double *const e = &traces[i][0];
+        
+        for(size_t j = 0; j < traces[i].size(); j++)
+            s[j] = td_error * e[j];
+    }
+    
+    NNet.ApplyGradients(steps);
+}
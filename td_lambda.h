@@ -0,0 +1,57 @@
+#ifndef TD_LAMBDA_H
+#define TD_LAMBDA_H
+
+
+#include "cards.h"
+
+
+// Online TD(lambda) for one seat network. A decision's value is the network's
+// confidence in the move it made, the output if it rounded to 1 and one minus
+// the output if it rounded to 0, and the final value is 1 for a win and 0 for
+// a loss. So a lost game pushes every move towards its alternative, as the
+// serial loop's rule does, and a won game reinforces them.
+//
+// The gradient of each decision's value comes from the activations of the
+// forward pass that made the decision, and is folded into the eligibility
+// traces, one contiguous buffer per layer in ComputeGradients' layout. Each
+// TD error is applied straight away through ApplyGradients, with the
+// network's optimiser and learning rate, so no samples are kept and there is
+// no pass over the game once it's over.
+class td_lambda_learner
+{
+public:
+    
+    td_lambda_learner(FFBPNeuralNet &src_NNet, const double src_lambda = 0.7);
+    
+    // clears the traces
+    void begin_game(void);
+    
+    // plays this seat's turn, like blind_poker_table::play_ANN, learning as it goes
+    void play(blind_poker_table &bpt);
+    
+    // the final TD error, reward being 1 for a win and 0 for a loss
+    void end_game(const double reward);
+    
+    double get_lambda(void) const;
+    
+protected:
+    
+    void decide(blind_poker_table &bpt, bool &flipped);
+    void update(const double td_error);
+    
+    FFBPNeuralNet &NNet;
+    double lambda;
+    
+    vector< vector<double> > traces;
+    vector< vector<double> > gradients;
+    vector< vector<double> > steps;
+    
+    vector<double> input;
+    vector<double> output;
+    
+    double previous_value;
+    bool has_previous_value;
+};
+
+
+#endif
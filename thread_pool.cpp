@@ -0,0 +1,90 @@
+#include "thread_pool.h"
+
+#include <mutex>
+using std::lock_guard;
+using std::unique_lock;
+
+
+thread_pool::thread_pool(const size_t src_num_threads)
+{
+    size_t num_threads = src_num_threads;
+    
+    if(0 == num_threads)
+        num_threads = thread::hardware_concurrency();
+    
+    if(0 == num_threads)
+        num_threads = 1;
+    
+    num_unfinished_tasks = 0;
+    stopping = false;
+    
+    for(size_t i = 0; i < num_threads; i++)
+        threads.push_back(thread(&thread_pool::worker_thread, this));
+}
+
+thread_pool::~thread_pool(void)
+{
+    {
+        lock_guard<mutex> lock(tasks_mutex);
+        stopping = true;
+    }
+    
+    task_added.notify_all();
+    
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+void thread_pool::add_task(const function<void(void)> &task)
+{
+    {
+        lock_guard<mutex> lock(tasks_mutex);
+        tasks.push_back(task);
+        num_unfinished_tasks++;
+    }
+    
+    task_added.notify_one();
+}
+
+void thread_pool::wait(void)
+{
+    unique_lock<mutex> lock(tasks_mutex);
+    
+    while(0 != num_unfinished_tasks)
+        tasks_finished.wait(lock);
+}
+
+size_t thread_pool::get_num_threads(void) const
+{
+    return threads.size();
+}
+
+void thread_pool::worker_thread(void)
+{
+    for(;;)
+    {
+        function<void(void)> task;
+        
+        {
+            unique_lock<mutex> lock(tasks_mutex);
+            
+            while(false == stopping && true == tasks.empty())
+                task_added.wait(lock);
+            
+            if(true == tasks.empty())
+                return;
+            
+            task = tasks.front();
+            tasks.pop_front();
+        }
+        
+        task();
+        
+        {
+            lock_guard<mutex> lock(tasks_mutex);
+            
+            if(0 == --num_unfinished_tasks)
+                tasks_finished.notify_all();
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+
+#include <vector>
+using std::vector;
+
+#include <deque>
+using std::deque;
+
+#include <functional>
+using std::function;
+
+#include <thread>
+using std::thread;
+
+#include <mutex>
+using std::mutex;
+
+#include <condition_variable>
+using std::condition_variable;
+
+#include <cstddef>
+using std::size_t;
+
+
+// Fixed set of worker threads running queued tasks. wait() blocks until every
+// task added so far has finished. Tasks must not throw.
+class thread_pool
+{
+public:
+    
+    // num_threads == 0 means one per hardware thread
+    thread_pool(const size_t src_num_threads = 0);
+    ~thread_pool(void);
+    
+    void add_task(const function<void(void)> &task);
+    void wait(void);
+    
+    size_t get_num_threads(void) const;
+    
+protected:
+    
+    // not copyable
+    thread_pool(const thread_pool &);
+    thread_pool &operator=(const thread_pool &);
+    
+    void worker_thread(void);
+    
+    vector<thread> threads;
+    deque< function<void(void)> > tasks;
+    
+    mutex tasks_mutex;
+    condition_variable task_added;
+    condition_variable tasks_finished;
+    
+    size_t num_unfinished_tasks;
+    bool stopping;
+};
+
+
+#endif
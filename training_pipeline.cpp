@@ -0,0 +1,280 @@
+#include "training_pipeline.h"
+
+#include <thread>
+using std::thread;
+
+#include <chrono>
+
+#include <cmath>
+
+#include <stdexcept>
+using std::out_of_range;
+
+
+training_pipeline_settings::training_pipeline_settings(void)
+{
+    num_simulation_threads = 2;
+    num_trainer_threads = 2;
+    queue_capacity = 64;
+    max_policy_staleness = 4;
+    publish_interval = 10;
+}
+
+training_pipeline::training_pipeline(const training_pipeline_settings &src_settings) : published_versions(NUM_PLAYERS - 1)
+{
+    if(src_settings.num_simulation_threads == 0)
+        throw out_of_range("Invalid number of simulation threads.");
+    
+    if(src_settings.num_trainer_threads == 0 || src_settings.num_trainer_threads > NUM_PLAYERS - 1)
+        throw out_of_range("Invalid number of trainer threads.");
+    
+    if(src_settings.publish_interval == 0)
+        throw out_of_range("Invalid publish interval.");
+    
+    settings = src_settings;
+    NNets = 0;
+    
+    for(size_t i = 0; i < settings.num_simulation_threads*settings.num_trainer_threads; i++)
+        queues.push_back(unique_ptr< spsc_queue<trajectory> >(new spsc_queue<trajectory>(settings.queue_capacity)));
+    
+    num_sessions_run = 0;
+    seconds = 0;
+}
+
+void training_pipeline::run(vector<FFBPNeuralNet> &src_NNets, const size_t num_sessions)
+{
+    if(src_NNets.size() != NUM_PLAYERS - 1)
+        throw out_of_range("Invalid number of networks.");
+    
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    
+    NNets = &src_NNets;
+    
+    published_NNets.resize(NUM_PLAYERS - 1);
+    
+    for(size_t i = 0; i < NUM_PLAYERS - 1; i++)
+    {
+        published_versions[i].store(0);
+        publish(i);
+    }
+    
+    next_session.store(0);
+    num_running_simulations.store(settings.num_simulation_threads);
+    
+    num_trajectories_trained.store(0);
+    num_trajectories_dropped.store(0);
+    num_producer_stalls.store(0);
+    max_queue_depth.store(0);
+    queue_depth_sum.store(0);
+    num_queue_depth_samples.store(0);
+    
+    vector<thread> threads;
+    
+    for(size_t i = 0; i < settings.num_trainer_threads; i++)
+        threads.push_back(thread(&training_pipeline::trainer_thread, this, i));
+    
+    for(size_t i = 0; i < settings.num_simulation_threads; i++)
+        threads.push_back(thread(&training_pipeline::simulation_thread, this, i, num_sessions));
+    
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    
+    NNets = 0;
+    num_sessions_run = num_sessions;
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void training_pipeline::get_metrics(training_pipeline_metrics &metrics) const
+{
+    metrics.num_sessions = num_sessions_run;
+    metrics.num_trajectories_trained = num_trajectories_trained.load();
+    metrics.num_trajectories_dropped = num_trajectories_dropped.load();
+    metrics.num_producer_stalls = num_producer_stalls.load();
+    metrics.max_queue_depth = max_queue_depth.load();
+    
+    size_t temp_num_samples = num_queue_depth_samples.load();
+    
+    if(0 != temp_num_samples)
+        metrics.mean_queue_depth = static_cast<double>(queue_depth_sum.load()) / temp_num_samples;
+    else
+        metrics.mean_queue_depth = 0;
+    
+    if(seconds > 0)
+        metrics.sessions_per_second = num_sessions_run / seconds;
+    else
+        metrics.sessions_per_second = 0;
+}
+
+void training_pipeline::print_metrics(void) const
+{
+    training_pipeline_metrics metrics;
+    get_metrics(metrics);
+    
+    cout << "sessions: " << metrics.num_sessions << " (" << metrics.sessions_per_second << " sessions/sec)" << endl;
+    cout << "trajectories trained: " << metrics.num_trajectories_trained << ", dropped as stale: " << metrics.num_trajectories_dropped << endl;
+    cout << "producer stalls: " << metrics.num_producer_stalls << endl;
+    cout << "queue depth: mean " << metrics.mean_queue_depth << ", max " << metrics.max_queue_depth << " of " << settings.queue_capacity << endl;
+}
+
+void training_pipeline::simulation_thread(const size_t thread_index, const size_t num_sessions)
+{
+    // private copies of the published networks, refreshed between games
+    vector<FFBPNeuralNet> local_NNets;
+    vector<unsigned long long> local_versions(NUM_PLAYERS - 1, 0);
+    
+    for(size_t i = 0; i < NUM_PLAYERS - 1; i++)
+    {
+        local_versions[i] = published_versions[i].load(std::memory_order_acquire);
+        local_NNets.push_back(*std::atomic_load(&published_NNets[i]));
+    }
+    
+    while(next_session.fetch_add(1) < num_sessions)
+    {
+        for(size_t i = 0; i < NUM_PLAYERS - 1; i++)
+        {
+            unsigned long long temp_version = published_versions[i].load(std::memory_order_acquire);
+            
+            if(temp_version != local_versions[i])
+            {
+                local_NNets[i] = *std::atomic_load(&published_NNets[i]);
+                local_versions[i] = temp_version;
+            }
+        }
+        
+        // play game
+        blind_poker_table bpt;
+        
+        vector< vector<input_output_pair> > nnet_io;
+        nnet_io.resize(NUM_PLAYERS - 1);
+        
+        for(size_t i = 0; i < NUM_CARDS_PER_HAND; i++)
+        {
+            bpt.play_rand();
+            
+            for(size_t j = 1; j < NUM_PLAYERS; j++)
+                bpt.play_ANN(nnet_io[j - 1], local_NNets[j - 1]);
+        }
+        
+        vector< vector<size_t> > ranking;
+        bpt.get_showdown_ranking(ranking);
+        
+        vector<bool> is_winner(NUM_PLAYERS, false);
+        
+        for(size_t i = 0; i < ranking[0].size(); i++)
+            is_winner[ranking[0][i]] = true;
+        
+        for(size_t i = 1; i < NUM_PLAYERS; i++)
+        {
+            // winners aren't trained, as in the serial loop
+            if(true == is_winner[i] || 0 == nnet_io[i - 1].size())
+                continue;
+            
+            // if loser, switch ~0 for 1 and ~1 for 0
+            for(size_t j = 0; j < nnet_io[i - 1].size(); j++)
+            {
+                if(0 == floor(nnet_io[i - 1][j].output[0] + 0.5))
+                    nnet_io[i - 1][j].output[0] = 1;
+                else
+                    nnet_io[i - 1][j].output[0] = 0;
+            }
+            
+            trajectory t;
+            t.seat = i - 1;
+            t.policy_version = local_versions[i - 1];
+            t.samples.swap(nnet_io[i - 1]);
+            
+            spsc_queue<trajectory> &queue = get_queue(thread_index, t.seat % settings.num_trainer_threads);
+            
+            size_t depth = queue.size();
+            
+            queue_depth_sum.fetch_add(depth, std::memory_order_relaxed);
+            num_queue_depth_samples.fetch_add(1, std::memory_order_relaxed);
+            
+            size_t temp_max_depth = max_queue_depth.load(std::memory_order_relaxed);
+            
+            while(depth > temp_max_depth && false == max_queue_depth.compare_exchange_weak(temp_max_depth, depth))
+                ;
+            
+            // back-pressure: wait for the trainer instead of running ahead of it
+            if(false == queue.push(t))
+            {
+                num_producer_stalls.fetch_add(1, std::memory_order_relaxed);
+                
+                while(false == queue.push(t))
+                    std::this_thread::yield();
+            }
+        }
+    }
+    
+    num_running_simulations.fetch_sub(1, std::memory_order_release);
+}
+
+void training_pipeline::trainer_thread(const size_t thread_index)
+{
+    vector<size_t> num_trained_since_publish(NUM_PLAYERS - 1, 0);
+    
+    trajectory t;
+    
+    for(;;)
+    {
+        // read before draining, so that nothing pushed before the last simulator finished is missed
+        bool simulations_done = (0 == num_running_simulations.load(std::memory_order_acquire));
+        bool found_work = false;
+        
+        for(size_t i = 0; i < settings.num_simulation_threads; i++)
+        {
+            if(false == get_queue(i, thread_index).pop(t))
+                continue;
+            
+            found_work = true;
+            
+            if(published_versions[t.seat].load(std::memory_order_relaxed) - t.policy_version > settings.max_policy_staleness)
+            {
+                num_trajectories_dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            
+            FFBPNeuralNet &NNet = (*NNets)[t.seat];
+            
+            for(size_t j = 0; j < t.samples.size(); j++)
+            {
+                NNet.FeedForward(t.samples[j].input);
+                NNet.BackPropagate(t.samples[j].output);
+            }
+            
+            num_trajectories_trained.fetch_add(1, std::memory_order_relaxed);
+            
+            if(++num_trained_since_publish[t.seat] >= settings.publish_interval)
+            {
+                publish(t.seat);
+                num_trained_since_publish[t.seat] = 0;
+            }
+        }
+        
+        if(false == found_work)
+        {
+            if(true == simulations_done)
+                break;
+            
+            std::this_thread::yield();
+        }
+    }
+    
+    // the simulators are finished, but leave the published snapshots current
+    for(size_t i = thread_index; i < NUM_PLAYERS - 1; i += settings.num_trainer_threads)
+        if(0 != num_trained_since_publish[i])
+            publish(i);
+}
+
+void training_pipeline::publish(const size_t seat_index)
+{
+    shared_ptr<const FFBPNeuralNet> snapshot(new FFBPNeuralNet((*NNets)[seat_index]));
+    
+    std::atomic_store(&published_NNets[seat_index], snapshot);
+    published_versions[seat_index].fetch_add(1, std::memory_order_release);
+}
+
+spsc_queue<trajectory> &training_pipeline::get_queue(const size_t simulation_index, const size_t trainer_index)
+{
+    return *queues[simulation_index*settings.num_trainer_threads + trainer_index];
+}
@@ -0,0 +1,111 @@
+#ifndef TRAINING_PIPELINE_H
+#define TRAINING_PIPELINE_H
+
+
+#include "cards.h"
+#include "spsc_queue.h"
+
+#include <memory>
+using std::shared_ptr;
+using std::unique_ptr;
+
+
+// one seat's labelled samples from one game
+class trajectory
+{
+public:
+    
+    trajectory(void) : seat(0), policy_version(0) {}
+    
+    size_t seat;
+    unsigned long long policy_version;
+    vector<input_output_pair> samples;
+};
+
+class training_pipeline_settings
+{
+public:
+    
+    training_pipeline_settings(void);
+    
+    size_t num_simulation_threads;
+    size_t num_trainer_threads;
+    
+    // trajectories per simulation -> trainer queue
+    size_t queue_capacity;
+    
+    // a trainer drops trajectories played by a policy more than this many
+    // published versions behind its seat's current one
+    size_t max_policy_staleness;
+    
+    // trajectories a trainer applies to a seat before publishing it to the simulators
+    size_t publish_interval;
+};
+
+class training_pipeline_metrics
+{
+public:
+    
+    size_t num_sessions;
+    size_t num_trajectories_trained;
+    size_t num_trajectories_dropped;
+    size_t num_producer_stalls;
+    size_t max_queue_depth;
+    double mean_queue_depth;
+    double sessions_per_second;
+};
+
+// Pipelined self-play training: simulation threads play games with read-only
+// snapshots of the seat networks and push each seat's trajectory into a
+// lock-free queue, while trainer threads pop trajectories and backpropagate.
+// Seats are partitioned over the trainers (seat % num_trainer_threads), so a
+// network is only ever written by one thread and needs no lock. A full queue
+// makes the producer wait, which is counted as back-pressure.
+class training_pipeline
+{
+public:
+    
+    training_pipeline(const training_pipeline_settings &src_settings);
+    
+    // NNets[i] plays seat i + 1, as in the serial loop; trained in place
+    void run(vector<FFBPNeuralNet> &NNets, const size_t num_sessions);
+    
+    void get_metrics(training_pipeline_metrics &metrics) const;
+    void print_metrics(void) const;
+    
+protected:
+    
+    void simulation_thread(const size_t thread_index, const size_t num_sessions);
+    void trainer_thread(const size_t thread_index);
+    
+    void publish(const size_t seat_index);
+    
+    spsc_queue<trajectory> &get_queue(const size_t simulation_index, const size_t trainer_index);
+    
+    training_pipeline_settings settings;
+    
+    // trained networks, owned by the trainers while running
+    vector<FFBPNeuralNet> *NNets;
+    
+    // snapshots read by the simulators
+    vector< shared_ptr<const FFBPNeuralNet> > published_NNets;
+    vector< atomic<unsigned long long> > published_versions;
+    
+    vector< unique_ptr< spsc_queue<trajectory> > > queues;
+    
+    atomic<size_t> next_session;
+    atomic<size_t> num_running_simulations;
+    
+    atomic<size_t> num_trajectories_trained;
+    atomic<size_t> num_trajectories_dropped;
+    atomic<size_t> num_producer_stalls;
+    atomic<size_t> max_queue_depth;
+    atomic<size_t> queue_depth_sum;
+    atomic<size_t> num_queue_depth_samples;
+    
+    size_t num_sessions_run;
+    double seconds;
+};
+
+
+#endif
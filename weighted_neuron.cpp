@@ -62,6 +62,16 @@ void WeightedNeuron::SetInputValues(const vector<double> &src_inputs)
 	value = WeightedNeuron::ActivationFunction(value);
 }
 
+double WeightedNeuron::ComputeValue(const double *const src_inputs) const
+{
+	double temp_value = bias * bias_weight;
+
+	for(size_t i = 0; i < weights.size(); i++)
+		temp_value += src_inputs[i] * weights[i];
+
+	return WeightedNeuron::ActivationFunction(temp_value);
+}
+
 void WeightedNeuron::SetWeight(const size_t &index, const double &src_weight)
 {
 	if(index >= weights.size())
@@ -94,6 +104,21 @@ double WeightedNeuron::GetPreviousWeightAdjustment(const size_t &index) const
 	return previous_weight_adjustments[index];
 }
 
+double *WeightedNeuron::GetWeightsData(void)
+{
+	return &weights[0];
+}
+
+const double *WeightedNeuron::GetWeightsData(void) const
+{
+	return &weights[0];
+}
+
+double *WeightedNeuron::GetPreviousWeightAdjustmentsData(void)
+{
+	return &previous_weight_adjustments[0];
+}
+
 void WeightedNeuron::SetBiasWeight(const double &src_bias_weight)
 {
 	bias_weight = src_bias_weight;
@@ -109,6 +134,11 @@ double WeightedNeuron::GetValue(void) const
 	return value;
 }
 
+void WeightedNeuron::SetValue(const double &src_value)
+{
+	value = src_value;
+}
+
 void WeightedNeuron::SetBias(const double &src_bias)
 {
 	bias = src_bias;
@@ -15,13 +15,20 @@ public:
 	size_t GetNumInputs(void) const;
 	void ResetNumInputs(const size_t &src_num_inputs);
 	void SetInputValues(const vector<double> &src_inputs);
+	// what the value would be for these inputs, without storing it
+	double ComputeValue(const double *const src_inputs) const;
 	void SetWeight(const size_t &index, const double &src_weight);
 	double GetWeight(const size_t &index) const;
 	void SetPreviousWeightAdjustment(const size_t &index, const double &src_weight_adjustment);
 	double GetPreviousWeightAdjustment(const size_t &index) const;
+	// contiguous arrays of GetNumInputs() entries, for whole-layer updates
+	double *GetWeightsData(void);
+	const double *GetWeightsData(void) const;
+	double *GetPreviousWeightAdjustmentsData(void);
 	void SetBiasWeight(const double &src_bias_weight);
 	double GetBiasWeight(void) const;
 	double GetValue(void) const;
+	void SetValue(const double &src_value);
 	void SetBias(const double &src_bias);
 	double GetBias(void) const;
 	void RandomizeWeights(void);